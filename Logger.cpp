@@ -1,4 +1,5 @@
 #include "Logger.h"
+#include "tracerecorder.h"
 
 Logger::Logger(QObject *parent, QString fileName) : QObject(parent)
 {
@@ -13,6 +14,7 @@ Logger::Logger(QObject *parent, QString fileName) : QObject(parent)
 
 void Logger::write(const QString &value)
 {
+    TRACE_ZONE("logger.write");
     QString text = value;// + "";
 
     if (m_showDate) {
@@ -23,10 +25,34 @@ void Logger::write(const QString &value)
     out.setCodec("UTF-8");
 
     if (file != 0) {
-        out << text << endl;
+        out << text << '\n';
+        TRACE_ZONE("logger.flush");
+        out.flush();
     }
 }
 
+void Logger::write(const char *data, int size)
+{
+    TRACE_ZONE("logger.write");
+    if (file == 0)
+        return;
+
+    if (m_showDate) {
+        // The stamp only changes once a second.
+        const QDateTime now = QDateTime::currentDateTime();
+        const qint64 secs = now.toMSecsSinceEpoch() / 1000;
+        if (secs != m_stampSecs) {
+            m_stamp = now.toString("dd.MM.yyyy hh:mm:ss ").toLatin1();
+            m_stampSecs = secs;
+        }
+        file->write(m_stamp);
+    }
+    file->write(data, size);
+    file->putChar('\n');
+    TRACE_ZONE("logger.flush");
+    file->flush();
+}
+
 void Logger::setShowDateTime(bool value)
 {
     m_showDate = value;
@@ -15,10 +15,14 @@ public:
     explicit Logger(QObject *parent, QString fileName);
     ~Logger();
     void setShowDateTime(bool value);
+    // Writes Latin-1 text as is, without building a QString per line.
+    void write(const char *data, int size);
 
 private:
     QFile *file;
     bool m_showDate;
+    QByteArray m_stamp;
+    qint64 m_stampSecs = -1;
 
 signals:
 
@@ -1,4 +1,4 @@
-QT += widgets serialport
+QT += widgets serialport concurrent network
 
 # CONFIG += C++11
 CONFIG += c++14
@@ -6,26 +6,52 @@ CONFIG += c++14
 TARGET = NuTool-USBtoSerialPort
 TEMPLATE = app
 
+include(nubridge.pri)
+
 SOURCES += \
     settingsdialog.cpp \
     main.cpp \
     mainwindow.cpp \
     sendframebox.cpp \
     console.cpp \
-    Logger.cpp
+    Logger.cpp \
+    dbcdatabase.cpp \
+    signalplot.cpp \
+    deviceregistry.cpp \
+    portreconnector.cpp \
+    latencystats.cpp \
+    streamserver.cpp \
+    socketcanbridge.cpp \
+    cangateway.cpp \
+    captureviewer.cpp \
+    captureconverter.cpp \
+    busload.cpp \
+    displaypolicy.cpp \
+    changefilter.cpp
 
 HEADERS += \
     settingsdialog.h \
     mainwindow.h \
     sendframebox.h \
     console.h \
-    Logger.h
+    Logger.h \
+    dbcdatabase.h \
+    signalplot.h \
+    deviceregistry.h \
+    portreconnector.h \
+    latencystats.h \
+    streamserver.h \
+    socketcanbridge.h \
+    cangateway.h \
+    captureviewer.h \
+    captureconverter.h \
+    busload.h \
+    displaypolicy.h \
+    changefilter.h
 
 FORMS   += mainwindow.ui \
     settingsdialog.ui \
     sendframebox.ui
 
-HEADERS += nuvbridge.h
-
 RESOURCES += can.qrc
 
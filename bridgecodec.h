@@ -0,0 +1,261 @@
+#ifndef BRIDGECODEC_H
+#define BRIDGECODEC_H
+
+#include <QtGlobal>
+
+#include "nuvbridge.h"
+
+// Wire layouts of the bridge messages. Everything is packed little-endian
+// byte by byte, so the encoding does not depend on host byte order or struct
+// padding. Encoders write into a caller-provided buffer and return the
+// number of bytes written, or 0 if the buffer is too small; decoders return
+// false on short input. Nothing here allocates.
+namespace BridgeCodec {
+
+enum : int {
+    CanConfigSize = 32,         // "CANC", version, baud rate, silent flag, 4 filter IDs
+    CanMessageSize = 21,        // packed STR_CANMSG_T
+    CanDataHeaderSize = 4,      // "CAND"
+    CanDataSize = CanDataHeaderSize + CanMessageSize,
+    I2cReadSize = 4,            // addr | size << 16 | 0x80
+    I2cWriteHeaderSize = 2,     // addr, 0
+    I2cMaxReadSize = 0xFFFF
+};
+
+enum : quint32 {
+    CanConfigVersion = 1,
+    I2cReadFlag = 0x80
+};
+
+struct CanConfig {
+    quint32 baudRate;
+    bool silent;
+    quint32 canId[4];
+};
+
+constexpr void putLe32(char *p, quint32 value)
+{
+    p[0] = static_cast<char>(value & 0xFF);
+    p[1] = static_cast<char>((value >> 8) & 0xFF);
+    p[2] = static_cast<char>((value >> 16) & 0xFF);
+    p[3] = static_cast<char>((value >> 24) & 0xFF);
+}
+
+constexpr quint32 getLe32(const char *p)
+{
+    return quint32(static_cast<unsigned char>(p[0]))
+            | quint32(static_cast<unsigned char>(p[1])) << 8
+            | quint32(static_cast<unsigned char>(p[2])) << 16
+            | quint32(static_cast<unsigned char>(p[3])) << 24;
+}
+
+constexpr void putTag(char *p, char a, char b, char c, char d)
+{
+    p[0] = a;
+    p[1] = b;
+    p[2] = c;
+    p[3] = d;
+}
+
+constexpr void copyBytes(char *out, const char *in, int size)
+{
+    for (int i = 0; i < size; i++)
+        out[i] = in[i];
+}
+
+// CANC: sent once after opening the port in CAN mode.
+constexpr int encodeCanConfig(const CanConfig &config, char *out, int size)
+{
+    if (size < CanConfigSize)
+        return 0;
+
+    putTag(out, 'C', 'A', 'N', 'C');
+    putLe32(out + 4, CanConfigVersion);
+    putLe32(out + 8, config.baudRate);
+    putLe32(out + 12, config.silent ? 1 : 0);
+    for (int i = 0; i < 4; i++)
+        putLe32(out + 16 + 4 * i, config.canId[i]);
+    return CanConfigSize;
+}
+
+constexpr bool decodeCanConfig(const char *in, int size, CanConfig *config)
+{
+    if (size < CanConfigSize || in[0] != 'C' || in[1] != 'A' || in[2] != 'N' || in[3] != 'C')
+        return false;
+
+    config->baudRate = getLe32(in + 8);
+    config->silent = getLe32(in + 12) != 0;
+    for (int i = 0; i < 4; i++)
+        config->canId[i] = getLe32(in + 16 + 4 * i);
+    return true;
+}
+
+// Bare STR_CANMSG_T record, as the bridge reports received frames.
+constexpr int encodeCanMessage(const STR_CANMSG_T &msg, char *out, int size)
+{
+    if (size < CanMessageSize)
+        return 0;
+
+    putLe32(out, msg.IdType);
+    putLe32(out + 4, msg.FrameType);
+    putLe32(out + 8, msg.Id);
+    out[12] = static_cast<char>(msg.DLC);
+    copyBytes(out + 13, msg.Data, 8);
+    return CanMessageSize;
+}
+
+constexpr bool decodeCanMessage(const char *in, int size, STR_CANMSG_T *msg)
+{
+    if (size < CanMessageSize)
+        return false;
+
+    msg->IdType = getLe32(in);
+    msg->FrameType = getLe32(in + 4);
+    msg->Id = getLe32(in + 8);
+    msg->DLC = static_cast<unsigned char>(in[12]);
+    copyBytes(msg->Data, in + 13, 8);
+    return true;
+}
+
+// CAND: a frame to transmit on the bus.
+constexpr int encodeCanData(const STR_CANMSG_T &msg, char *out, int size)
+{
+    if (size < CanDataSize)
+        return 0;
+
+    putTag(out, 'C', 'A', 'N', 'D');
+    return CanDataHeaderSize + encodeCanMessage(msg, out + CanDataHeaderSize, size - CanDataHeaderSize);
+}
+
+constexpr bool decodeCanData(const char *in, int size, STR_CANMSG_T *msg)
+{
+    if (size < CanDataSize || in[0] != 'C' || in[1] != 'A' || in[2] != 'N' || in[3] != 'D')
+        return false;
+
+    return decodeCanMessage(in + CanDataHeaderSize, size - CanDataHeaderSize, msg);
+}
+
+// Re-frames an already encoded STR_CANMSG_T record as CAND.
+constexpr int wrapCanData(const char *message, int messageSize, char *out, int size)
+{
+    if (messageSize != CanMessageSize || size < CanDataSize)
+        return 0;
+
+    putTag(out, 'C', 'A', 'N', 'D');
+    copyBytes(out + CanDataHeaderSize, message, CanMessageSize);
+    return CanDataSize;
+}
+
+// I2C read request; the bridge answers with exactly 'length' bytes.
+constexpr int encodeI2cRead(quint8 address, int length, char *out, int size)
+{
+    if (size < I2cReadSize || length < 1 || length > I2cMaxReadSize)
+        return 0;
+
+    putLe32(out, quint32(address) | quint32(length) << 16 | I2cReadFlag);
+    return I2cReadSize;
+}
+
+constexpr bool decodeI2cRead(const char *in, int size, quint8 *address, int *length)
+{
+    if (size < I2cReadSize)
+        return false;
+
+    const quint32 cmd = getLe32(in);
+    if ((cmd & I2cReadFlag) == 0)
+        return false;
+
+    *address = static_cast<quint8>(cmd & 0x7F);
+    *length = static_cast<int>(cmd >> 16);
+    return true;
+}
+
+constexpr int i2cWriteSize(int length)
+{
+    return I2cWriteHeaderSize + length;
+}
+
+constexpr int encodeI2cWrite(quint8 address, const char *data, int length, char *out, int size)
+{
+    if (length < 1 || size < i2cWriteSize(length))
+        return 0;
+
+    out[0] = static_cast<char>(address);
+    out[1] = 0;
+    copyBytes(out + I2cWriteHeaderSize, data, length);
+    return i2cWriteSize(length);
+}
+
+// SPI has no framing: MOSI bytes go out as they are and the same number of
+// MISO bytes come back.
+constexpr int encodeSpiTransfer(const char *mosi, int length, char *out, int size)
+{
+    if (size < length)
+        return 0;
+
+    copyBytes(out, mosi, length);
+    return length;
+}
+
+namespace Check {
+
+constexpr bool canConfigRoundTrip()
+{
+    const CanConfig config = { 0x2000007D, true, { 0x123, 0x1FFFFFFF, 0, 0x80000001 } };
+    char buf[CanConfigSize] = {};
+    CanConfig back = { 0, false, { 0, 0, 0, 0 } };
+    return encodeCanConfig(config, buf, sizeof(buf)) == CanConfigSize
+            && buf[4] == 1 && buf[8] == 0x7D && buf[11] == 0x20 && buf[12] == 1
+            && decodeCanConfig(buf, sizeof(buf), &back)
+            && back.baudRate == config.baudRate && back.silent
+            && back.canId[0] == 0x123 && back.canId[1] == 0x1FFFFFFF && back.canId[3] == 0x80000001
+            && encodeCanConfig(config, buf, CanConfigSize - 1) == 0;
+}
+
+constexpr bool canDataRoundTrip()
+{
+    STR_CANMSG_T msg = {};
+    msg.IdType = CAN_EXT_ID;
+    msg.FrameType = CAN_DATA_FRAME;
+    msg.Id = 0x18DAF110;
+    msg.DLC = 8;
+    for (int i = 0; i < 8; i++)
+        msg.Data[i] = static_cast<char>(0xA0 + i);
+
+    char buf[CanDataSize] = {};
+    STR_CANMSG_T back = {};
+    return encodeCanData(msg, buf, sizeof(buf)) == CanDataSize
+            && buf[3] == 'D' && buf[12] == 0x10 && buf[15] == 0x18 && buf[16] == 8
+            && decodeCanData(buf, sizeof(buf), &back)
+            && back.IdType == msg.IdType && back.FrameType == msg.FrameType
+            && back.Id == msg.Id && back.DLC == msg.DLC
+            && back.Data[0] == msg.Data[0] && back.Data[7] == msg.Data[7]
+            && !decodeCanData(buf, CanDataSize - 1, &back);
+}
+
+constexpr bool i2cRoundTrip()
+{
+    char buf[I2cReadSize] = {};
+    quint8 address = 0;
+    int length = 0;
+    const char payload[3] = { 1, 2, 3 };
+    char write[i2cWriteSize(3)] = {};
+    return encodeI2cRead(0x50, 0x200, buf, sizeof(buf)) == I2cReadSize
+            && buf[0] == static_cast<char>(0xD0) && buf[1] == 0 && buf[2] == 0 && buf[3] == 2
+            && decodeI2cRead(buf, sizeof(buf), &address, &length)
+            && address == 0x50 && length == 0x200
+            && encodeI2cRead(0x50, 0, buf, sizeof(buf)) == 0
+            && encodeI2cWrite(0x50, payload, 3, write, sizeof(write)) == 5
+            && write[0] == 0x50 && write[1] == 0 && write[4] == 3;
+}
+
+} // namespace Check
+
+static_assert(sizeof(STR_CANMSG_T) == CanMessageSize, "STR_CANMSG_T must stay packed");
+static_assert(Check::canConfigRoundTrip(), "CANC encoding");
+static_assert(Check::canDataRoundTrip(), "CAND encoding");
+static_assert(Check::i2cRoundTrip(), "I2C encoding");
+
+} // namespace BridgeCodec
+
+#endif // BRIDGECODEC_H
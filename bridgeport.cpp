@@ -0,0 +1,100 @@
+#include "bridgeport.h"
+#include "bridgecodec.h"
+
+#include <QSerialPort>
+
+enum {
+    NuvotonVendorId = 0x0416
+};
+
+int bridgeGeneration(quint16 vendorId, quint16 productId)
+{
+    if (vendorId != NuvotonVendorId)
+        return 0;
+
+    switch (productId) {
+    case 0x5204:
+    case 0x5205:
+    case 0x2008:
+        return 2;
+    case 0x200A:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+void setI2cParameters(BridgeConfig *p, qint32 clock, int busMode)
+{
+    p->brgMode = BRG_MODE_I2C;
+    p->baudRate = clock;
+    p->normalModeEnabled = busMode != 0;
+    p->stopBits = !p->normalModeEnabled ? QSerialPort::OneStop : QSerialPort::TwoStop;
+    p->parity = QSerialPort::NoParity;
+    p->dataBits = QSerialPort::Data8;
+}
+
+void setSpiParameters(BridgeConfig *p, qint32 clock, int busMode, int spiType,
+                      bool lsbFirst, bool ssActiveHigh)
+{
+    static const QSerialPort::StopBits spiMode[3] = {QSerialPort::OneStop, QSerialPort::OneAndHalfStop, QSerialPort::TwoStop};
+    static const QSerialPort::Parity spiTypes[4] = {QSerialPort::NoParity, QSerialPort::OddParity, QSerialPort::EvenParity, QSerialPort::MarkParity};
+    static const QSerialPort::DataBits spiMisc[4] = {QSerialPort::Data8, QSerialPort::Data5, QSerialPort::Data6, QSerialPort::Data7};
+
+    p->brgMode = BRG_MODE_SPI;
+    p->baudRate = clock;
+    p->normalModeEnabled = busMode != 0;
+    p->stopBits = spiMode[qBound(0, busMode, 2)];
+    p->parity = spiTypes[spiType & 3];
+    p->dataBits = spiMisc[(lsbFirst ? 1 : 0) + (ssActiveHigh ? 2 : 0)];
+}
+
+bool openBridgePort(QSerialPort *port, const BridgeConfig &p)
+{
+    port->setPortName(p.name);
+
+    const qint32 iProBridge = bridgeGeneration(p.usbVendorID, p.usbProductID);
+
+    // NuLink2/3-Pro uses the most significant bits in baudRate to switch the interface.
+    if (iProBridge > 0) {
+        qint32 baudRate = (p.baudRate & 0x0FFFFFFF) | ((p.brgMode + 1) << 28);
+        port->setBaudRate(baudRate);
+    } else {
+        port->setBaudRate(p.baudRate);
+    }
+
+    port->setDataBits(p.dataBits);
+    port->setParity(p.parity);
+    port->setStopBits(p.stopBits);
+    port->setFlowControl(QSerialPort::NoFlowControl);
+    if (!port->open(QIODevice::ReadWrite))
+        return false;
+
+    port->setDataTerminalReady(true);
+
+    if (p.brgMode == BRG_MODE_CAN) { // for CAN interface only
+        sendCanConfig(port, p);
+    }
+
+    return true;
+}
+
+void sendCanConfig(QSerialPort *port, const BridgeConfig &p)
+{
+    BridgeCodec::CanConfig config = {};
+    config.baudRate = static_cast<quint32>(p.baudRate);
+    config.silent = !p.normalModeEnabled;
+    for (int i = 0; i < 4; i++)
+        config.canId[i] = p.canID[i];
+
+    char buf[BridgeCodec::CanConfigSize];
+    port->write(buf, BridgeCodec::encodeCanConfig(config, buf, sizeof(buf)));
+}
+
+void writeBridgeFrame(QSerialPort *port, const char *data, int size)
+{
+    port->setRequestToSend(true);
+    port->write(data, size);
+    port->flush();
+    port->setRequestToSend(false);
+}
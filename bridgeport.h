@@ -0,0 +1,46 @@
+#ifndef BRIDGEPORT_H
+#define BRIDGEPORT_H
+
+#include <QSerialPort>
+#include <QString>
+
+#define BRG_MODE_CAN (0)
+#define BRG_MODE_I2C (1)
+#define BRG_MODE_SPI (2)
+
+// Port parameters for one bridge session. In I2C and SPI mode the bridge
+// reads the bus settings from the serial line settings: the clock from
+// baudRate and the SPI mode, type and bit order from stopBits, parity and
+// dataBits.
+struct BridgeConfig {
+    int brgMode;
+    QString name;
+    qint32 baudRate;
+    QSerialPort::DataBits dataBits;
+    QSerialPort::Parity parity;
+    QSerialPort::StopBits stopBits;
+    bool normalModeEnabled;
+    unsigned int canID[4];
+    unsigned int usbVendorID;
+    unsigned int usbProductID;
+};
+
+// Returns 2 for Nu-Link2 bridges, 3 for Nu-Link3 bridges, otherwise 0.
+int bridgeGeneration(quint16 vendorId, quint16 productId);
+
+// Fill in the serial line settings that carry the I2C / SPI bus setup.
+// busMode is 0 for monitor, 1 for master and, SPI only, 2 for slave;
+// spiType is the clock polarity / phase type 0..3.
+void setI2cParameters(BridgeConfig *p, qint32 clock, int busMode);
+void setSpiParameters(BridgeConfig *p, qint32 clock, int busMode, int spiType,
+                      bool lsbFirst, bool ssActiveHigh);
+
+// Opens a bridge port with the interface selected by p.brgMode and, in CAN
+// mode, sends the CANC configuration block.
+bool openBridgePort(QSerialPort *port, const BridgeConfig &p);
+void sendCanConfig(QSerialPort *port, const BridgeConfig &p);
+
+// Writes one I2C or SPI frame; the bridge takes RTS as the frame boundary.
+void writeBridgeFrame(QSerialPort *port, const char *data, int size);
+
+#endif // BRIDGEPORT_H
@@ -0,0 +1,209 @@
+#include "bridgesession.h"
+#include "bridgecodec.h"
+
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+
+#include <cstring>
+
+enum {
+    ReadChunk = 16 * 1024,
+    MaxQueuedFrames = 65536     // oldest messages are dropped beyond this
+};
+
+// QSerialPort watches the port with socket notifiers, which need an event
+// dispatcher on the calling thread. A host that doesn't use Qt has neither
+// an application object nor a dispatcher, so both are created here. The
+// application object is never deleted: the host may exit or unload the
+// library in any order.
+static void ensureEventDispatcher()
+{
+    if (QCoreApplication::instance() == nullptr) {
+        static int argc = 1;
+        static char name[] = "nubridge";
+        static char *argv[] = { name, nullptr };
+        new QCoreApplication(argc, argv);
+    }
+    if (QAbstractEventDispatcher::instance() == nullptr) {
+        QEventLoop loop;    // creates the thread's dispatcher
+    }
+}
+
+BridgeSession::BridgeSession()
+{
+    m_config.brgMode = BRG_MODE_CAN;
+}
+
+BridgeSession::~BridgeSession()
+{
+    close();
+}
+
+bool BridgeSession::open(const BridgeConfig &config)
+{
+    close();
+
+    m_config = config;
+    m_parser.reset();
+    m_frames.clear();
+    m_frameHead = 0;
+    m_rx.clear();
+    ensureEventDispatcher();
+    if (!openBridgePort(&m_port, config))
+        return fail(m_port.errorString());
+
+    if (m_capture.isOpen())
+        m_capture.writeSession(config.brgMode, config.baudRate, config.name);
+    return config.brgMode != BRG_MODE_CAN || flush(1000);
+}
+
+void BridgeSession::close()
+{
+    if (m_port.isOpen())
+        m_port.close();
+}
+
+bool BridgeSession::startCapture(const QString &fileName)
+{
+    if (!m_capture.open(fileName))
+        return fail(m_capture.errorString());
+    if (isOpen())
+        m_capture.writeSession(m_config.brgMode, m_config.baudRate, m_config.name);
+    return true;
+}
+
+void BridgeSession::stopCapture()
+{
+    m_capture.close();
+}
+
+bool BridgeSession::sendCan(const STR_CANMSG_T *frames, int count, int timeoutMs)
+{
+    if (!isOpen() || m_config.brgMode != BRG_MODE_CAN)
+        return fail(QObject::tr("Session is not open in CAN mode"));
+
+    m_tx.resize(count * BridgeCodec::CanDataSize);
+    char *out = m_tx.data();
+    for (int i = 0; i < count; i++)
+        out += BridgeCodec::encodeCanData(frames[i], out, BridgeCodec::CanDataSize);
+
+    if (m_port.write(m_tx) != m_tx.size())
+        return fail(m_port.errorString());
+    if (m_capture.isOpen())
+        m_capture.writeRecord(CaptureTx, m_tx);
+    return flush(timeoutMs);
+}
+
+int BridgeSession::receiveCan(STR_CANMSG_T *frames, int maxFrames, int timeoutMs)
+{
+    if (!isOpen() || m_config.brgMode != BRG_MODE_CAN) {
+        fail(QObject::tr("Session is not open in CAN mode"));
+        return -1;
+    }
+
+    drain();
+    if (m_frameHead == m_frames.size() && !waitForData(timeoutMs))
+        return 0;
+
+    const int n = qMin(maxFrames, m_frames.size() - m_frameHead);
+    memcpy(frames, m_frames.constData() + m_frameHead, n * sizeof(STR_CANMSG_T));
+    m_frameHead += n;
+    if (m_frameHead == m_frames.size()) {
+        m_frames.resize(0);
+        m_frameHead = 0;
+    }
+    return n;
+}
+
+bool BridgeSession::writeFrame(const char *data, int size, int timeoutMs)
+{
+    if (!isOpen() || m_config.brgMode == BRG_MODE_CAN)
+        return fail(QObject::tr("Session is not open in I2C or SPI mode"));
+
+    writeBridgeFrame(&m_port, data, size);
+    if (m_capture.isOpen())
+        m_capture.writeRecord(CaptureTx, data, size);
+    return flush(timeoutMs);
+}
+
+int BridgeSession::read(char *data, int maxSize, int timeoutMs)
+{
+    if (!isOpen() || m_config.brgMode == BRG_MODE_CAN) {
+        fail(QObject::tr("Session is not open in I2C or SPI mode"));
+        return -1;
+    }
+
+    drain();
+    if (m_rx.isEmpty() && !waitForData(timeoutMs))
+        return 0;
+
+    const int n = qMin(maxSize, m_rx.size());
+    memcpy(data, m_rx.constData(), n);
+    m_rx.remove(0, n);
+    return n;
+}
+
+// Blocks until drain() has produced something to return, or timeoutMs
+// has passed; a timeout of 0 only polls the port.
+bool BridgeSession::waitForData(int timeoutMs)
+{
+    QElapsedTimer clock;
+    clock.start();
+    for (;;) {
+        const int left = qMax(0, timeoutMs - static_cast<int>(clock.elapsed()));
+        if (!m_port.waitForReadyRead(left))
+            return false;
+        drain();
+        if (m_config.brgMode == BRG_MODE_CAN ? m_frameHead < m_frames.size() : !m_rx.isEmpty())
+            return true;
+        if (left == 0)
+            return false;
+    }
+}
+
+void BridgeSession::drain()
+{
+    char buf[ReadChunk];
+    for (;;) {
+        const qint64 n = m_port.read(buf, sizeof(buf));
+        if (n <= 0)
+            break;
+
+        if (m_capture.isOpen())
+            m_capture.writeRecord(CaptureRx, buf, static_cast<int>(n));
+
+        if (m_config.brgMode != BRG_MODE_CAN) {
+            m_rx.append(buf, static_cast<int>(n));
+            continue;
+        }
+
+        m_parser.feed(buf, static_cast<int>(n), [this](const STR_CANMSG_T &frame) {
+            m_frames.append(frame);
+        });
+        if (m_frames.size() - m_frameHead > MaxQueuedFrames) {
+            m_frameHead = m_frames.size() - MaxQueuedFrames;
+        }
+        if (m_frameHead > MaxQueuedFrames) {
+            m_frames.remove(0, m_frameHead);
+            m_frameHead = 0;
+        }
+    }
+}
+
+bool BridgeSession::flush(int timeoutMs)
+{
+    while (m_port.bytesToWrite() > 0) {
+        if (!m_port.waitForBytesWritten(timeoutMs))
+            return fail(m_port.error() == QSerialPort::TimeoutError
+                        ? QObject::tr("Write timed out") : m_port.errorString());
+    }
+    return true;
+}
+
+bool BridgeSession::fail(const QString &reason)
+{
+    m_errorString = reason;
+    return false;
+}
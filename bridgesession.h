@@ -0,0 +1,64 @@
+#ifndef BRIDGESESSION_H
+#define BRIDGESESSION_H
+
+#include <QByteArray>
+#include <QSerialPort>
+#include <QVector>
+
+#include "bridgeport.h"
+#include "canframeparser.h"
+#include "capturefile.h"
+
+// Blocking bridge I/O for callers without an event loop, such as the C API
+// in nubridge.h. Every call runs on the caller's thread and waits on the
+// port directly, so one session must only be used from one thread at a
+// time. Received CAN messages are parsed into a queue and handed out in
+// batches; in I2C and SPI mode the raw bytes are buffered instead.
+//
+// open() creates a QCoreApplication and the thread's event dispatcher if
+// the process has none. The GUI doesn't use this class: it drives its port
+// from the event loop, and shares the port setup and codec with it.
+class BridgeSession
+{
+public:
+    BridgeSession();
+    ~BridgeSession();
+
+    bool open(const BridgeConfig &config);
+    void close();
+    bool isOpen() const { return m_port.isOpen(); }
+    const BridgeConfig &config() const { return m_config; }
+    QString errorString() const { return m_errorString; }
+
+    bool startCapture(const QString &fileName);
+    void stopCapture();
+
+    // CAN mode. sendCan() writes the whole batch with one write and waits
+    // until it has left the host; receiveCan() returns as soon as at least
+    // one message is queued, or 0 after timeoutMs.
+    bool sendCan(const STR_CANMSG_T *frames, int count, int timeoutMs);
+    int receiveCan(STR_CANMSG_T *frames, int maxFrames, int timeoutMs);
+
+    // I2C and SPI mode: one RTS-framed write, and reads of up to maxSize
+    // buffered response bytes.
+    bool writeFrame(const char *data, int size, int timeoutMs);
+    int read(char *data, int maxSize, int timeoutMs);
+
+private:
+    bool waitForData(int timeoutMs);
+    void drain();
+    bool flush(int timeoutMs);
+    bool fail(const QString &reason);
+
+    QSerialPort m_port;
+    BridgeConfig m_config;
+    QString m_errorString;
+    CanFrameParser m_parser;
+    QVector<STR_CANMSG_T> m_frames;     // parsed, from m_frameHead on not yet returned
+    int m_frameHead = 0;
+    QByteArray m_rx;
+    QByteArray m_tx;
+    CaptureWriter m_capture;
+};
+
+#endif // BRIDGESESSION_H
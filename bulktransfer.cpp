@@ -0,0 +1,220 @@
+#include "bulktransfer.h"
+#include "bridgecodec.h"
+
+#include <QTimer>
+
+enum {
+    StallTimeout = 2000     // ms without a completed chunk
+};
+
+BulkTransfer::BulkTransfer(QObject *parent) :
+    QObject(parent),
+    m_watchdog(new QTimer(this))
+{
+    m_watchdog->setSingleShot(true);
+    m_watchdog->setInterval(StallTimeout);
+    connect(m_watchdog, &QTimer::timeout, [this]() {
+        finish(false, tr("Timed out after %1 of %2 bytes").arg(m_done).arg(m_total));
+    });
+}
+
+BulkTransfer::~BulkTransfer()
+{
+    if (m_active)
+        finish(false, tr("Cancelled"));
+}
+
+bool BulkTransfer::start(Kind kind, const QString &source, const QString &target,
+                         quint8 i2cAddress, qint64 readLength, QString *errorString)
+{
+    if (m_active) {
+        if (errorString)
+            *errorString = tr("A transfer is already running");
+        return false;
+    }
+
+    m_kind = kind;
+    m_i2cAddress = i2cAddress;
+    m_offset = 0;
+    m_done = 0;
+    m_inFlight.clear();
+
+    if (kind == I2cRead) {
+        m_total = readLength;
+    } else {
+        m_source.setFileName(source);
+        if (!m_source.open(QIODevice::ReadOnly)) {
+            if (errorString)
+                *errorString = m_source.errorString();
+            return false;
+        }
+
+        m_total = m_source.size();
+        if (m_total > 0) {
+            // Stream straight from the page cache where the platform allows it.
+            m_data = m_source.map(0, m_total);
+            if (m_data == nullptr) {
+                m_fallback = m_source.readAll();
+                m_data = reinterpret_cast<const uchar *>(m_fallback.constData());
+            }
+        }
+    }
+
+    if (m_total <= 0) {
+        if (errorString)
+            *errorString = tr("Nothing to transfer");
+        m_source.close();
+        return false;
+    }
+
+    if (!target.isEmpty()) {
+        m_target.setFileName(target);
+        if (!m_target.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            if (errorString)
+                *errorString = m_target.errorString();
+            finish(false, QString());
+            return false;
+        }
+    }
+
+    m_active = true;
+    m_clock.start();
+    m_watchdog->start();
+    pump();
+    return true;
+}
+
+void BulkTransfer::cancel()
+{
+    if (m_active)
+        finish(false, tr("Cancelled after %1 of %2 bytes").arg(m_done).arg(m_total));
+}
+
+void BulkTransfer::pump()
+{
+    if (m_pumping)
+        return;
+
+    m_pumping = true;
+
+    // sendFrame may report written bytes synchronously, which retires chunks
+    // and frees window slots while this loop runs.
+    while (m_active && m_inFlight.size() < m_window && m_offset < m_total) {
+        const qint64 size = qMin<qint64>(m_chunkSize, m_total - m_offset);
+        QByteArray frame;
+        Chunk chunk;
+        chunk.payload = size;
+
+        switch (m_kind) {
+        case I2cWrite:
+            frame.resize(BridgeCodec::i2cWriteSize(static_cast<int>(size)));
+            BridgeCodec::encodeI2cWrite(m_i2cAddress, reinterpret_cast<const char *>(m_data + m_offset),
+                                        static_cast<int>(size), frame.data(), frame.size());
+            chunk.responseLeft = 0;
+            break;
+        case I2cRead: {
+            frame.resize(BridgeCodec::I2cReadSize);
+            BridgeCodec::encodeI2cRead(m_i2cAddress, static_cast<int>(size), frame.data(), frame.size());
+            chunk.responseLeft = size;
+            break;
+        }
+        case SpiTransfer:
+            frame = QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + m_offset), static_cast<int>(size));
+            chunk.responseLeft = size;
+            break;
+        }
+
+        chunk.writeLeft = frame.size();
+        m_offset += size;
+        m_inFlight.enqueue(chunk);
+        emit sendFrame(frame);
+    }
+
+    m_pumping = false;
+}
+
+void BulkTransfer::bytesWritten(qint64 bytes)
+{
+    if (!m_active)
+        return;
+
+    for (Chunk &chunk : m_inFlight) {
+        if (bytes == 0)
+            break;
+        const qint64 n = qMin(bytes, chunk.writeLeft);
+        chunk.writeLeft -= n;
+        bytes -= n;
+    }
+
+    retireChunks();
+    pump();
+}
+
+void BulkTransfer::processResponse(const char *data, int size)
+{
+    if (!m_active)
+        return;
+
+    const char *p = data;
+    qint64 left = size;
+    for (Chunk &chunk : m_inFlight) {
+        if (left == 0)
+            break;
+        const qint64 n = qMin(left, chunk.responseLeft);
+        if (n > 0 && m_target.isOpen())
+            m_target.write(p, n);
+        chunk.responseLeft -= n;
+        p += n;
+        left -= n;
+    }
+
+    retireChunks();
+    pump();
+}
+
+void BulkTransfer::retireChunks()
+{
+    bool progressed = false;
+    while (!m_inFlight.isEmpty() && m_inFlight.head().writeLeft == 0 && m_inFlight.head().responseLeft == 0) {
+        m_done += m_inFlight.dequeue().payload;
+        progressed = true;
+    }
+
+    if (!progressed)
+        return;
+
+    m_watchdog->start();
+    emit progress(m_done, m_total, throughput());
+
+    if (m_done >= m_total) {
+        finish(true, tr("Transferred %1 bytes in %2 s (%3 KiB/s)")
+               .arg(m_total)
+               .arg(m_clock.elapsed() / 1000.0, 0, 'f', 2)
+               .arg(throughput() / 1024.0, 0, 'f', 1));
+    }
+}
+
+double BulkTransfer::throughput() const
+{
+    const qint64 ns = m_clock.nsecsElapsed();
+    return ns > 0 ? m_done * 1e9 / ns : 0.0;
+}
+
+void BulkTransfer::finish(bool ok, const QString &message)
+{
+    const bool wasActive = m_active;
+
+    m_active = false;
+    m_watchdog->stop();
+    m_inFlight.clear();
+
+    if (m_data != nullptr && m_fallback.isEmpty())
+        m_source.unmap(const_cast<uchar *>(m_data));
+    m_data = nullptr;
+    m_fallback.clear();
+    m_source.close();
+    m_target.close();
+
+    if (wasActive)
+        emit finished(ok, message);
+}
@@ -0,0 +1,85 @@
+#ifndef BULKTRANSFER_H
+#define BULKTRANSFER_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QQueue>
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+
+QT_END_NAMESPACE
+
+// Streams a file to or from the bridge in protocol-sized chunks. Up to
+// window() chunks are outstanding at once, so the transfer is not limited by
+// one USB round trip per chunk.
+class BulkTransfer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Kind {
+        I2cWrite,           // file -> I2C device
+        I2cRead,            // I2C device -> file
+        SpiTransfer         // file -> MOSI, MISO -> optional file
+    };
+
+    explicit BulkTransfer(QObject *parent = nullptr);
+    ~BulkTransfer();
+
+    bool isActive() const { return m_active; }
+
+    int chunkSize() const { return m_chunkSize; }
+    void setChunkSize(int size) { m_chunkSize = size; }
+    int window() const { return m_window; }
+    void setWindow(int chunks) { m_window = chunks; }
+
+    bool start(Kind kind, const QString &source, const QString &target,
+               quint8 i2cAddress, qint64 readLength, QString *errorString = nullptr);
+    void cancel();
+
+    void processResponse(const char *data, int size);
+
+public slots:
+    void bytesWritten(qint64 bytes);
+
+signals:
+    void sendFrame(const QByteArray &frame);
+    void progress(qint64 done, qint64 total, double bytesPerSecond);
+    void finished(bool ok, const QString &message);
+
+private:
+    struct Chunk {
+        qint64 payload;
+        qint64 writeLeft;
+        qint64 responseLeft;
+    };
+
+    void pump();
+    void retireChunks();
+    void finish(bool ok, const QString &message);
+    double throughput() const;
+
+    Kind m_kind = I2cWrite;
+    bool m_active = false;
+    bool m_pumping = false;
+    int m_chunkSize = 0x200;
+    int m_window = 4;
+    quint8 m_i2cAddress = 0;
+
+    QFile m_source;
+    QFile m_target;
+    const uchar *m_data = nullptr;
+    QByteArray m_fallback;
+
+    qint64 m_total = 0;
+    qint64 m_offset = 0;
+    qint64 m_done = 0;
+    QQueue<Chunk> m_inFlight;
+    QElapsedTimer m_clock;
+    QTimer *m_watchdog = nullptr;
+};
+
+#endif // BULKTRANSFER_H
@@ -0,0 +1,386 @@
+#include "busload.h"
+
+#include <QCheckBox>
+#include <QElapsedTimer>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+enum {
+    RefreshInterval = 500,      // ms
+    TrailerBits = 13,           // CRC delimiter, ACK slot, ACK delimiter, EOF, IFS
+    CrcBits = 15,
+    StandardHeaderBits = 19,    // SOF, ID, RTR, IDE, r0, DLC
+    ExtendedHeaderBits = 39,    // SOF, ID A, SRR, IDE, ID B, RTR, r1, r0, DLC
+    StuffStates = 12,           // last bit (0/1) x run length (0..5)
+    IdleState = 6               // recessive idle before SOF, no run yet
+};
+
+// CRC-15/CAN (x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1) kept
+// left-aligned in 16 bits and fed two bytes per step, and a bit-stuffing
+// state machine over bytes: for each state (last bit, run length) and byte,
+// the state after it in the low nibble and its stuff bits in the high one.
+// The header is padded with leading zeros to whole bytes, which leaves the
+// CRC unchanged; the head table skips that padding when stuffing, and the
+// tail table covers the last seven CRC bits.
+struct Tables {
+    quint16 crc[2][256];
+    quint8 stuff[StuffStates][256];
+    quint8 head[8][256];            // from IdleState, skipping n leading bits
+    quint8 tail[StuffStates][128];
+
+    Tables()
+    {
+        for (int i = 0; i < 256; i++) {
+            quint16 value = static_cast<quint16>(i << 8);
+            for (int bit = 0; bit < 8; bit++)
+                value = (value & 0x8000) ? (value << 1) ^ (0x4599 << 1) : value << 1;
+            crc[0][i] = value;
+        }
+        for (int i = 0; i < 256; i++)
+            crc[1][i] = static_cast<quint16>((crc[0][i] << 8) ^ crc[0][crc[0][i] >> 8]);
+
+        for (int byte = 0; byte < 256; byte++) {
+            for (int state = 0; state < StuffStates; state++)
+                stuff[state][byte] = run(state, byte, 8);
+            for (int skip = 0; skip < 8; skip++)
+                head[skip][byte] = run(IdleState, byte, 8 - skip);
+        }
+        for (int state = 0; state < StuffStates; state++) {
+            for (int bits = 0; bits < 128; bits++)
+                tail[state][bits] = run(state, bits, 7);
+        }
+    }
+
+    // Feeds the low count bits of value, MSB first. A complementary stuff
+    // bit follows five equal bits and starts the next run.
+    static quint8 run(int state, int value, int count)
+    {
+        int last = state / 6;
+        int length = state % 6;
+        int stuffed = 0;
+        for (int bit = count - 1; bit >= 0; bit--) {
+            const int b = (value >> bit) & 1;
+            length = b == last ? length + 1 : 1;
+            last = b;
+            if (length == 5) {
+                stuffed++;
+                last = !b;
+                length = 1;
+            }
+        }
+        return static_cast<quint8>((stuffed << 4) | (last * 6 + length));
+    }
+};
+
+const Tables &tables()
+{
+    static const Tables instance;
+    return instance;
+}
+
+int dataBytes(const STR_CANMSG_T &msg)
+{
+    if (msg.FrameType == CAN_REMOTE_FRAME)
+        return 0;
+    return msg.DLC > 8 ? 8 : msg.DLC;
+}
+
+} // namespace
+
+int CanBits::frameBits(const STR_CANMSG_T &msg)
+{
+    const Tables &t = tables();
+    const quint32 remote = msg.FrameType == CAN_REMOTE_FRAME ? 1 : 0;
+    const int length = dataBytes(msg);
+
+    // SOF through DLC, right-aligned in whole bytes, then the data field.
+    quint8 bytes[13];
+    int headerBytes;
+    int headerBits;
+    if (msg.IdType == CAN_EXT_ID) {
+        const quint64 header = (quint64(msg.Id >> 18 & 0x7FF) << 27) | (quint64(3) << 25)
+                | (quint64(msg.Id & 0x3FFFF) << 7) | (remote << 6) | (msg.DLC & 0xF);
+        for (int i = 0; i < 5; i++)
+            bytes[i] = static_cast<quint8>(header >> (32 - 8 * i));
+        headerBytes = 5;
+        headerBits = ExtendedHeaderBits;
+    } else {
+        const quint32 header = ((msg.Id & 0x7FF) << 7) | (remote << 6) | (msg.DLC & 0xF);
+        bytes[0] = static_cast<quint8>(header >> 16);
+        bytes[1] = static_cast<quint8>(header >> 8);
+        bytes[2] = static_cast<quint8>(header);
+        headerBytes = 3;
+        headerBits = StandardHeaderBits;
+    }
+    memcpy(bytes + headerBytes, msg.Data, sizeof(msg.Data));
+    const int size = headerBytes + length;
+
+    quint32 crc = 0;
+    int i = 0;
+    for (; i + 1 < size; i += 2)
+        crc = t.crc[1][(crc >> 8) ^ bytes[i]] ^ t.crc[0][(crc & 0xFF) ^ bytes[i + 1]];
+    if (i < size)
+        crc = ((crc << 8) ^ t.crc[0][(crc >> 8) ^ bytes[i]]) & 0xFFFF;
+    crc >>= 1;
+
+    const int skip = 8 * headerBytes - headerBits;
+    int step = t.head[skip][bytes[0]];
+    int stuffBits = step >> 4;
+    for (i = 1; i < size; i++) {
+        step = t.stuff[step & 0xF][bytes[i]];
+        stuffBits += step >> 4;
+    }
+    step = t.stuff[step & 0xF][crc >> 7];
+    stuffBits += step >> 4;
+    stuffBits += t.tail[step & 0xF][crc & 0x7F] >> 4;
+
+    return headerBits + 8 * length + CrcBits + stuffBits + TrailerBits;
+}
+
+int CanBits::worstCaseFrameBits(const STR_CANMSG_T &msg)
+{
+    const int header = msg.IdType == CAN_EXT_ID ? ExtendedHeaderBits : StandardHeaderBits;
+    const int stuffed = header + 8 * dataBytes(msg) + CrcBits;
+    return stuffed + (stuffed - 1) / 4 + TrailerBits;
+}
+
+BusLoadMeter::BusLoadMeter() :
+    m_stdIndex(StdIdCount, -1)
+{
+    reset();
+}
+
+void BusLoadMeter::setBitRate(qint32 bitsPerSecond)
+{
+    m_bitRate = bitsPerSecond > 0 ? bitsPerSecond : 1;
+}
+
+void BusLoadMeter::reset()
+{
+    memset(m_buckets, 0, sizeof(m_buckets));
+    m_bucket = -1;
+    m_peakPercent = 0;
+    m_totalFrames = 0;
+    m_ids.clear();
+    m_stdIndex.fill(-1);
+    m_extIndex.clear();
+}
+
+// Bits in the window of completed buckets before the current one.
+qint64 BusLoadMeter::windowBits() const
+{
+    qint64 bits = 0;
+    for (int i = 1; i <= WindowBuckets; i++)
+        bits += m_buckets[(m_bucket - i + Slots) % Slots].bits;
+    return bits;
+}
+
+// Moves the current bucket forward; buckets that were skipped had no traffic.
+void BusLoadMeter::advance(qint64 bucket)
+{
+    if (bucket <= m_bucket)
+        return;
+    if (m_bucket < 0) {
+        m_bucket = bucket;
+        return;
+    }
+
+    const qint64 steps = qMin(bucket - m_bucket, qint64(Slots));
+    for (qint64 i = 0; i < steps; i++) {
+        m_bucket = bucket - steps + 1 + i;
+        m_buckets[m_bucket % Slots] = Bucket{ 0, 0 };
+        const double percent = 100.0 * windowBits() / m_bitRate;
+        if (percent > m_peakPercent)
+            m_peakPercent = percent;
+    }
+}
+
+BusLoadMeter::IdCounter &BusLoadMeter::counter(const STR_CANMSG_T &msg)
+{
+    int index;
+    if (msg.IdType == CAN_STD_ID && msg.Id < StdIdCount) {
+        index = m_stdIndex.at(msg.Id);
+        if (index < 0)
+            m_stdIndex[msg.Id] = index = m_ids.size();
+    } else {
+        index = m_extIndex.value(msg.Id, -1);
+        if (index < 0)
+            m_extIndex.insert(msg.Id, index = m_ids.size());
+    }
+
+    if (index == m_ids.size()) {
+        IdCounter counter;
+        memset(&counter, 0, sizeof(counter));
+        counter.id = msg.Id;
+        counter.extended = msg.IdType == CAN_EXT_ID;
+        counter.lastBucket = m_bucket;
+        m_ids.append(counter);
+    }
+    return m_ids[index];
+}
+
+void BusLoadMeter::addFrame(const STR_CANMSG_T &msg, qint64 timeUs)
+{
+    advance(timeUs / BucketUs);
+
+    const int bits = m_exact ? CanBits::frameBits(msg) : CanBits::worstCaseFrameBits(msg);
+    const int slot = static_cast<int>(m_bucket % Slots);
+    m_buckets[slot].bits += bits;
+    m_buckets[slot].frames++;
+    m_totalFrames++;
+
+    // Each ID clears the slots it skipped lazily, on its next frame.
+    IdCounter &id = counter(msg);
+    if (id.lastBucket != m_bucket) {
+        const qint64 steps = qMin(m_bucket - id.lastBucket, qint64(Slots));
+        for (qint64 i = 0; i < steps; i++) {
+            const int stale = static_cast<int>((m_bucket - i) % Slots);
+            id.frames[stale] = 0;
+            id.bits[stale] = 0;
+        }
+        id.lastBucket = m_bucket;
+    }
+    id.frames[slot]++;
+    id.bits[slot] += bits;
+}
+
+double BusLoadMeter::loadPercent(qint64 nowUs)
+{
+    advance(nowUs / BucketUs);
+    return 100.0 * windowBits() / m_bitRate;
+}
+
+double BusLoadMeter::framesPerSecond(qint64 nowUs)
+{
+    advance(nowUs / BucketUs);
+
+    qint64 frames = 0;
+    for (int i = 1; i <= WindowBuckets; i++)
+        frames += m_buckets[(m_bucket - i + Slots) % Slots].frames;
+    return frames * (1000000.0 / (WindowBuckets * BucketUs));
+}
+
+QVector<BusLoadMeter::IdRate> BusLoadMeter::idRates(qint64 nowUs)
+{
+    advance(nowUs / BucketUs);
+
+    const double perSecond = 1000000.0 / (WindowBuckets * BucketUs);
+    QVector<IdRate> rates;
+    rates.reserve(m_ids.size());
+    for (const IdCounter &id : m_ids) {
+        // Only the window's buckets that the ID's slots still hold count.
+        qint64 frames = 0;
+        qint64 bits = 0;
+        for (int i = 1; i <= WindowBuckets; i++) {
+            const qint64 bucket = m_bucket - i;
+            if (bucket < 0 || bucket > id.lastBucket || bucket <= id.lastBucket - Slots)
+                continue;
+            frames += id.frames[bucket % Slots];
+            bits += id.bits[bucket % Slots];
+        }
+        rates.append({ id.id, id.extended, frames * perSecond, 100.0 * bits * perSecond / m_bitRate });
+    }
+    std::sort(rates.begin(), rates.end(), [](const IdRate &a, const IdRate &b) {
+        return a.extended != b.extended ? b.extended : a.id < b.id;
+    });
+    return rates;
+}
+
+BusLoadWindow::BusLoadWindow(BusLoadMeter *meter, const QElapsedTimer *clock, QWidget *parent) :
+    QWidget(parent, Qt::Window),
+    m_meter(meter),
+    m_clock(clock),
+    m_summary(new QLabel),
+    m_table(new QTableWidget),
+    m_timer(new QTimer(this))
+{
+    setWindowTitle(tr("CAN Bus Load"));
+    resize(420, 360);
+
+    const QStringList headers = { tr("ID"), tr("Frames/s"), tr("Load") };
+    m_table->setColumnCount(headers.size());
+    m_table->setHorizontalHeaderLabels(headers);
+    m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_table->verticalHeader()->hide();
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    QCheckBox *exact = new QCheckBox(tr("Exact bit stuffing"));
+    exact->setChecked(m_meter->exactStuffing());
+    exact->setToolTip(tr("Count the stuff bits of each frame instead of assuming the worst case"));
+    connect(exact, &QCheckBox::toggled, [this](bool checked) {
+        m_meter->setExactStuffing(checked);
+    });
+
+    QPushButton *reset = new QPushButton(tr("Reset"));
+    connect(reset, &QPushButton::clicked, [this]() {
+        m_meter->reset();
+        refresh();
+    });
+
+    QHBoxLayout *controls = new QHBoxLayout;
+    controls->addWidget(exact);
+    controls->addStretch();
+    controls->addWidget(reset);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(m_summary);
+    layout->addLayout(controls);
+    layout->addWidget(m_table);
+
+    m_timer->setInterval(RefreshInterval);
+    connect(m_timer, &QTimer::timeout, this, &BusLoadWindow::refresh);
+}
+
+void BusLoadWindow::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refresh();
+    m_timer->start();
+}
+
+void BusLoadWindow::hideEvent(QHideEvent *event)
+{
+    m_timer->stop();
+    QWidget::hideEvent(event);
+}
+
+void BusLoadWindow::refresh()
+{
+    const qint64 nowUs = m_clock->nsecsElapsed() / 1000;
+    m_summary->setText(tr("%1 kbit/s: load %2 %, peak %3 %, %4 frames/s")
+                       .arg(m_meter->bitRate() / 1000)
+                       .arg(m_meter->loadPercent(nowUs), 0, 'f', 1)
+                       .arg(m_meter->peakLoadPercent(), 0, 'f', 1)
+                       .arg(m_meter->framesPerSecond(nowUs), 0, 'f', 0));
+
+    const QVector<BusLoadMeter::IdRate> rows = m_meter->idRates(nowUs);
+    m_table->setRowCount(rows.size());
+
+    auto setCell = [this](int row, int column, const QString &text) {
+        QTableWidgetItem *item = m_table->item(row, column);
+        if (item == nullptr) {
+            item = new QTableWidgetItem;
+            if (column > 0)
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            m_table->setItem(row, column, item);
+        }
+        item->setText(text);
+    };
+
+    for (int row = 0; row < rows.size(); row++) {
+        const BusLoadMeter::IdRate &r = rows.at(row);
+        setCell(row, 0, QString("%1").arg(r.id, r.extended ? 8 : 3, 16, QChar('0')).toUpper());
+        setCell(row, 1, QString::number(r.framesPerSecond, 'f', 0));
+        setCell(row, 2, QString("%1 %").arg(r.loadPercent, 0, 'f', 2));
+    }
+}
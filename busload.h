@@ -0,0 +1,121 @@
+#ifndef BUSLOAD_H
+#define BUSLOAD_H
+
+#include <QHash>
+#include <QVector>
+#include <QWidget>
+
+#include "nuvbridge.h"
+
+QT_BEGIN_NAMESPACE
+
+class QElapsedTimer;
+class QLabel;
+class QTableWidget;
+class QTimer;
+
+QT_END_NAMESPACE
+
+// On-wire length of a classic CAN frame in bits, from SOF to the end of
+// the interframe space. The exact variant builds the frame's real bit
+// sequence, including CRC-15, and counts the stuff bits in it; worst case
+// assumes a stuff bit after every four bits of the stuffed region.
+namespace CanBits {
+
+int frameBits(const STR_CANMSG_T &msg);
+int worstCaseFrameBits(const STR_CANMSG_T &msg);
+
+} // namespace CanBits
+
+// Bus load over a sliding one-second window of ten completed 100 ms
+// buckets, with the peak of all windows seen and a per-ID frame rate.
+// Standard IDs index a flat table, so adding a frame costs one bit-length
+// computation and a few array updates.
+class BusLoadMeter
+{
+public:
+    enum {
+        BucketUs = 100000,
+        WindowBuckets = 10,
+        Slots = WindowBuckets + 1,  // the window and the bucket still filling
+        StdIdCount = 0x800
+    };
+
+    struct IdRate {
+        quint32 id;
+        bool extended;
+        double framesPerSecond;
+        double loadPercent;
+    };
+
+    BusLoadMeter();
+
+    void setBitRate(qint32 bitsPerSecond);
+    qint32 bitRate() const { return m_bitRate; }
+    void setExactStuffing(bool exact) { m_exact = exact; }
+    bool exactStuffing() const { return m_exact; }
+    void reset();
+
+    void addFrame(const STR_CANMSG_T &msg, qint64 timeUs);
+    qint64 totalFrames() const { return m_totalFrames; }
+
+    // Over the last complete window before nowUs.
+    double loadPercent(qint64 nowUs);
+    double framesPerSecond(qint64 nowUs);
+    double peakLoadPercent() const { return m_peakPercent; }
+    QVector<IdRate> idRates(qint64 nowUs);
+
+private:
+    struct Bucket {
+        qint64 bits;
+        qint64 frames;
+    };
+
+    struct IdCounter {
+        quint32 id;
+        bool extended;
+        qint64 lastBucket;
+        quint32 frames[Slots];
+        quint32 bits[Slots];
+    };
+
+    void advance(qint64 bucket);
+    qint64 windowBits() const;
+    IdCounter &counter(const STR_CANMSG_T &msg);
+
+    qint32 m_bitRate = 500000;
+    bool m_exact = true;
+    Bucket m_buckets[Slots];
+    qint64 m_bucket = -1;               // absolute number of the current bucket
+    double m_peakPercent = 0;
+    qint64 m_totalFrames = 0;
+    QVector<IdCounter> m_ids;
+    QVector<int> m_stdIndex;
+    QHash<quint32, int> m_extIndex;
+};
+
+// Load, peak and frame rate of the bus with a per-ID breakdown, timed by
+// the same clock the frames were added with.
+class BusLoadWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    BusLoadWindow(BusLoadMeter *meter, const QElapsedTimer *clock, QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void refresh();
+
+private:
+    BusLoadMeter *m_meter;
+    const QElapsedTimer *m_clock;
+    QLabel *m_summary = nullptr;
+    QTableWidget *m_table = nullptr;
+    QTimer *m_timer = nullptr;
+};
+
+#endif // BUSLOAD_H
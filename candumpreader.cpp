@@ -0,0 +1,251 @@
+#include "candumpreader.h"
+
+#include <QTimer>
+
+#include <cstring>
+
+enum {
+    ReadBlock = 64 * 1024,
+    MaxLineLength = 256,            // longer lines are skipped
+    MaxReplayBatch = 1000,          // frames per pass before yielding to the event loop
+    CanErrorFlag = 0x20000000
+};
+
+static inline int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+static inline const char *skipSpaces(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+CandumpReader::CandumpReader()
+{
+}
+
+bool CandumpReader::open(const QString &fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_buffer.resize(ReadBlock + MaxLineLength);
+    return true;
+}
+
+void CandumpReader::close()
+{
+    if (m_file.isOpen())
+        m_file.close();
+    m_pos = 0;
+    m_end = 0;
+    m_atEnd = false;
+    m_framesRead = 0;
+    m_linesSkipped = 0;
+}
+
+// Moves the unread tail to the front and reads the next block behind it.
+bool CandumpReader::fill()
+{
+    if (m_atEnd)
+        return false;
+
+    const int tail = m_end - m_pos;
+    memmove(m_buffer.data(), m_buffer.constData() + m_pos, tail);
+    m_pos = 0;
+    m_end = tail;
+
+    const qint64 n = m_file.read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+    if (n <= 0) {
+        m_atEnd = true;
+        return false;
+    }
+    m_end += static_cast<int>(n);
+    return true;
+}
+
+bool CandumpReader::readFrame(CandumpFrame *frame)
+{
+    for (;;) {
+        const char *begin = m_buffer.constData() + m_pos;
+        const char *newline = static_cast<const char *>(memchr(begin, '\n', m_end - m_pos));
+        if (newline == nullptr) {
+            if (m_end - m_pos >= MaxLineLength) {
+                // Not a candump line; drop it up to the next newline.
+                m_linesSkipped++;
+                m_pos = m_end;
+            }
+            if (fill())
+                continue;
+            if (m_pos == m_end)
+                return false;
+            newline = m_buffer.constData() + m_end;     // last line without a newline
+        }
+
+        const char *end = newline;
+        m_pos = static_cast<int>(newline - m_buffer.constData()) + (newline < m_buffer.constData() + m_end ? 1 : 0);
+        if (end > begin && end[-1] == '\r')
+            end--;
+        if (end == begin)
+            continue;
+
+        if (parseLine(begin, end, frame)) {
+            m_framesRead++;
+            return true;
+        }
+        m_linesSkipped++;
+    }
+}
+
+bool CandumpReader::parseLine(const char *p, const char *end, CandumpFrame *frame)
+{
+    // (seconds.fraction)
+    p = skipSpaces(p, end);
+    if (p == end || *p++ != '(')
+        return false;
+
+    qint64 seconds = 0;
+    const char *digits = p;
+    while (p < end && *p >= '0' && *p <= '9')
+        seconds = seconds * 10 + (*p++ - '0');
+    if (p == digits || p == end || *p++ != '.')
+        return false;
+
+    qint64 fraction = 0;
+    int fractionDigits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (fractionDigits < 6) {
+            fraction = fraction * 10 + (*p - '0');
+            fractionDigits++;
+        }
+        p++;
+    }
+    if (fractionDigits == 0 || p == end || *p++ != ')')
+        return false;
+    while (fractionDigits++ < 6)
+        fraction *= 10;
+    frame->timeUs = seconds * 1000000 + fraction;
+
+    // interface name
+    p = skipSpaces(p, end);
+    while (p < end && *p != ' ' && *p != '\t')
+        p++;
+    p = skipSpaces(p, end);
+
+    // 3 hex digits for standard and 8 for extended IDs
+    quint32 id = 0;
+    int idDigits = 0;
+    int value;
+    while (p < end && (value = hexValue(*p)) >= 0) {
+        id = id << 4 | quint32(value);
+        idDigits++;
+        p++;
+    }
+    if (p == end || *p++ != '#' || (idDigits != 3 && idDigits != 8))
+        return false;
+    if (p < end && *p == '#')
+        return false;       // CAN FD
+    if (idDigits == 8 && (id & CanErrorFlag))
+        return false;
+
+    STR_CANMSG_T &msg = frame->msg;
+    msg.IdType = idDigits == 8 ? CAN_EXT_ID : CAN_STD_ID;
+    msg.Id = id & (idDigits == 8 ? 0x1FFFFFFF : 0x7FF);
+    memset(msg.Data, 0, sizeof(msg.Data));
+
+    if (p < end && (*p == 'R' || *p == 'r')) {
+        // Remote frame, optionally with its length: 123#R or 123#R4
+        msg.FrameType = CAN_REMOTE_FRAME;
+        p++;
+        msg.DLC = (p < end && *p >= '0' && *p <= '8') ? static_cast<unsigned char>(*p - '0') : 0;
+        return true;
+    }
+
+    // Data bytes, optionally separated by dots: 11223344 or 11.22.33.44
+    msg.FrameType = CAN_DATA_FRAME;
+    int length = 0;
+    while (p < end && *p != ' ' && *p != '\t') {
+        if (*p == '.') {
+            p++;
+            continue;
+        }
+        const int high = hexValue(*p);
+        const int low = p + 1 < end ? hexValue(p[1]) : -1;
+        if (high < 0 || low < 0 || length == 8)
+            return false;
+        msg.Data[length++] = static_cast<char>(high << 4 | low);
+        p += 2;
+    }
+    msg.DLC = static_cast<unsigned char>(length);
+    return true;
+}
+
+CandumpReplay::CandumpReplay(QObject *parent) :
+    QObject(parent),
+    m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &CandumpReplay::replayDue);
+}
+
+bool CandumpReplay::start(const QString &fileName, QString *errorString)
+{
+    stop();
+
+    if (!m_reader.open(fileName)) {
+        if (errorString)
+            *errorString = m_reader.errorString();
+        return false;
+    }
+
+    m_hasNext = m_reader.readFrame(&m_next);
+    m_firstUs = m_hasNext ? m_next.timeUs : 0;
+    m_active = true;
+    m_clock.start();
+    m_timer->start(0);
+    return true;
+}
+
+void CandumpReplay::stop()
+{
+    m_timer->stop();
+    m_active = false;
+}
+
+void CandumpReplay::replayDue()
+{
+    const qint64 nowUs = m_clock.nsecsElapsed() / 1000;
+    for (int n = 0; m_hasNext && n < MaxReplayBatch; n++) {
+        const qint64 dueUs = m_next.timeUs - m_firstUs;
+        if (dueUs > nowUs) {
+            m_timer->start(static_cast<int>((dueUs - nowUs) / 1000));
+            return;
+        }
+
+        emit frameReady(m_next.msg, m_next.timeUs);
+        if (!m_active)
+            return;         // stopped from a connected slot
+        m_hasNext = m_reader.readFrame(&m_next);
+    }
+
+    if (m_hasNext) {
+        m_timer->start(0);
+        return;
+    }
+
+    m_active = false;
+    emit finished();
+}
@@ -0,0 +1,89 @@
+#ifndef CANDUMPREADER_H
+#define CANDUMPREADER_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+
+#include "nuvbridge.h"
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+
+QT_END_NAMESPACE
+
+struct CandumpFrame {
+    qint64 timeUs;
+    STR_CANMSG_T msg;
+};
+
+// Streaming reader for can-utils log files (candump -l, canplayer):
+//   (1436509052.249713) can0 123#DEADBEEF
+//   (1436509052.250102) can0 12345678#R
+// The file is read in large blocks and each line is parsed in place, so
+// the cost per frame is one pass over its characters. CAN FD and error
+// frames, which STR_CANMSG_T can't hold, and malformed lines are counted
+// and skipped.
+class CandumpReader
+{
+public:
+    CandumpReader();
+
+    bool open(const QString &fileName);
+    void close();
+    QString errorString() const { return m_file.errorString(); }
+
+    bool readFrame(CandumpFrame *frame);
+
+    qint64 framesRead() const { return m_framesRead; }
+    qint64 linesSkipped() const { return m_linesSkipped; }
+
+    static bool parseLine(const char *line, const char *end, CandumpFrame *frame);
+
+private:
+    bool fill();
+
+    QFile m_file;
+    QByteArray m_buffer;
+    int m_pos = 0;
+    int m_end = 0;
+    bool m_atEnd = false;
+    qint64 m_framesRead = 0;
+    qint64 m_linesSkipped = 0;
+};
+
+// Plays a candump log back at its recorded pace. Frames that are due are
+// emitted in one pass, so a late timer catches up instead of drifting.
+class CandumpReplay : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CandumpReplay(QObject *parent = nullptr);
+
+    bool start(const QString &fileName, QString *errorString = nullptr);
+    void stop();
+    bool isActive() const { return m_active; }
+
+    qint64 framesReplayed() const { return m_reader.framesRead() - (m_hasNext ? 1 : 0); }
+    qint64 linesSkipped() const { return m_reader.linesSkipped(); }
+
+signals:
+    void frameReady(const STR_CANMSG_T &frame, qint64 timeUs);
+    void finished();
+
+private slots:
+    void replayDue();
+
+private:
+    CandumpReader m_reader;
+    CandumpFrame m_next;
+    bool m_hasNext = false;
+    bool m_active = false;
+    qint64 m_firstUs = 0;
+    QElapsedTimer m_clock;
+    QTimer *m_timer = nullptr;
+};
+
+#endif // CANDUMPREADER_H
@@ -0,0 +1,59 @@
+#ifndef CANFRAMEPARSER_H
+#define CANFRAMEPARSER_H
+
+#include <cstring>
+#include "bridgecodec.h"
+
+// The bridge firmware forwards every received CAN message as a packed
+// STR_CANMSG_T. A single readyRead may carry several of them, or end in the
+// middle of one, so the parser keeps the tail until the rest arrives.
+class CanFrameParser
+{
+public:
+    void reset()
+    {
+        m_pending = 0;
+    }
+
+    // Bytes of an incomplete message kept from the last feed().
+    int pending() const { return m_pending; }
+
+    template<typename Handler>
+    void feed(const char *data, int size, Handler onFrame)
+    {
+        if (m_pending > 0) {
+            const int need = BridgeCodec::CanMessageSize - m_pending;
+            const int take = size < need ? size : need;
+            memcpy(m_partial + m_pending, data, take);
+            m_pending += take;
+            data += take;
+            size -= take;
+
+            if (m_pending < BridgeCodec::CanMessageSize)
+                return;
+
+            m_pending = 0;
+            STR_CANMSG_T frame;
+            BridgeCodec::decodeCanMessage(m_partial, BridgeCodec::CanMessageSize, &frame);
+            onFrame(frame);
+        }
+
+        STR_CANMSG_T frame;
+        while (BridgeCodec::decodeCanMessage(data, size, &frame)) {
+            data += BridgeCodec::CanMessageSize;
+            size -= BridgeCodec::CanMessageSize;
+            onFrame(frame);
+        }
+
+        if (size > 0) {
+            memcpy(m_partial, data, size);
+            m_pending = size;
+        }
+    }
+
+private:
+    char m_partial[BridgeCodec::CanMessageSize];
+    int m_pending = 0;
+};
+
+#endif // CANFRAMEPARSER_H
@@ -0,0 +1,298 @@
+#include "cangateway.h"
+#include "bridgecodec.h"
+#include "bridgeport.h"
+
+#include <QFile>
+#include <QRegularExpression>
+#include <QSerialPort>
+#include <QTimer>
+
+#include <cstring>
+
+enum {
+    ReadChunk = 4096,
+    StatsInterval = 1000    // ms
+};
+
+GatewayRuleTable::GatewayRuleTable()
+{
+    clear();
+}
+
+void GatewayRuleTable::clear()
+{
+    m_rules.clear();
+    for (int d = 0; d < 2; d++) {
+        m_stdIndex[d] = QVector<qint16>(StdIdCount, -1);
+        m_extIndex[d].clear();
+        m_default[d] = -1;
+    }
+}
+
+bool GatewayRuleTable::load(const QString &fileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorString)
+            *errorString = file.errorString();
+        return false;
+    }
+
+    return parse(QString::fromUtf8(file.readAll()), errorString);
+}
+
+static bool parseId(const QString &text, quint32 *id, bool *extended)
+{
+    QString digits = text;
+    *extended = digits.endsWith('x', Qt::CaseInsensitive);
+    if (*extended)
+        digits.chop(1);
+
+    bool ok = false;
+    *id = digits.toUInt(&ok, 16);
+    if (!ok || *id > 0x1FFFFFFF)
+        return false;
+    if (*id > 0x7FF)
+        *extended = true;
+    return true;
+}
+
+bool GatewayRuleTable::parse(const QString &text, QString *errorString)
+{
+    clear();
+
+    const QStringList lines = text.split('\n');
+    for (int n = 0; n < lines.size(); n++) {
+        const QString line = lines.at(n).section('#', 0, 0).trimmed();
+        if (line.isEmpty())
+            continue;
+
+        auto fail = [&](const QString &reason) {
+            if (errorString)
+                *errorString = QObject::tr("Line %1: %2").arg(n + 1).arg(reason);
+            clear();
+            return false;
+        };
+
+        const QStringList words = line.split(QRegularExpression("\\s+"));
+        if (words.size() < 3)
+            return fail(QObject::tr("expected <direction> <id> <action>"));
+
+        bool directions[2] = { false, false };
+        const QString dir = words.at(0).toUpper();
+        if (dir == "A>B")
+            directions[AtoB] = true;
+        else if (dir == "B>A")
+            directions[BtoA] = true;
+        else if (dir == "*")
+            directions[AtoB] = directions[BtoA] = true;
+        else
+            return fail(QObject::tr("unknown direction %1").arg(words.at(0)));
+
+        quint32 id = 0;
+        bool extended = false;
+        const bool isDefault = words.at(1) == "*";
+        if (!isDefault && !parseId(words.at(1), &id, &extended))
+            return fail(QObject::tr("invalid ID %1").arg(words.at(1)));
+
+        GatewayRule rule;
+        memset(&rule, 0, sizeof(rule));
+        for (int i = 2; i < words.size(); i++) {
+            const QString word = words.at(i).toLower();
+            if (word == "forward") {
+                continue;
+            } else if (word == "drop") {
+                rule.drop = true;
+            } else if (word == "rewrite" && i + 1 < words.size()) {
+                if (!parseId(words.at(++i), &rule.newId, &rule.newExtended))
+                    return fail(QObject::tr("invalid ID %1").arg(words.at(i)));
+                rule.rewrite = true;
+            } else if (word == "patch") {
+                // patch takes the remaining n=hh pairs
+                while (i + 1 < words.size() && words.at(i + 1).contains('=')) {
+                    const QStringList kv = words.at(++i).split('=');
+                    bool okIndex = false;
+                    bool okValue = false;
+                    const int index = kv.value(0).toInt(&okIndex);
+                    const uint value = kv.value(1).toUInt(&okValue, 16);
+                    if (!okIndex || !okValue || index < 0 || index > 7 || value > 0xFF)
+                        return fail(QObject::tr("invalid patch %1").arg(words.at(i)));
+                    rule.patchMask |= 1 << index;
+                    rule.patchLength = qMax<quint8>(rule.patchLength, index + 1);
+                    rule.patch[index] = static_cast<char>(value);
+                }
+            } else {
+                return fail(QObject::tr("unknown action %1").arg(words.at(i)));
+            }
+        }
+
+        const int index = m_rules.size();
+        m_rules.append(rule);
+        for (int d = 0; d < 2; d++) {
+            if (!directions[d])
+                continue;
+            if (isDefault)
+                m_default[d] = index;
+            else if (!extended && id < StdIdCount)
+                m_stdIndex[d][id] = static_cast<qint16>(index);
+            else
+                m_extIndex[d].insert(id, index);
+        }
+    }
+
+    return true;
+}
+
+CanGateway::CanGateway(QObject *parent) :
+    QObject(parent),
+    m_statsTimer(new QTimer(this))
+{
+    for (int i = 0; i < 2; i++) {
+        Side &side = m_sides[i];
+        side.port = new QSerialPort(this);
+        side.out.reserve(ReadChunk * 2);
+
+        connect(side.port, &QSerialPort::readyRead, [this, i]() {
+            forward(i);
+        });
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 8, 0))
+        connect(side.port, &QSerialPort::errorOccurred, [this, i](QSerialPort::SerialPortError error) {
+            if (m_active && error == QSerialPort::ResourceError) {
+                const QString reason = tr("Port %1 lost: %2").arg(i == 0 ? "A" : "B")
+                        .arg(m_sides[i].port->errorString());
+                stop();
+                emit stopped(reason);
+            }
+        });
+#endif
+    }
+
+    m_statsTimer->setInterval(StatsInterval);
+    connect(m_statsTimer, &QTimer::timeout, [this]() {
+        emit statisticsChanged(statistics());
+    });
+}
+
+CanGateway::~CanGateway()
+{
+    stop();
+}
+
+bool CanGateway::start(const BridgeConfig &portA, const BridgeConfig &portB,
+                       QString *errorString)
+{
+    stop();
+
+    const BridgeConfig *settings[2] = { &portA, &portB };
+    for (int i = 0; i < 2; i++) {
+        Side &side = m_sides[i];
+        side.parser.reset();
+        side.out.resize(0);
+        side.forwarded = 0;
+        side.dropped = 0;
+        side.rewritten = 0;
+        side.latency.reset();
+
+        if (!openBridgePort(side.port, *settings[i])) {
+            if (errorString)
+                *errorString = tr("%1: %2").arg(settings[i]->name).arg(side.port->errorString());
+            stop();
+            return false;
+        }
+    }
+
+    m_active = true;
+    m_clock.start();
+    m_statsTimer->start();
+    return true;
+}
+
+void CanGateway::stop()
+{
+    m_active = false;
+    m_statsTimer->stop();
+    for (Side &side : m_sides) {
+        if (side.port->isOpen())
+            side.port->close();
+    }
+}
+
+void CanGateway::forward(int from)
+{
+    Side &in = m_sides[from];
+    Side &out = m_sides[1 - from];
+    const GatewayRuleTable::Direction direction = from == 0 ? GatewayRuleTable::AtoB : GatewayRuleTable::BtoA;
+
+    // Frames are timed from the notification that brought them in, so a
+    // frame read in a later chunk also counts the earlier chunks' work.
+    const qint64 readyNs = m_clock.nsecsElapsed();
+
+    char buf[ReadChunk];
+    for (;;) {
+        const qint64 n = in.port->read(buf, sizeof(buf));
+        if (n <= 0)
+            break;
+
+        int batched = 0;
+
+        in.parser.feed(buf, static_cast<int>(n), [&](const STR_CANMSG_T &received) {
+            STR_CANMSG_T frame = received;
+            const GatewayRule *rule = m_rules.lookup(direction, frame);
+            if (rule != nullptr) {
+                if (rule->drop) {
+                    in.dropped++;
+                    return;
+                }
+                if (rule->rewrite) {
+                    frame.Id = rule->newId;
+                    frame.IdType = rule->newExtended ? CAN_EXT_ID : CAN_STD_ID;
+                }
+                const bool patch = rule->patchMask != 0 && frame.FrameType == CAN_DATA_FRAME;
+                if (patch) {
+                    // Bytes past the old DLC are undefined on the wire; clear them.
+                    for (int b = frame.DLC; b < rule->patchLength; b++)
+                        frame.Data[b] = 0;
+                    frame.DLC = qMax(frame.DLC, rule->patchLength);
+                    for (int b = 0; b < rule->patchLength; b++) {
+                        if (rule->patchMask & (1 << b))
+                            frame.Data[b] = rule->patch[b];
+                    }
+                }
+                if (rule->rewrite || patch)
+                    in.rewritten++;
+            }
+
+            const int pos = out.out.size();
+            out.out.resize(pos + BridgeCodec::CanDataSize);
+            BridgeCodec::encodeCanData(frame, out.out.data() + pos, BridgeCodec::CanDataSize);
+            batched++;
+        });
+
+        if (batched == 0)
+            continue;
+
+        out.port->write(out.out);
+        out.out.resize(0);
+
+        const qint64 latency = m_clock.nsecsElapsed() - readyNs;
+        for (int i = 0; i < batched; i++)
+            in.latency.record(latency);
+        in.forwarded += batched;
+    }
+}
+
+QString CanGateway::statistics() const
+{
+    QStringList parts;
+    static const char *const names[] = { "A>B", "B>A" };
+    for (int i = 0; i < 2; i++) {
+        const Side &side = m_sides[i];
+        parts << QString("%1 %2 fwd, %3 drop, %4 mod, p99 %5 us")
+                 .arg(names[i])
+                 .arg(side.forwarded)
+                 .arg(side.dropped)
+                 .arg(side.rewritten)
+                 .arg(side.latency.valueAtPercentile(99.0) / 1000);
+    }
+    return parts.join("; ");
+}
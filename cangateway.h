@@ -0,0 +1,124 @@
+#ifndef CANGATEWAY_H
+#define CANGATEWAY_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+#include "canframeparser.h"
+#include "latencystats.h"
+#include "bridgeport.h"
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+
+QT_END_NAMESPACE
+
+struct GatewayRule {
+    bool drop;
+    bool rewrite;
+    quint32 newId;
+    bool newExtended;
+    quint8 patchMask;       // bit n set: replace Data[n] with patch[n]
+    quint8 patchLength;     // highest patched byte + 1; shorter frames are extended
+    char patch[8];
+};
+
+// Per-direction rule table. Standard IDs index a flat 2048-entry table and
+// extended IDs a hash, so a lookup costs the same however many rules are
+// loaded. IDs without a rule use the direction's default ("*") rule, or
+// are forwarded unchanged.
+//
+// Text format, one rule per line, '#' starts a comment:
+//   <A>B|B>A|*>  <id|*>  forward | drop | [rewrite <id>] [patch <n>=<hh> ...]
+// IDs are hex; a trailing 'x' or a value above 0x7FF marks an extended ID.
+// A patch past a data frame's DLC extends the DLC, zero filling any bytes
+// in between; remote frames carry no data and are not patched.
+class GatewayRuleTable
+{
+public:
+    enum Direction {
+        AtoB,
+        BtoA
+    };
+
+    GatewayRuleTable();
+
+    bool load(const QString &fileName, QString *errorString = nullptr);
+    bool parse(const QString &text, QString *errorString = nullptr);
+    void clear();
+    int ruleCount() const { return m_rules.size(); }
+
+    const GatewayRule *lookup(Direction direction, const STR_CANMSG_T &frame) const
+    {
+        int index;
+        if (frame.IdType == CAN_STD_ID && frame.Id < StdIdCount)
+            index = m_stdIndex[direction].constData()[frame.Id];
+        else
+            index = m_extIndex[direction].value(frame.Id, -1);
+        if (index < 0)
+            index = m_default[direction];
+        return index >= 0 ? m_rules.constData() + index : nullptr;
+    }
+
+private:
+    enum {
+        StdIdCount = 0x800
+    };
+
+    QVector<GatewayRule> m_rules;
+    QVector<qint16> m_stdIndex[2];
+    QHash<quint32, int> m_extIndex[2];
+    int m_default[2];
+};
+
+// Forwards CAN traffic between two bridges through a GatewayRuleTable. Each
+// read is parsed, filtered and re-encoded as CAND into one batch that is
+// written to the other port in a single call. Host-side forwarding latency,
+// from the readyRead that delivered a frame to handing its CAND to the
+// other port, is recorded per frame and direction.
+class CanGateway : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CanGateway(QObject *parent = nullptr);
+    ~CanGateway();
+
+    bool isActive() const { return m_active; }
+
+    GatewayRuleTable *rules() { return &m_rules; }
+
+    bool start(const BridgeConfig &portA, const BridgeConfig &portB,
+               QString *errorString = nullptr);
+    void stop();
+
+    QString statistics() const;
+
+signals:
+    void statisticsChanged(const QString &text);
+    void stopped(const QString &reason);
+
+private:
+    struct Side {
+        QSerialPort *port;
+        CanFrameParser parser;
+        QByteArray out;             // CAND batch for this port
+        qint64 forwarded;           // frames received here and sent on
+        qint64 dropped;
+        qint64 rewritten;
+        LatencyHistogram latency;
+    };
+
+    void forward(int from);
+
+    Side m_sides[2];
+    GatewayRuleTable m_rules;
+    QElapsedTimer m_clock;
+    QTimer *m_statsTimer = nullptr;
+    bool m_active = false;
+};
+
+#endif // CANGATEWAY_H
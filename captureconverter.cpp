@@ -0,0 +1,407 @@
+#include "captureconverter.h"
+#include "bridgecodec.h"
+#include "bridgeport.h"
+#include "captureindex.h"
+#include "streamintegrity.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QLocale>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QtEndian>
+
+enum {
+    ChunkEntries = 16,                          // index entries per chunk, 16K records
+    IndexStep = CaptureIndex::Stride * 1024,
+    BytesPerRecord = 48                         // initial chunk buffer estimate
+};
+
+static const char HexDigits[] = "0123456789ABCDEF";
+
+struct ConvertChunk {
+    qint64 offset;
+    qint64 records;
+    qint32 brgMode;
+    StreamIntegrity::CanState can;
+};
+
+struct ConvertedChunk {
+    QByteArray text;
+    qint64 records;
+};
+
+struct ConvertContext {
+    QString captureName;
+    CaptureConverter::Format format;
+    qint64 startUs;             // time of the first record; ASC times are relative to it
+    const QAtomicInt *cancel;
+};
+
+static void appendDecimal(QByteArray &out, quint64 value, int minDigits = 1)
+{
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0 || n < minDigits);
+    while (n > 0)
+        out.append(digits[--n]);
+}
+
+static void appendHex(QByteArray &out, quint32 value, int digits)
+{
+    for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+        out.append(HexDigits[(value >> shift) & 0xF]);
+}
+
+static void appendHexBytes(QByteArray &out, const char *data, int size, bool spaced)
+{
+    for (int i = 0; i < size; i++) {
+        if (spaced && i > 0)
+            out.append(' ');
+        appendHex(out, quint8(data[i]), 2);
+    }
+}
+
+static int hexDigits(quint32 value)
+{
+    int digits = 1;
+    while (value >>= 4)
+        digits++;
+    return digits;
+}
+
+// seconds.microseconds
+static void appendSeconds(QByteArray &out, qint64 timeUs)
+{
+    appendDecimal(out, static_cast<quint64>(timeUs / 1000000));
+    out.append('.');
+    appendDecimal(out, static_cast<quint64>(timeUs % 1000000), 6);
+}
+
+static void appendPadding(QByteArray &out, int from, int width)
+{
+    for (int n = out.size() - from; n < width; n++)
+        out.append(' ');
+}
+
+class ChunkWriter
+{
+public:
+    ChunkWriter(const ConvertContext &context, QByteArray *out) :
+        m_context(context),
+        m_out(*out)
+    {
+    }
+
+    void canFrame(qint64 timeUs, const STR_CANMSG_T &msg, bool tx)
+    {
+        const bool extended = msg.IdType == CAN_EXT_ID;
+        const bool remote = msg.FrameType == CAN_REMOTE_FRAME;
+        const int dlc = msg.DLC > 8 ? 8 : msg.DLC;
+
+        switch (m_context.format) {
+        case CaptureConverter::Csv:
+            appendDecimal(m_out, static_cast<quint64>(timeUs));
+            m_out.append(tx ? ",tx," : ",rx,");
+            appendHex(m_out, msg.Id, extended ? 8 : 3);
+            m_out.append(extended ? ",1," : ",0,");
+            m_out.append(remote ? "1," : "0,");
+            appendDecimal(m_out, dlc);
+            m_out.append(',');
+            if (!remote)
+                appendHexBytes(m_out, msg.Data, dlc, false);
+            break;
+        case CaptureConverter::Candump:
+            m_out.append('(');
+            appendSeconds(m_out, timeUs);
+            m_out.append(") can0 ");
+            appendHex(m_out, msg.Id, extended ? 8 : 3);
+            m_out.append('#');
+            if (remote)
+                m_out.append('R');
+            else
+                appendHexBytes(m_out, msg.Data, dlc, false);
+            break;
+        case CaptureConverter::Asc: {
+            int start = m_out.size();
+            appendSeconds(m_out, qMax(qint64(0), timeUs - m_context.startUs));
+            m_out.insert(start, QByteArray(qMax(0, 11 - (m_out.size() - start)), ' '));
+            m_out.append(" 1  ");
+            start = m_out.size();
+            appendHex(m_out, msg.Id, hexDigits(msg.Id));
+            if (extended)
+                m_out.append('x');
+            appendPadding(m_out, start, 15);
+            m_out.append(tx ? " Tx   " : " Rx   ");
+            if (remote) {
+                m_out.append('r');
+            } else {
+                m_out.append("d ");
+                appendDecimal(m_out, dlc);
+                if (dlc > 0)
+                    m_out.append(' ');
+                appendHexBytes(m_out, msg.Data, dlc, true);
+            }
+            break;
+        }
+        }
+        m_out.append('\n');
+    }
+
+    // Non-CAN records only appear in CSV.
+    void record(const CaptureRecord &record)
+    {
+        if (m_context.format != CaptureConverter::Csv)
+            return;
+
+        static const char *const names[] = { "?", "session", "rx", "tx", "gap", "marker", "can" };
+        appendDecimal(m_out, static_cast<quint64>(record.timeUs));
+        m_out.append(',');
+        m_out.append(names[record.type <= CaptureCanFrame ? record.type : 0]);
+        m_out.append(",,,,,");
+
+        const uchar *payload = reinterpret_cast<const uchar *>(record.payload);
+        switch (record.type) {
+        case CaptureSession:
+            if (record.size >= 8) {
+                appendDecimal(m_out, qFromLittleEndian<quint32>(payload));
+                m_out.append(' ');
+                appendDecimal(m_out, qFromLittleEndian<quint32>(payload + 4));
+                m_out.append(' ');
+                m_out.append(record.payload + 8, static_cast<int>(record.size) - 8);
+            }
+            break;
+        case CaptureGap:
+            if (record.size >= 8)
+                appendDecimal(m_out, qFromLittleEndian<quint64>(payload));
+            break;
+        case CaptureMarker:
+            m_out.append('"');
+            for (quint32 i = 0; i < record.size; i++) {
+                if (record.payload[i] == '"')
+                    m_out.append('"');
+                m_out.append(record.payload[i]);
+            }
+            m_out.append('"');
+            break;
+        default:
+            appendHexBytes(m_out, record.payload, static_cast<int>(record.size), false);
+            break;
+        }
+        m_out.append('\n');
+    }
+
+private:
+    const ConvertContext &m_context;
+    QByteArray &m_out;
+};
+
+static ConvertedChunk formatChunk(const ConvertContext &context, const ConvertChunk &chunk)
+{
+    ConvertedChunk result = { QByteArray(), chunk.records };
+    CaptureReader reader;
+    if (context.cancel->load() != 0 || !reader.open(context.captureName))
+        return result;
+
+    result.text.reserve(static_cast<int>(chunk.records * BytesPerRecord));
+    ChunkWriter writer(context, &result.text);
+    // Decodes Rx bytes like the application did, resyncing past damaged
+    // records, starting from the state the index kept for this chunk. A
+    // message split across chunks is reported by the chunk it ends in.
+    StreamIntegrity decoder;
+    decoder.setCanState(chunk.can);
+    qint32 mode = chunk.brgMode;
+
+    CaptureRecord record;
+    STR_CANMSG_T msg;
+    auto received = [&](const STR_CANMSG_T &frame) {
+        writer.canFrame(record.timeUs, frame, false);
+    };
+
+    qint64 offset = chunk.offset;
+    for (qint64 i = 0; i < chunk.records; i++) {
+        offset = reader.readRecord(offset, &record);
+        if (offset < 0)
+            break;
+
+        const int size = static_cast<int>(record.size);
+        switch (record.type) {
+        case CaptureSession:
+            if (size >= 4)
+                mode = qFromLittleEndian<qint32>(reinterpret_cast<const uchar *>(record.payload));
+            decoder.reset();
+            writer.record(record);
+            break;
+        case CaptureGap:
+            decoder.reset();
+            writer.record(record);
+            break;
+        case CaptureRx:
+            if (mode == BRG_MODE_CAN) {
+                decoder.feedCan(record.payload, size, record.timeUs, received);
+                if (decoder.hasEvents())
+                    decoder.takeEvents();
+            } else {
+                writer.record(record);
+            }
+            break;
+        case CaptureTx:
+            if (mode == BRG_MODE_CAN && size > 0 && size % BridgeCodec::CanDataSize == 0
+                    && BridgeCodec::decodeCanData(record.payload, size, &msg)) {
+                for (int at = 0; at < size; at += BridgeCodec::CanDataSize) {
+                    if (BridgeCodec::decodeCanData(record.payload + at, BridgeCodec::CanDataSize, &msg))
+                        writer.canFrame(record.timeUs, msg, true);
+                }
+            } else {
+                writer.record(record);
+            }
+            break;
+        case CaptureCanFrame:
+            if (BridgeCodec::decodeCanMessage(record.payload, size, &msg))
+                writer.canFrame(record.timeUs, msg, false);
+            break;
+        default:
+            writer.record(record);
+            break;
+        }
+    }
+
+    return result;
+}
+
+struct FormatChunk {
+    typedef ConvertedChunk result_type;
+
+    const ConvertContext *context;
+
+    ConvertedChunk operator()(const ConvertChunk &chunk) const
+    {
+        return formatChunk(*context, chunk);
+    }
+};
+
+struct WriteChunk {
+    QIODevice *out;
+    CaptureConverter *converter;
+    const QAtomicInt *cancel;
+    qint64 total;
+
+    void operator()(qint64 &done, const ConvertedChunk &chunk)
+    {
+        if (cancel->load() != 0)
+            return;
+        if (out->write(chunk.text) != chunk.text.size()) {
+            converter->cancel();
+            return;
+        }
+        done += chunk.records;
+        emit converter->progress(done, total);
+    }
+};
+
+CaptureConverter::CaptureConverter(QObject *parent) :
+    QObject(parent)
+{
+}
+
+bool CaptureConverter::formatFromName(const QString &name, Format *format)
+{
+    const QString lower = name.toLower();
+    if (lower == "csv")
+        *format = Csv;
+    else if (lower == "candump" || lower == "log")
+        *format = Candump;
+    else if (lower == "asc")
+        *format = Asc;
+    else
+        return false;
+    return true;
+}
+
+QString CaptureConverter::fileSuffix(Format format)
+{
+    switch (format) {
+    case Candump:
+        return "log";
+    case Asc:
+        return "asc";
+    default:
+        return "csv";
+    }
+}
+
+bool CaptureConverter::convert(const QString &captureName, const QString &outputName, Format format,
+                               QString *errorString)
+{
+    m_cancel.store(0);
+    auto fail = [errorString](const QString &reason) {
+        if (errorString)
+            *errorString = reason;
+        return false;
+    };
+
+    CaptureReader reader;
+    if (!reader.open(captureName))
+        return fail(reader.errorString());
+
+    // Chunks start at index entries, each with the CAN decoder state there.
+    CaptureIndex index;
+    const QString indexName = CaptureIndex::indexFileName(captureName);
+    const bool loaded = index.load(indexName, reader);
+    const qint64 known = index.recordCount();
+    while (index.extend(reader, IndexStep) == IndexStep) {
+        if (m_cancel.load() != 0)
+            return fail(tr("Cancelled"));
+    }
+    if (!loaded || index.recordCount() > known)
+        index.save(indexName);
+
+    const QVector<CaptureIndex::Entry> &entries = index.entries();
+    QVector<ConvertChunk> chunks;
+    for (int i = 0; i < entries.size(); i += ChunkEntries) {
+        const qint64 firstRow = qint64(i) * CaptureIndex::Stride;
+        const CaptureIndex::Entry &entry = entries.at(i);
+        chunks.append({ entry.offset, qMin(qint64(ChunkEntries) * CaptureIndex::Stride, index.recordCount() - firstRow),
+                        entry.brgMode, entry.can });
+    }
+
+    QSaveFile out(outputName);
+    if (!out.open(QIODevice::WriteOnly))
+        return fail(out.errorString());
+
+    const qint64 startUs = entries.isEmpty() ? 0 : entries.first().timeUs;
+    if (format == Csv) {
+        out.write("time_us,record,id,extended,remote,dlc,data\n");
+    } else if (format == Asc) {
+        const QString start = QLocale::c().toString(QDateTime::fromMSecsSinceEpoch(startUs / 1000),
+                                                    "ddd MMM dd hh:mm:ss.zzz ap yyyy");
+        out.write(QString("date %1\n"
+                          "base hex  timestamps absolute\n"
+                          "internal events logged\n"
+                          "// version 9.0.0\n"
+                          "Begin Triggerblock %1\n"
+                          "   0.000000 Start of measurement\n").arg(start).toLatin1());
+    }
+
+    const ConvertContext context = { captureName, format, startUs, &m_cancel };
+    const WriteChunk write = { &out, this, &m_cancel, index.recordCount() };
+    // Ordered reduction writes chunk n only after chunk n - 1, and throttles
+    // the formatters when finished chunks queue up behind a slow one.
+    QtConcurrent::mappedReduced<qint64>(chunks, FormatChunk{ &context }, write,
+                                        QtConcurrent::OrderedReduce | QtConcurrent::SequentialReduce)
+            .waitForFinished();
+
+    if (m_cancel.load() != 0) {
+        out.cancelWriting();
+        return fail(out.error() != QFileDevice::NoError ? out.errorString() : tr("Cancelled"));
+    }
+
+    if (format == Asc)
+        out.write("End TriggerBlock\n");
+    if (!out.commit())
+        return fail(out.errorString());
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef CAPTURECONVERTER_H
+#define CAPTURECONVERTER_H
+
+#include <QAtomicInt>
+#include <QObject>
+
+// Converts a NUCP capture to text. The capture is split at sparse index
+// entries into record-aligned chunks that are formatted on the global
+// thread pool, each into its own buffer, and written out in order.
+//
+//   Csv      every record; CAN traffic one line per frame
+//   Candump  CAN frames in the can-utils log format (candump -l, canplayer)
+//   Asc      CAN frames in the Vector ASCII log format
+class CaptureConverter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format {
+        Csv,
+        Candump,
+        Asc
+    };
+
+    explicit CaptureConverter(QObject *parent = nullptr);
+
+    static bool formatFromName(const QString &name, Format *format);
+    static QString fileSuffix(Format format);
+
+    // Blocks until done; may be called from any thread. progress() is
+    // emitted from the pool threads as chunks are written.
+    bool convert(const QString &captureName, const QString &outputName, Format format,
+                 QString *errorString = nullptr);
+    void cancel() { m_cancel.store(1); }
+
+signals:
+    void progress(qint64 recordsDone, qint64 recordsTotal);
+
+private:
+    QAtomicInt m_cancel;
+};
+
+#endif // CAPTURECONVERTER_H
@@ -0,0 +1,183 @@
+#include "capturefile.h"
+#include "tracerecorder.h"
+
+#include <QDateTime>
+#include <QtEndian>
+
+#include <cstring>
+
+enum : qint64 {
+    MapGranularity = 1 << 20,   // multiple of every platform's mapping alignment
+    MapWindow = 64 << 20
+};
+
+CaptureWriter::CaptureWriter()
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::open(const QString &fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return false;
+
+    if (m_file.size() == 0) {
+        uchar header[CaptureFileHeaderSize] = {'N', 'U', 'C', 'P'};
+        qToLittleEndian<quint32>(CaptureVersion, header + 4);
+        m_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    }
+
+    // Timestamps are wall clock at open plus a monotonic offset, so they stay
+    // ordered even if the system clock is adjusted during a capture.
+    m_baseUs = QDateTime::currentMSecsSinceEpoch() * 1000;
+    m_clock.start();
+    return true;
+}
+
+void CaptureWriter::close()
+{
+    if (m_file.isOpen())
+        m_file.close();
+}
+
+qint64 CaptureWriter::currentTimeUs() const
+{
+    return m_baseUs + m_clock.nsecsElapsed() / 1000;
+}
+
+void CaptureWriter::writeRecord(CaptureRecordType type, const char *data, int size)
+{
+    if (!m_file.isOpen())
+        return;
+
+    TRACE_ZONE("capture.write");
+    uchar header[CaptureRecordHeaderSize];
+    qToLittleEndian<quint64>(currentTimeUs(), header);
+    qToLittleEndian<quint16>(type, header + 8);
+    qToLittleEndian<quint16>(0, header + 10);
+    qToLittleEndian<quint32>(size, header + 12);
+
+    m_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    if (size > 0)
+        m_file.write(data, size);
+}
+
+QByteArray CaptureWriter::sessionPayload(int brgMode, qint32 baudRate, const QString &portName)
+{
+    QByteArray payload(8, 0);
+    qToLittleEndian<quint32>(brgMode, payload.data());
+    qToLittleEndian<quint32>(baudRate, payload.data() + 4);
+    payload.append(portName.toUtf8());
+    return payload;
+}
+
+void CaptureWriter::writeSession(int brgMode, qint32 baudRate, const QString &portName)
+{
+    writeRecord(CaptureSession, sessionPayload(brgMode, baudRate, portName));
+}
+
+void CaptureWriter::writeGap(qint64 downtimeUs)
+{
+    char payload[8];
+    qToLittleEndian<quint64>(downtimeUs, payload);
+    writeRecord(CaptureGap, payload, sizeof(payload));
+}
+
+CaptureReader::CaptureReader()
+{
+}
+
+CaptureReader::~CaptureReader()
+{
+    close();
+}
+
+bool CaptureReader::open(const QString &fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    char header[CaptureFileHeaderSize];
+    if (m_file.read(header, sizeof(header)) != sizeof(header) || memcmp(header, "NUCP", 4) != 0
+            || qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(header) + 4) != CaptureVersion) {
+        m_errorString = QObject::tr("%1 is not a capture file").arg(fileName);
+        m_file.close();
+        return false;
+    }
+
+    m_size = m_file.size();
+    return true;
+}
+
+void CaptureReader::close()
+{
+    if (m_window != nullptr) {
+        m_file.unmap(m_window);
+        m_window = nullptr;
+        m_windowSize = 0;
+    }
+    if (m_file.isOpen())
+        m_file.close();
+    m_size = 0;
+}
+
+const uchar *CaptureReader::map(qint64 offset, qint64 size) const
+{
+    if (m_window != nullptr && offset >= m_windowOffset && offset + size <= m_windowOffset + m_windowSize)
+        return m_window + (offset - m_windowOffset);
+
+    if (m_window != nullptr) {
+        m_file.unmap(m_window);
+        m_window = nullptr;
+        m_windowSize = 0;
+    }
+
+    const qint64 base = offset & ~(MapGranularity - 1);
+    const qint64 length = qMin(m_size - base, qMax(MapWindow, offset + size - base));
+    m_window = m_file.map(base, length);
+    if (m_window == nullptr)
+        return nullptr;
+
+    m_windowOffset = base;
+    m_windowSize = length;
+    return m_window + (offset - base);
+}
+
+qint64 CaptureReader::readRecord(qint64 offset, CaptureRecord *record) const
+{
+    if (offset < CaptureFileHeaderSize || offset + CaptureRecordHeaderSize > m_size)
+        return -1;
+
+    const uchar *header = map(offset, CaptureRecordHeaderSize);
+    if (header == nullptr)
+        return -1;
+
+    const quint32 size = qFromLittleEndian<quint32>(header + 12);
+    const qint64 next = offset + CaptureRecordHeaderSize + size;
+    if (next > m_size)
+        return -1;
+
+    // Mapping the whole record may move the window.
+    header = map(offset, CaptureRecordHeaderSize + size);
+    if (header == nullptr)
+        return -1;
+
+    record->timeUs = static_cast<qint64>(qFromLittleEndian<quint64>(header));
+    record->type = qFromLittleEndian<quint16>(header + 8);
+    record->flags = qFromLittleEndian<quint16>(header + 10);
+    record->size = size;
+    record->payload = reinterpret_cast<const char *>(header + CaptureRecordHeaderSize);
+    return next;
+}
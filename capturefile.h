@@ -0,0 +1,93 @@
+#ifndef CAPTUREFILE_H
+#define CAPTUREFILE_H
+
+#include <QElapsedTimer>
+#include <QFile>
+
+// Binary capture layout, all fields little-endian:
+//   file header:   "NUCP", quint32 version
+//   each record:   quint64 timestamp (us since epoch), quint16 type,
+//                  quint16 flags, quint32 length, then length payload bytes
+enum {
+    CaptureVersion = 1,
+    CaptureFileHeaderSize = 8,
+    CaptureRecordHeaderSize = 16
+};
+
+enum CaptureRecordType {
+    CaptureSession = 1,     // quint32 brgMode, quint32 baudRate, port name
+    CaptureRx = 2,          // bytes received from the bridge
+    CaptureTx = 3,          // bytes written to the bridge
+    CaptureGap = 4,         // quint64 downtime in us, link was lost before this
+    CaptureMarker = 5,      // free text
+    CaptureCanFrame = 6     // one received CAN message, packed STR_CANMSG_T
+};
+
+class CaptureWriter
+{
+public:
+    CaptureWriter();
+    ~CaptureWriter();
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString errorString() const { return m_file.errorString(); }
+
+    qint64 currentTimeUs() const;
+
+    void writeRecord(CaptureRecordType type, const char *data, int size);
+    void writeRecord(CaptureRecordType type, const QByteArray &data)
+    {
+        writeRecord(type, data.constData(), data.size());
+    }
+    void writeSession(int brgMode, qint32 baudRate, const QString &portName);
+    static QByteArray sessionPayload(int brgMode, qint32 baudRate, const QString &portName);
+    void writeGap(qint64 downtimeUs);
+
+private:
+    QFile m_file;
+    QElapsedTimer m_clock;
+    qint64 m_baseUs = 0;
+};
+
+struct CaptureRecord {
+    qint64 timeUs;
+    quint16 type;
+    quint16 flags;
+    quint32 size;
+    const char *payload;    // valid until the next readRecord()
+};
+
+// Reads a capture through a sliding memory-mapped window, so only the
+// window's pages are ever resident however large the file is. A record
+// that does not fit the current window moves the window to it.
+class CaptureReader
+{
+public:
+    CaptureReader();
+    ~CaptureReader();
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString errorString() const { return m_errorString; }
+    QString fileName() const { return m_file.fileName(); }
+    qint64 size() const { return m_size; }
+
+    // Decodes the record at offset and returns the offset of the next one,
+    // or -1 at the end of the file or a truncated record.
+    qint64 readRecord(qint64 offset, CaptureRecord *record) const;
+
+private:
+    const uchar *map(qint64 offset, qint64 size) const;
+
+    mutable QFile m_file;
+    QString m_errorString;
+    qint64 m_size = 0;
+    mutable uchar *m_window = nullptr;
+    mutable qint64 m_windowOffset = 0;
+    mutable qint64 m_windowSize = 0;
+};
+
+#endif // CAPTUREFILE_H
@@ -0,0 +1,220 @@
+#include "captureindex.h"
+#include "bridgeport.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+enum {
+    IndexVersion = 3
+};
+
+static void writeCanState(QDataStream &out, const StreamIntegrity::CanState &state)
+{
+    out << state.pending << state.lostKind;
+    out.writeRawData(state.bytes, sizeof(state.bytes));
+}
+
+static void readCanState(QDataStream &in, StreamIntegrity::CanState *state)
+{
+    in >> state->pending >> state->lostKind;
+    if (in.readRawData(state->bytes, sizeof(state->bytes)) != int(sizeof(state->bytes)))
+        in.setStatus(QDataStream::ReadPastEnd);
+}
+
+CaptureIndex::CaptureIndex()
+{
+    clear();
+}
+
+void CaptureIndex::clear()
+{
+    m_entries.clear();
+    m_firstEntry = 0;
+    m_records = 0;
+    m_endOffset = CaptureFileHeaderSize;
+    m_brgMode = 0;
+    m_can = StreamIntegrity().canState();
+}
+
+qint64 CaptureIndex::extend(const CaptureReader &reader, qint64 maxRecords)
+{
+    // Runs the receive decoder the way the application did, one Rx record
+    // per read, so the state kept at each entry is the one it had there.
+    StreamIntegrity decoder;
+    decoder.setCanState(m_can);
+
+    CaptureRecord record;
+    qint64 done = 0;
+    while (done < maxRecords) {
+        const qint64 next = reader.readRecord(m_endOffset, &record);
+        if (next < 0)
+            break;
+
+        if (m_records % Stride == 0)
+            m_entries.append({ record.timeUs, m_endOffset, m_brgMode, decoder.canState() });
+
+        // The application restarts its CAN decoder with every session and
+        // after every reconnect.
+        switch (record.type) {
+        case CaptureSession:
+            if (record.size >= 4)
+                m_brgMode = qFromLittleEndian<qint32>(reinterpret_cast<const uchar *>(record.payload));
+            decoder.reset();
+            break;
+        case CaptureGap:
+            decoder.reset();
+            break;
+        case CaptureRx:
+            if (m_brgMode == BRG_MODE_CAN)
+                decoder.feedCan(record.payload, static_cast<int>(record.size), 0, [](const STR_CANMSG_T &) {});
+            break;
+        default:
+            break;
+        }
+        if (decoder.hasEvents())
+            decoder.takeEvents();
+
+        m_endOffset = next;
+        m_records++;
+        done++;
+    }
+    m_can = decoder.canState();
+    return done;
+}
+
+CaptureIndex CaptureIndex::continuation() const
+{
+    CaptureIndex next;
+    next.m_firstEntry = (m_records + Stride - 1) / Stride;
+    next.m_records = m_records;
+    next.m_endOffset = m_endOffset;
+    next.m_brgMode = m_brgMode;
+    next.m_can = m_can;
+    return next;
+}
+
+void CaptureIndex::append(const CaptureIndex &continued)
+{
+    Q_ASSERT(continued.m_firstEntry == m_firstEntry + m_entries.size());
+    m_entries += continued.m_entries;
+    m_records = continued.m_records;
+    m_endOffset = continued.m_endOffset;
+    m_brgMode = continued.m_brgMode;
+    m_can = continued.m_can;
+}
+
+qint64 CaptureIndex::findRow(const CaptureReader &reader, qint64 row, qint32 *brgMode) const
+{
+    const qint64 entry = row / Stride - m_firstEntry;
+    if (row < 0 || row >= m_records || entry < 0 || entry >= m_entries.size())
+        return -1;
+
+    qint64 offset = m_entries.at(entry).offset;
+    qint32 mode = m_entries.at(entry).brgMode;
+    CaptureRecord record;
+    for (qint64 skip = row % Stride; skip > 0; skip--) {
+        offset = reader.readRecord(offset, &record);
+        if (offset < 0)
+            return -1;
+        if (record.type == CaptureSession && record.size >= 4)
+            mode = qFromLittleEndian<qint32>(reinterpret_cast<const uchar *>(record.payload));
+    }
+
+    if (brgMode)
+        *brgMode = mode;
+    return offset;
+}
+
+qint64 CaptureIndex::rowForTime(const CaptureReader &reader, qint64 timeUs) const
+{
+    if (m_entries.isEmpty())
+        return m_records;
+
+    // The last entry starting before timeUs; its block holds the answer
+    // unless the answer is the first record of the next block.
+    auto it = std::lower_bound(m_entries.constBegin(), m_entries.constEnd(), timeUs,
+                               [](const Entry &entry, qint64 time) { return entry.timeUs < time; });
+    if (it != m_entries.constBegin())
+        --it;
+
+    qint64 row = (m_firstEntry + (it - m_entries.constBegin())) * Stride;
+    qint64 offset = it->offset;
+    CaptureRecord record;
+    while (row < m_records) {
+        const qint64 next = reader.readRecord(offset, &record);
+        if (next < 0 || record.timeUs >= timeUs)
+            break;
+        offset = next;
+        row++;
+    }
+    return row;
+}
+
+bool CaptureIndex::load(const QString &fileName, const CaptureReader &reader)
+{
+    clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    char magic[4];
+    quint32 version = 0;
+    quint32 stride = 0;
+    quint32 count = 0;
+    if (in.readRawData(magic, 4) != 4 || memcmp(magic, "NUCX", 4) != 0)
+        return false;
+    in >> version >> stride >> m_records >> m_endOffset >> m_brgMode;
+    readCanState(in, &m_can);
+    in >> count;
+    if (version != IndexVersion || stride != Stride || m_endOffset > reader.size()
+            || count != static_cast<quint32>((m_records + Stride - 1) / Stride)) {
+        clear();
+        return false;
+    }
+
+    m_entries.resize(static_cast<int>(count));
+    for (Entry &entry : m_entries) {
+        in >> entry.timeUs >> entry.offset >> entry.brgMode;
+        readCanState(in, &entry.can);
+    }
+
+    // A different capture under the same name won't have the same record
+    // at the last entry.
+    CaptureRecord record;
+    if (in.status() != QDataStream::Ok
+            || (!m_entries.isEmpty() && (reader.readRecord(m_entries.last().offset, &record) < 0
+                                         || record.timeUs != m_entries.last().timeUs))) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool CaptureIndex::save(const QString &fileName) const
+{
+    Q_ASSERT(m_firstEntry == 0);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("NUCX", 4);
+    out << quint32(IndexVersion) << quint32(Stride) << m_records << m_endOffset << m_brgMode;
+    writeCanState(out, m_can);
+    out << quint32(m_entries.size());
+    for (const Entry &entry : m_entries) {
+        out << entry.timeUs << entry.offset << entry.brgMode;
+        writeCanState(out, entry.can);
+    }
+    return out.status() == QDataStream::Ok;
+}
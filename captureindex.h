@@ -0,0 +1,63 @@
+#ifndef CAPTUREINDEX_H
+#define CAPTUREINDEX_H
+
+#include <QVector>
+
+#include "capturefile.h"
+#include "streamintegrity.h"
+
+// Sparse index over a capture: one entry per Stride records holding the
+// record's time and offset, the bridge mode in effect there and, in CAN
+// mode, the receive decoder's state before the record, so decoding can
+// start at any entry and match the live resync exactly. Finding a
+// row or a timestamp is a binary search over the entries plus a walk of at
+// most Stride - 1 record headers. Indexing can be resumed, also after the
+// capture has grown, and the index saved next to the capture.
+class CaptureIndex
+{
+public:
+    enum { Stride = 1024 };
+
+    struct Entry {
+        qint64 timeUs;
+        qint64 offset;
+        qint32 brgMode;
+        StreamIntegrity::CanState can;
+    };
+
+    CaptureIndex();
+
+    void clear();
+
+    qint64 recordCount() const { return m_records; }
+    qint64 endOffset() const { return m_endOffset; }
+    const QVector<Entry> &entries() const { return m_entries; }
+
+    // Indexes up to maxRecords more records. Returns the number indexed;
+    // fewer than maxRecords means the end of the file was reached.
+    qint64 extend(const CaptureReader &reader, qint64 maxRecords);
+
+    // An empty index that extend() continues from where this one stopped;
+    // append() adds what it indexed to this one.
+    CaptureIndex continuation() const;
+    void append(const CaptureIndex &continued);
+
+    // Offset and bridge mode of a record, or -1 if row is not indexed.
+    qint64 findRow(const CaptureReader &reader, qint64 row, qint32 *brgMode = nullptr) const;
+    // First record at or after timeUs; recordCount() if there is none.
+    qint64 rowForTime(const CaptureReader &reader, qint64 timeUs) const;
+
+    static QString indexFileName(const QString &captureFileName) { return captureFileName + ".idx"; }
+    bool load(const QString &fileName, const CaptureReader &reader);
+    bool save(const QString &fileName) const;
+
+private:
+    QVector<Entry> m_entries;
+    qint64 m_firstEntry = 0;        // number of m_entries[0] in the whole index
+    qint64 m_records = 0;
+    qint64 m_endOffset = CaptureFileHeaderSize;
+    qint32 m_brgMode = 0;           // mode in effect at m_endOffset
+    StreamIntegrity::CanState m_can;
+};
+
+#endif // CAPTUREINDEX_H
@@ -0,0 +1,395 @@
+#include "captureviewer.h"
+#include "bridgecodec.h"
+#include "bridgeport.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QTableView>
+#include <QVBoxLayout>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <climits>
+
+enum {
+    FirstChunk = CaptureIndex::Stride * 4,      // records, enough for the first screen
+    MaxChunk = CaptureIndex::Stride * 1024,
+    MaxHexBytes = 48
+};
+
+static QString formatTime(qint64 timeUs)
+{
+    return QDateTime::fromMSecsSinceEpoch(timeUs / 1000).toString("yyyy-MM-dd hh:mm:ss.zzz")
+            + QString("%1").arg(timeUs % 1000, 3, 10, QChar('0'));
+}
+
+static QString formatCanMessage(const STR_CANMSG_T &msg)
+{
+    QString text = QString("%1%2 [%3]")
+            .arg(msg.Id, msg.IdType == CAN_EXT_ID ? 8 : 3, 16, QChar('0'))
+            .arg(msg.FrameType == CAN_REMOTE_FRAME ? " R" : "")
+            .arg(msg.DLC);
+    if (msg.FrameType != CAN_REMOTE_FRAME) {
+        for (int i = 0; i < msg.DLC && i < 8; i++)
+            text += QString(" %1").arg(uint(quint8(msg.Data[i])), 2, 16, QChar('0'));
+    }
+    return text.toUpper();
+}
+
+static QString formatHex(const char *data, int size)
+{
+    QString text = QString::fromLatin1(QByteArray::fromRawData(data, qMin(size, int(MaxHexBytes))).toHex().toUpper());
+    for (int i = text.size() - 2; i > 0; i -= 2)
+        text.insert(i, ' ');
+    if (size > MaxHexBytes)
+        text += QString::fromUtf8(" …");
+    return text;
+}
+
+// CAN traffic is decoded when the record holds whole messages: received
+// data as packed STR_CANMSG_T, sent data as CAND.
+static QString formatPayload(const CaptureRecord &record, qint32 brgMode)
+{
+    const char *data = record.payload;
+    const int size = static_cast<int>(record.size);
+    STR_CANMSG_T msg;
+
+    switch (record.type) {
+    case CaptureSession: {
+        static const char *const modes[] = { "CAN", "I2C", "SPI" };
+        if (size < 8)
+            break;
+        const quint32 mode = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data));
+        return QString("%1 %2 %3")
+                .arg(mode < 3 ? modes[mode] : "?")
+                .arg(qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data) + 4))
+                .arg(QString::fromUtf8(data + 8, size - 8));
+    }
+    case CaptureGap:
+        if (size < 8)
+            break;
+        return QObject::tr("Link down for %1 ms")
+                .arg(qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(data)) / 1000);
+    case CaptureMarker:
+        return QString::fromUtf8(data, size);
+    case CaptureCanFrame:
+        if (BridgeCodec::decodeCanMessage(data, size, &msg))
+            return formatCanMessage(msg);
+        break;
+    case CaptureRx:
+        if (brgMode == BRG_MODE_CAN && size > 0 && size % BridgeCodec::CanMessageSize == 0) {
+            QStringList frames;
+            for (int i = 0; i < size; i += BridgeCodec::CanMessageSize) {
+                BridgeCodec::decodeCanMessage(data + i, BridgeCodec::CanMessageSize, &msg);
+                frames << formatCanMessage(msg);
+            }
+            return frames.join(" | ");
+        }
+        break;
+    case CaptureTx:
+        if (brgMode == BRG_MODE_CAN && size > 0 && size % BridgeCodec::CanDataSize == 0) {
+            QStringList frames;
+            for (int i = 0; i < size; i += BridgeCodec::CanDataSize) {
+                if (!BridgeCodec::decodeCanData(data + i, BridgeCodec::CanDataSize, &msg))
+                    return formatHex(data, size);
+                frames << formatCanMessage(msg);
+            }
+            return frames.join(" | ");
+        }
+        break;
+    default:
+        break;
+    }
+
+    return formatHex(data, size);
+}
+
+CaptureModel::CaptureModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+}
+
+bool CaptureModel::open(const QString &fileName, QString *errorString)
+{
+    beginResetModel();
+    m_index.clear();
+    m_cachedRow = -1;
+    const bool ok = m_reader.open(fileName);
+    endResetModel();
+
+    if (!ok && errorString)
+        *errorString = m_reader.errorString();
+    return ok;
+}
+
+void CaptureModel::setCaptureIndex(const CaptureIndex &index)
+{
+    beginResetModel();
+    m_index = index;
+    m_cachedRow = -1;
+    endResetModel();
+}
+
+void CaptureModel::appendIndex(const CaptureIndex &continued)
+{
+    const int first = rowCount();
+    const qint64 records = continued.recordCount();
+    const int last = static_cast<int>(qMin(records, qint64(INT_MAX))) - 1;
+    if (last < first) {
+        m_index.append(continued);
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), first, last);
+    m_index.append(continued);
+    endInsertRows();
+}
+
+qint64 CaptureModel::firstTimeUs() const
+{
+    const QVector<CaptureIndex::Entry> &entries = m_index.entries();
+    return entries.isEmpty() ? 0 : entries.first().timeUs;
+}
+
+int CaptureModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(qMin(m_index.recordCount(), qint64(INT_MAX)));
+}
+
+int CaptureModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+bool CaptureModel::locate(qint64 row, CaptureRecord *record, qint32 *brgMode) const
+{
+    const bool sameBlock = m_cachedRow >= 0 && row >= m_cachedRow
+            && row / CaptureIndex::Stride == m_cachedRow / CaptureIndex::Stride;
+    if (!sameBlock) {
+        m_cachedOffset = m_index.findRow(m_reader, row, &m_cachedMode);
+        m_cachedRow = m_cachedOffset < 0 ? -1 : row;
+        if (m_cachedRow < 0)
+            return false;
+    }
+
+    for (; m_cachedRow < row; m_cachedRow++) {
+        m_cachedOffset = m_reader.readRecord(m_cachedOffset, record);
+        if (m_cachedOffset < 0) {
+            m_cachedRow = -1;
+            return false;
+        }
+        if (record->type == CaptureSession && record->size >= 4)
+            m_cachedMode = qFromLittleEndian<qint32>(reinterpret_cast<const uchar *>(record->payload));
+    }
+
+    *brgMode = m_cachedMode;
+    return m_reader.readRecord(m_cachedOffset, record) >= 0;
+}
+
+QVariant CaptureModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::TextAlignmentRole))
+        return QVariant();
+
+    if (role == Qt::TextAlignmentRole)
+        return index.column() == LengthColumn ? int(Qt::AlignRight | Qt::AlignVCenter) : QVariant();
+
+    CaptureRecord record;
+    qint32 brgMode = 0;
+    if (!locate(index.row(), &record, &brgMode))
+        return QVariant();
+
+    switch (index.column()) {
+    case TimeColumn:
+        return formatTime(record.timeUs);
+    case TypeColumn: {
+        static const char *const types[] = { "?", "Session", "Rx", "Tx", "Gap", "Marker", "CAN" };
+        return QString(types[record.type <= CaptureCanFrame ? record.type : 0]);
+    }
+    case LengthColumn:
+        return record.size;
+    case DataColumn:
+        return formatPayload(record, brgMode);
+    default:
+        return QVariant();
+    }
+}
+
+QVariant CaptureModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section) {
+    case TimeColumn:
+        return tr("Time");
+    case TypeColumn:
+        return tr("Type");
+    case LengthColumn:
+        return tr("Length");
+    case DataColumn:
+        return tr("Data");
+    default:
+        return QVariant();
+    }
+}
+
+CaptureViewer::CaptureViewer(QWidget *parent) :
+    QWidget(parent, Qt::Window),
+    m_model(new CaptureModel(this)),
+    m_view(new QTableView),
+    m_goTo(new QLineEdit),
+    m_status(new QLabel)
+{
+    qRegisterMetaType<CaptureIndex>("CaptureIndex");
+
+    setAttribute(Qt::WA_DeleteOnClose);
+    resize(900, 600);
+
+    m_view->setModel(m_model);
+    m_view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_view->setWordWrap(false);
+    m_view->verticalHeader()->hide();
+    // Fixed row heights keep the view from measuring rows it doesn't show.
+    m_view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_view->horizontalHeader()->setStretchLastSection(true);
+    m_view->setColumnWidth(CaptureModel::TimeColumn, 200);
+    m_view->setColumnWidth(CaptureModel::TypeColumn, 70);
+    m_view->setColumnWidth(CaptureModel::LengthColumn, 60);
+
+    m_goTo->setPlaceholderText(tr("Go to hh:mm:ss.ffffff or +seconds"));
+    connect(m_goTo, &QLineEdit::returnPressed, this, &CaptureViewer::goToTime);
+
+    QHBoxLayout *bar = new QHBoxLayout;
+    bar->addWidget(m_goTo);
+    bar->addWidget(m_status, 1);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addLayout(bar);
+    layout->addWidget(m_view);
+}
+
+CaptureViewer::~CaptureViewer()
+{
+    stopIndexing();
+}
+
+bool CaptureViewer::open(const QString &fileName, QString *errorString)
+{
+    stopIndexing();
+    if (!m_model->open(fileName, errorString))
+        return false;
+
+    setWindowTitle(tr("Capture - %1").arg(QFileInfo(fileName).fileName()));
+
+    CaptureIndex saved;
+    CaptureReader reader;
+    m_indexChanged = !(reader.open(fileName) && saved.load(CaptureIndex::indexFileName(fileName), reader));
+    if (!m_indexChanged)
+        m_model->setCaptureIndex(saved);
+
+    startIndexing();
+    return true;
+}
+
+void CaptureViewer::startIndexing()
+{
+    m_cancel.store(0);
+    m_status->setText(tr("Indexing..."));
+
+    const QString fileName = m_model->fileName();
+    const CaptureIndex start = m_model->captureIndex().continuation();
+    const int generation = ++m_generation;
+    m_indexing = QtConcurrent::run([this, fileName, start, generation]() {
+        CaptureReader reader;
+        if (!reader.open(fileName)) {
+            QMetaObject::invokeMethod(this, "indexed", Qt::QueuedConnection,
+                                      Q_ARG(CaptureIndex, start), Q_ARG(bool, true), Q_ARG(int, generation));
+            return;
+        }
+
+        CaptureIndex chunk = start;
+        qint64 chunkRecords = FirstChunk;
+        for (;;) {
+            const bool done = chunk.extend(reader, chunkRecords) < chunkRecords || m_cancel.load() != 0;
+            QMetaObject::invokeMethod(this, "indexed", Qt::QueuedConnection,
+                                      Q_ARG(CaptureIndex, chunk), Q_ARG(bool, done), Q_ARG(int, generation));
+            if (done)
+                return;
+            chunk = chunk.continuation();
+            chunkRecords = qMin(chunkRecords * 4, qint64(MaxChunk));
+        }
+    });
+}
+
+void CaptureViewer::stopIndexing()
+{
+    m_cancel.store(1);
+    m_indexing.waitForFinished();
+}
+
+void CaptureViewer::indexed(const CaptureIndex &continued, bool done, int generation)
+{
+    // Chunks still queued from before open() was called again.
+    if (generation != m_generation)
+        return;
+
+    if (continued.recordCount() > m_model->captureIndex().recordCount())
+        m_indexChanged = true;
+    m_model->appendIndex(continued);
+
+    const qint64 records = m_model->captureIndex().recordCount();
+    if (!done) {
+        m_status->setText(tr("Indexing... %1 records").arg(records));
+        return;
+    }
+
+    m_status->setText(tr("%1 records").arg(records));
+    if (m_indexChanged && m_cancel.load() == 0 && records > CaptureIndex::Stride)
+        m_model->captureIndex().save(CaptureIndex::indexFileName(m_model->fileName()));
+    m_indexChanged = false;
+}
+
+void CaptureViewer::goToTime()
+{
+    const QString text = m_goTo->text().trimmed();
+    const qint64 firstUs = m_model->firstTimeUs();
+    qint64 timeUs = -1;
+
+    if (text.startsWith('+')) {
+        bool ok = false;
+        const double seconds = text.mid(1).toDouble(&ok);
+        if (ok)
+            timeUs = firstUs + static_cast<qint64>(seconds * 1e6);
+    } else {
+        // Time of day on the date of the first record; up to six fraction digits.
+        const QStringList parts = text.split('.');
+        const QTime time = QTime::fromString(parts.value(0), "h:mm:ss");
+        const QString fraction = parts.value(1).left(6).leftJustified(6, '0');
+        bool ok = parts.size() <= 2;
+        const qint64 fractionUs = ok ? fraction.toLongLong(&ok) : 0;
+        if (time.isValid() && ok) {
+            const QDateTime first = QDateTime::fromMSecsSinceEpoch(firstUs / 1000);
+            timeUs = QDateTime(first.date(), time).toMSecsSinceEpoch() * 1000 + fractionUs;
+        }
+    }
+
+    if (timeUs < 0) {
+        m_status->setText(tr("Invalid time %1").arg(text));
+        return;
+    }
+
+    const qint64 row = m_model->rowForTime(timeUs);
+    if (row >= m_model->rowCount()) {
+        m_status->setText(tr("%1 is after the last record").arg(text));
+        return;
+    }
+
+    const QModelIndex index = m_model->index(static_cast<int>(row), 0);
+    m_view->scrollTo(index, QAbstractItemView::PositionAtTop);
+    m_view->selectRow(index.row());
+}
@@ -0,0 +1,96 @@
+#ifndef CAPTUREVIEWER_H
+#define CAPTUREVIEWER_H
+
+#include <QAbstractTableModel>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QWidget>
+
+#include "captureindex.h"
+
+QT_BEGIN_NAMESPACE
+
+class QLabel;
+class QLineEdit;
+class QTableView;
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(CaptureIndex)
+
+// One row per capture record. Rows are located through the sparse index
+// and decoded only when the view asks for them; the last located row is
+// kept so that painting consecutive rows walks forward one record at a time.
+class CaptureModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        TimeColumn,
+        TypeColumn,
+        LengthColumn,
+        DataColumn,
+        ColumnCount
+    };
+
+    explicit CaptureModel(QObject *parent = nullptr);
+
+    bool open(const QString &fileName, QString *errorString = nullptr);
+    QString fileName() const { return m_reader.fileName(); }
+
+    const CaptureIndex &captureIndex() const { return m_index; }
+    void setCaptureIndex(const CaptureIndex &index);
+    void appendIndex(const CaptureIndex &continued);
+
+    qint64 rowForTime(qint64 timeUs) const { return m_index.rowForTime(m_reader, timeUs); }
+    qint64 firstTimeUs() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    bool locate(qint64 row, CaptureRecord *record, qint32 *brgMode) const;
+
+    CaptureReader m_reader;
+    CaptureIndex m_index;
+    mutable qint64 m_cachedRow = -1;
+    mutable qint64 m_cachedOffset = 0;
+    mutable qint32 m_cachedMode = 0;
+};
+
+// Offline viewer for NUCP captures. The first rows show as soon as the
+// first index chunk is built; the rest of the index is built on the thread
+// pool, or read from the .idx file saved by an earlier run and extended
+// if the capture has grown since.
+class CaptureViewer : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit CaptureViewer(QWidget *parent = nullptr);
+    ~CaptureViewer();
+
+    bool open(const QString &fileName, QString *errorString = nullptr);
+
+private slots:
+    void indexed(const CaptureIndex &continued, bool done, int generation);
+    void goToTime();
+
+private:
+    void startIndexing();
+    void stopIndexing();
+
+    CaptureModel *m_model = nullptr;
+    QTableView *m_view = nullptr;
+    QLineEdit *m_goTo = nullptr;
+    QLabel *m_status = nullptr;
+    QFuture<void> m_indexing;
+    QAtomicInt m_cancel;
+    int m_generation = 0;
+    bool m_indexChanged = false;
+};
+
+#endif // CAPTUREVIEWER_H
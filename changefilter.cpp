@@ -0,0 +1,14 @@
+#include "changefilter.h"
+
+ChangeFilter::ChangeFilter() :
+    m_stdData(StdIdCount, 0),
+    m_stdTags(StdIdCount, 0)
+{
+}
+
+void ChangeFilter::reset()
+{
+    m_stdData.fill(0);
+    m_stdTags.fill(0);
+    m_ext.clear();
+}
@@ -0,0 +1,87 @@
+#ifndef CHANGEFILTER_H
+#define CHANGEFILTER_H
+
+#include <QHash>
+#include <QVector>
+#include <QtEndian>
+
+#include "nuvbridge.h"
+
+// Remembers the last payload per CAN ID so the display can skip frames
+// that repeat it. Standard IDs index flat arrays of payload words and tags
+// (18 KiB in all), extended IDs a hash. A frame costs one load of its Data
+// as a 64-bit word and two compares; the changed-byte mask is only worked
+// out for frames that differ.
+class ChangeFilter
+{
+public:
+    enum Result {
+        Unchanged,
+        Changed,
+        New
+    };
+
+    ChangeFilter();
+
+    void reset();
+
+    // Stores the frame as the ID's last one. For a changed frame, bit n of
+    // changedBytes is set if Data[n] differs; a new DLC or frame type marks
+    // every byte.
+    Result update(const STR_CANMSG_T &frame, quint8 *changedBytes)
+    {
+        const quint8 dlc = frame.DLC > 8 ? 8 : frame.DLC;
+        const bool remote = frame.FrameType == CAN_REMOTE_FRAME;
+        const quint8 tag = Seen | (remote ? Remote : 0) | dlc;
+        const quint64 mask = remote || dlc == 0 ? 0 : ~quint64(0) >> (64 - 8 * dlc);
+        const quint64 data = qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(frame.Data)) & mask;
+
+        quint64 *lastData;
+        quint8 *lastTag;
+        if (frame.IdType == CAN_STD_ID && frame.Id < StdIdCount) {
+            lastData = m_stdData.data() + frame.Id;
+            lastTag = m_stdTags.data() + frame.Id;
+        } else {
+            Entry &entry = m_ext[frame.Id];
+            lastData = &entry.data;
+            lastTag = &entry.tag;
+        }
+
+        if (*lastTag == tag && *lastData == data)
+            return Unchanged;
+
+        const Result result = *lastTag == 0 ? New : Changed;
+        if (*lastTag != tag) {
+            *changedBytes = static_cast<quint8>((1u << dlc) - 1);
+        } else {
+            const quint64 diff = *lastData ^ data;
+            quint8 bytes = 0;
+            for (int i = 0; i < 8; i++) {
+                if ((diff >> (8 * i)) & 0xFF)
+                    bytes |= 1 << i;
+            }
+            *changedBytes = bytes;
+        }
+        *lastTag = tag;
+        *lastData = data;
+        return result;
+    }
+
+private:
+    enum {
+        StdIdCount = 0x800,
+        Seen = 0x80,
+        Remote = 0x40
+    };
+
+    struct Entry {
+        quint64 data = 0;
+        quint8 tag = 0;
+    };
+
+    QVector<quint64> m_stdData;
+    QVector<quint8> m_stdTags;
+    QHash<quint32, Entry> m_ext;
+};
+
+#endif // CHANGEFILTER_H
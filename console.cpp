@@ -50,8 +50,10 @@
 ****************************************************************************/
 
 #include "console.h"
+#include "tracerecorder.h"
 
 #include <QScrollBar>
+#include <QTextCursor>
 
 Console::Console(QWidget *parent) :
     QPlainTextEdit(parent)
@@ -65,12 +67,42 @@ Console::Console(QWidget *parent) :
 
 void Console::putData(const QByteArray &data)
 {
+    TRACE_ZONE("console.insert");
     insertPlainText(data);
 
     QScrollBar *bar = verticalScrollBar();
     bar->setValue(bar->maximum());
 }
 
+void Console::putHighlighted(const QByteArray &data, int first, int stride, int width, quint32 mask)
+{
+    TRACE_ZONE("console.insertHighlighted");
+    QTextCharFormat plain;
+    QTextCharFormat highlight;
+    highlight.setForeground(Qt::black);
+    highlight.setBackground(Qt::yellow);
+
+    QTextCursor cursor = textCursor();
+    cursor.movePosition(QTextCursor::End);
+    int pos = 0;
+    for (int span = 0; mask >> span; span++) {
+        if (!(mask & (1u << span)))
+            continue;
+        const int start = first + span * stride;
+        if (start >= data.size())
+            break;
+        cursor.insertText(QString::fromLatin1(data.constData() + pos, start - pos), plain);
+        const int length = qMin(width, data.size() - start);
+        cursor.insertText(QString::fromLatin1(data.constData() + start, length), highlight);
+        pos = start + length;
+    }
+    cursor.insertText(QString::fromLatin1(data.constData() + pos, data.size() - pos), plain);
+    setTextCursor(cursor);
+
+    QScrollBar *bar = verticalScrollBar();
+    bar->setValue(bar->maximum());
+}
+
 void Console::setLocalEchoEnabled(bool set)
 {
     m_localEchoEnabled = set;
@@ -65,6 +65,8 @@ public:
     explicit Console(QWidget *parent = nullptr);
 
     void putData(const QByteArray &data);
+    // Bit n of mask highlights width bytes at first + n * stride.
+    void putHighlighted(const QByteArray &data, int first, int stride, int width, quint32 mask);
     void setLocalEchoEnabled(bool set);
 
 protected:
@@ -0,0 +1,222 @@
+#include "dbcdatabase.h"
+
+#include <QFile>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QtEndian>
+
+#include <algorithm>
+
+enum {
+    StdIdCount = 0x800,
+    DbcExtendedFlag = 0x80000000
+};
+
+DbcDatabase::DbcDatabase() :
+    m_stdIndex(StdIdCount, -1)
+{
+}
+
+void DbcDatabase::clear()
+{
+    m_messages.clear();
+    m_signals.clear();
+    m_plans.clear();
+    m_stdIndex.fill(-1);
+    m_extIndex.clear();
+    m_maxSignalsPerMessage = 0;
+}
+
+bool DbcDatabase::load(const QString &fileName, QString *errorString)
+{
+    // Every failure leaves the database empty, never half loaded.
+    clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorString)
+            *errorString = file.errorString();
+        return false;
+    }
+
+    const QRegularExpression reMessage(QStringLiteral("^BO_\\s+(\\d+)\\s+(\\w+)\\s*:\\s*(\\d+)"));
+    const QRegularExpression reSignal(QStringLiteral(
+            "^SG_\\s+(\\w+)\\s*(M|m\\d+)?\\s*:\\s*(\\d+)\\|(\\d+)@([01])([+-])\\s*"
+            "\\(([^,]+),([^)]+)\\)\\s*\\[([^|]+)\\|([^\\]]+)\\]\\s*\"([^\"]*)\""));
+
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        lineNumber++;
+
+        if (line.startsWith(QLatin1String("BO_ "))) {
+            const QRegularExpressionMatch m = reMessage.match(line);
+            if (!m.hasMatch())
+                continue;
+
+            const uint rawId = m.captured(1).toUInt();
+            DbcMessage msg;
+            msg.name = m.captured(2);
+            msg.extended = (rawId & DbcExtendedFlag) || (rawId >= StdIdCount);
+            msg.id = rawId & 0x1FFFFFFF;
+            msg.dlc = m.captured(3).toInt();
+            msg.firstSignal = m_signals.size();
+            msg.signalCount = 0;
+            msg.muxSignal = -1;
+
+            // VECTOR__INDEPENDENT_SIG_MSG is a pseudo message holding orphan signals
+            if (msg.name == QLatin1String("VECTOR__INDEPENDENT_SIG_MSG"))
+                msg.id = 0xFFFFFFFF;
+
+            m_messages.append(msg);
+        } else if (line.startsWith(QLatin1String("SG_ "))) {
+            const QRegularExpressionMatch m = reSignal.match(line);
+            if (!m.hasMatch() || m_messages.isEmpty()) {
+                if (errorString)
+                    *errorString = QObject::tr("Malformed signal at line %1").arg(lineNumber);
+                clear();
+                return false;
+            }
+
+            DbcMessage &msg = m_messages.last();
+            const int start = m.captured(3).toInt();
+            const int length = m.captured(4).toInt();
+            const bool bigEndian = (m.captured(5) == QLatin1String("0"));
+
+            int shift;
+            if (bigEndian) {
+                // Motorola start bit is the MSB in sawtooth numbering. In the
+                // frame loaded as a big-endian 64-bit word, bit b of byte k
+                // sits at position (7 - k) * 8 + b.
+                const int msb = (7 - start / 8) * 8 + start % 8;
+                shift = msb - length + 1;
+            } else {
+                shift = start;
+            }
+
+            if (length < 1 || length > 64 || shift < 0 || shift + length > 64) {
+                if (errorString)
+                    *errorString = QObject::tr("Signal %1 at line %2 does not fit in 8 bytes")
+                                   .arg(m.captured(1)).arg(lineNumber);
+                clear();
+                return false;
+            }
+
+            SignalPlan plan;
+            plan.mask = (length == 64) ? ~quint64(0) : ((quint64(1) << length) - 1);
+            plan.factor = m.captured(7).toDouble();
+            plan.offset = m.captured(8).toDouble();
+            plan.shift = static_cast<quint8>(shift);
+            plan.length = static_cast<quint8>(length);
+            // In the big-endian word byte k holds bits (7 - k) * 8 and up.
+            plan.bytes = static_cast<quint8>(bigEndian ? 8 - shift / 8 : (shift + length + 7) / 8);
+            plan.bigEndian = bigEndian;
+            plan.isSigned = (m.captured(6) == QLatin1String("-"));
+            plan.muxValue = -1;
+
+            const QString mux = m.captured(2);
+            if (mux == QLatin1String("M")) {
+                msg.muxSignal = m_signals.size();
+            } else if (!mux.isEmpty()) {
+                plan.muxValue = mux.midRef(1).toInt();
+            }
+
+            DbcSignal sig;
+            sig.name = m.captured(1);
+            sig.unit = m.captured(11);
+            sig.minimum = m.captured(9).toDouble();
+            sig.maximum = m.captured(10).toDouble();
+            sig.message = m_messages.size() - 1;
+
+            m_signals.append(sig);
+            m_plans.append(plan);
+            msg.signalCount++;
+        }
+    }
+
+    buildIndex();
+    return true;
+}
+
+void DbcDatabase::buildIndex()
+{
+    m_stdIndex.fill(-1);
+    m_extIndex.clear();
+    m_maxSignalsPerMessage = 0;
+
+    for (int i = 0; i < m_messages.size(); i++) {
+        const DbcMessage &msg = m_messages.at(i);
+        m_maxSignalsPerMessage = qMax(m_maxSignalsPerMessage, msg.signalCount);
+
+        if (msg.id == 0xFFFFFFFF)
+            continue;
+
+        if (!msg.extended) {
+            m_stdIndex[msg.id] = static_cast<qint16>(i);
+        } else {
+            m_extIndex.append({msg.id, i});
+        }
+    }
+
+    std::sort(m_extIndex.begin(), m_extIndex.end(),
+              [](const ExtIndexEntry &a, const ExtIndexEntry &b) { return a.id < b.id; });
+}
+
+int DbcDatabase::messageIndex(const STR_CANMSG_T &frame) const
+{
+    if (frame.IdType == CAN_STD_ID) {
+        return (frame.Id < StdIdCount) ? m_stdIndex.constData()[frame.Id] : -1;
+    }
+
+    const auto it = std::lower_bound(m_extIndex.constBegin(), m_extIndex.constEnd(), frame.Id,
+                                     [](const ExtIndexEntry &e, unsigned int id) { return e.id < id; });
+    if (it != m_extIndex.constEnd() && it->id == frame.Id)
+        return it->message;
+
+    return -1;
+}
+
+int DbcDatabase::decode(const STR_CANMSG_T &frame, DbcValue *out, int *message) const
+{
+    const int index = messageIndex(frame);
+    if (message)
+        *message = index;
+    if (index < 0 || frame.FrameType == CAN_REMOTE_FRAME)
+        return 0;
+
+    const int dlc = qMin<int>(frame.DLC, 8);
+
+    const DbcMessage &msg = m_messages.constData()[index];
+    const quint64 le = qFromLittleEndian<quint64>(frame.Data);
+    const quint64 be = qFromBigEndian<quint64>(frame.Data);
+
+    qint64 mux = -1;
+    if (msg.muxSignal >= 0) {
+        const SignalPlan &p = m_plans.constData()[msg.muxSignal];
+        if (p.bytes <= dlc)
+            mux = static_cast<qint64>(((p.bigEndian ? be : le) >> p.shift) & p.mask);
+    }
+
+    const SignalPlan *plan = m_plans.constData() + msg.firstSignal;
+    int count = 0;
+    for (int i = 0; i < msg.signalCount; i++, plan++) {
+        if (plan->bytes > dlc || (plan->muxValue >= 0 && plan->muxValue != mux))
+            continue;
+
+        const quint64 raw = ((plan->bigEndian ? be : le) >> plan->shift) & plan->mask;
+        double value;
+        if (plan->isSigned) {
+            const int unused = 64 - plan->length;
+            value = static_cast<double>(static_cast<qint64>(raw << unused) >> unused);
+        } else {
+            value = static_cast<double>(raw);
+        }
+
+        out[count].signal = msg.firstSignal + i;
+        out[count].value = value * plan->factor + plan->offset;
+        count++;
+    }
+
+    return count;
+}
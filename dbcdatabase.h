@@ -0,0 +1,84 @@
+#ifndef DBCDATABASE_H
+#define DBCDATABASE_H
+
+#include <QString>
+#include <QVector>
+#include "nuvbridge.h"
+
+struct DbcSignal {
+    QString name;
+    QString unit;
+    double minimum;
+    double maximum;
+    int message;            // index into DbcDatabase::messages()
+};
+
+struct DbcMessage {
+    QString name;
+    unsigned int id;
+    bool extended;
+    int dlc;
+    int firstSignal;        // signals of one message are stored contiguously
+    int signalCount;
+    int muxSignal;          // global signal index of the multiplexer, or -1
+};
+
+struct DbcValue {
+    int signal;             // global signal index
+    double value;
+};
+
+class DbcDatabase
+{
+public:
+    DbcDatabase();
+
+    bool load(const QString &fileName, QString *errorString = nullptr);
+    void clear();
+
+    bool isEmpty() const { return m_messages.isEmpty(); }
+    const QVector<DbcMessage> &messages() const { return m_messages; }
+    const DbcSignal &signalAt(int index) const { return m_signals.at(index); }
+    int signalCount() const { return m_signals.size(); }
+    int maxSignalsPerMessage() const { return m_maxSignalsPerMessage; }
+
+    // Returns the message index for the frame, or -1 if the DBC has none.
+    int messageIndex(const STR_CANMSG_T &frame) const;
+
+    // Decodes all active signals of the frame into out[], which must hold at
+    // least maxSignalsPerMessage() entries. Returns the number written and,
+    // if message is given, the message index or -1. Signals that reach past
+    // the frame's DLC are skipped, and remote frames decode to nothing.
+    int decode(const STR_CANMSG_T &frame, DbcValue *out, int *message = nullptr) const;
+
+private:
+    // Extraction plan compiled from a signal definition at load time, so that
+    // decoding is a shift, a mask and one multiply-add per signal.
+    struct SignalPlan {
+        quint64 mask;
+        double factor;
+        double offset;
+        quint8 shift;
+        quint8 length;
+        quint8 bytes;       // DLC needed to carry the whole signal
+        bool bigEndian;
+        bool isSigned;
+        qint32 muxValue;    // -1 if always present
+    };
+
+    struct ExtIndexEntry {
+        unsigned int id;
+        int message;
+    };
+
+    void buildIndex();
+
+    QVector<DbcMessage> m_messages;
+    QVector<DbcSignal> m_signals;
+    QVector<SignalPlan> m_plans;
+    QVector<qint16> m_stdIndex;
+    QVector<ExtIndexEntry> m_extIndex;
+    int m_maxSignalsPerMessage = 0;
+};
+
+#endif // DBCDATABASE_H
@@ -0,0 +1,182 @@
+#include "deviceregistry.h"
+#include "bridgeport.h"
+
+#include <QCoreApplication>
+#include <QSerialPortInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+enum {
+    PollInterval = 2000,    // ms, only used without hotplug notifications
+    SettleDelay = 300       // ms, lets udev create the device node first
+};
+
+DeviceRegistry *DeviceRegistry::instance()
+{
+    static DeviceRegistry *registry = new DeviceRegistry(QCoreApplication::instance());
+    return registry;
+}
+
+DeviceRegistry::DeviceRegistry(QObject *parent) :
+    QObject(parent),
+    m_rescanTimer(new QTimer(this)),
+    m_scanWatcher(new QFutureWatcher<QVector<BridgeDevice>>(this))
+{
+    connect(m_scanWatcher, &QFutureWatcher<QVector<BridgeDevice>>::finished, this, &DeviceRegistry::scanFinished);
+
+    // A single plug event produces a burst of uevents; scan once after it.
+    m_rescanTimer->setSingleShot(true);
+    m_rescanTimer->setInterval(SettleDelay);
+    connect(m_rescanTimer, &QTimer::timeout, this, &DeviceRegistry::rescan);
+
+    if (!openUeventSocket()) {
+        m_pollTimer = new QTimer(this);
+        connect(m_pollTimer, &QTimer::timeout, this, &DeviceRegistry::rescan);
+        m_pollTimer->start(PollInterval);
+    }
+
+    rescan();
+}
+
+DeviceRegistry::~DeviceRegistry()
+{
+#ifdef Q_OS_LINUX
+    if (m_ueventFd >= 0)
+        ::close(m_ueventFd);
+#endif
+}
+
+bool DeviceRegistry::openUeventSocket()
+{
+#ifdef Q_OS_LINUX
+    m_ueventFd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (m_ueventFd < 0)
+        return false;
+
+    struct sockaddr_nl addr = {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; // kernel uevents
+    if (::bind(m_ueventFd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+        ::close(m_ueventFd);
+        m_ueventFd = -1;
+        return false;
+    }
+
+    m_ueventNotifier = new QSocketNotifier(m_ueventFd, QSocketNotifier::Read, this);
+    connect(m_ueventNotifier, &QSocketNotifier::activated, this, &DeviceRegistry::readUevents);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void DeviceRegistry::readUevents()
+{
+#ifdef Q_OS_LINUX
+    char buf[4096];
+    bool relevant = false;
+
+    for (;;) {
+        const ssize_t len = ::recv(m_ueventFd, buf, sizeof(buf) - 1, 0);
+        if (len <= 0)
+            break;
+        buf[len] = 0;
+
+        // Payload is "ACTION@DEVPATH\0KEY=VALUE\0..."; only tty add/remove matters.
+        for (const char *p = buf; p < buf + len; p += strlen(p) + 1) {
+            if (strcmp(p, "SUBSYSTEM=tty") == 0) {
+                relevant = true;
+                break;
+            }
+        }
+    }
+
+    if (relevant)
+        m_rescanTimer->start();
+#endif
+}
+
+void DeviceRegistry::rescan()
+{
+    if (m_scanWatcher->isRunning()) {
+        m_rescanPending = true;
+        return;
+    }
+
+    m_scanWatcher->setFuture(QtConcurrent::run(&DeviceRegistry::enumerate));
+}
+
+QVector<BridgeDevice> DeviceRegistry::enumerate()
+{
+    QVector<BridgeDevice> found;
+
+    const auto infos = QSerialPortInfo::availablePorts();
+    for (const QSerialPortInfo &info : infos) {
+        if (!info.hasVendorIdentifier() || !info.hasProductIdentifier())
+            continue;
+
+        if (bridgeGeneration(info.vendorIdentifier(), info.productIdentifier()) == 0)
+            continue;
+
+        BridgeDevice dev;
+        dev.portName = info.portName();
+        dev.description = info.description();
+        dev.manufacturer = info.manufacturer();
+        dev.serialNumber = info.serialNumber();
+        dev.systemLocation = info.systemLocation();
+        dev.vendorId = info.vendorIdentifier();
+        dev.productId = info.productIdentifier();
+        dev.present = true;
+        found.append(dev);
+    }
+
+    return found;
+}
+
+void DeviceRegistry::scanFinished()
+{
+    QVector<BridgeDevice> found = m_scanWatcher->result();
+
+    // Ports that went away stay in the list, flagged, until they come back.
+    bool changed = false;
+    for (BridgeDevice &old : m_devices) {
+        const bool stillThere = std::any_of(found.cbegin(), found.cend(), [&old](const BridgeDevice &dev) {
+            return dev.portName == old.portName;
+        });
+
+        if (!stillThere) {
+            if (old.present)
+                changed = true;
+            old.present = false;
+            found.append(old);
+        }
+    }
+
+    if (!changed) {
+        changed = (found.size() != m_devices.size());
+        for (int i = 0; !changed && i < found.size(); i++) {
+            changed = (found.at(i).portName != m_devices.at(i).portName)
+                    || (found.at(i).present != m_devices.at(i).present);
+        }
+    }
+
+    m_devices = found;
+
+    if (changed)
+        emit devicesChanged();
+
+    if (m_rescanPending) {
+        m_rescanPending = false;
+        rescan();
+    }
+}
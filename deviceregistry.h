@@ -0,0 +1,65 @@
+#ifndef DEVICEREGISTRY_H
+#define DEVICEREGISTRY_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+
+class QSocketNotifier;
+class QTimer;
+
+QT_END_NAMESPACE
+
+struct BridgeDevice {
+    QString portName;
+    QString description;
+    QString manufacturer;
+    QString serialNumber;
+    QString systemLocation;
+    quint16 vendorId;
+    quint16 productId;
+    bool present;           // false once the port has been unplugged
+};
+
+// Keeps the list of attached Nu-Link bridges up to date, so that showing
+// the settings dialog doesn't have to enumerate every serial port. On Linux
+// the list is refreshed on kernel uevents; elsewhere it is polled. The
+// enumeration itself runs on the global thread pool.
+class DeviceRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DeviceRegistry *instance();
+
+    QVector<BridgeDevice> devices() const { return m_devices; }
+
+public slots:
+    void rescan();
+
+signals:
+    void devicesChanged();
+
+private slots:
+    void readUevents();
+    void scanFinished();
+
+private:
+    explicit DeviceRegistry(QObject *parent = nullptr);
+    ~DeviceRegistry();
+
+    bool openUeventSocket();
+    static QVector<BridgeDevice> enumerate();
+
+    QVector<BridgeDevice> m_devices;
+    int m_ueventFd = -1;
+    QSocketNotifier *m_ueventNotifier = nullptr;
+    QTimer *m_rescanTimer = nullptr;
+    QTimer *m_pollTimer = nullptr;
+    QFutureWatcher<QVector<BridgeDevice>> *m_scanWatcher = nullptr;
+    bool m_rescanPending = false;
+};
+
+#endif // DEVICEREGISTRY_H
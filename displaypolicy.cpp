@@ -0,0 +1,172 @@
+#include "displaypolicy.h"
+
+#include <QObject>
+#include <QVector>
+
+#include <algorithm>
+
+namespace {
+
+const double Budget = 0.3;      // share of wall time drawing may take
+const int CalmWindowsToStepUp = 4;
+
+} // namespace
+
+void DisplayPolicy::reset()
+{
+    m_level = Full;
+    m_windowStartNs = -1;
+    m_costNs = 0;
+    m_offered = 0;
+    m_drawn = 0;
+    m_calmWindows = 0;
+    m_nextSampleNs = 0;
+    m_skipped = 0;
+    m_frames = 0;
+    m_countersFrames = 0;
+    m_countersSkipped = 0;
+    m_countersStartNs = -1;
+    m_ids.clear();
+    m_summaryRows = 0;
+}
+
+QString DisplayPolicy::levelName(Level level)
+{
+    switch (level) {
+    case Full:
+        return QObject::tr("full");
+    case Sampled:
+        return QObject::tr("sampled");
+    case Summary:
+        return QObject::tr("per-ID summary");
+    case Counters:
+        return QObject::tr("counters only");
+    }
+    return QString();
+}
+
+bool DisplayPolicy::offer(qint64 nowNs)
+{
+    m_offered++;
+    if (m_level == Full)
+        return true;
+
+    if (m_level == Sampled && nowNs >= m_nextSampleNs) {
+        m_nextSampleNs = nowNs + SampleIntervalMs * Q_INT64_C(1000000);
+        return true;
+    }
+
+    m_skipped++;
+    return false;
+}
+
+void DisplayPolicy::countFrame(const STR_CANMSG_T &frame)
+{
+    m_frames++;
+    if (m_level != Summary)
+        return;
+
+    const quint32 key = frame.Id | (frame.IdType == CAN_EXT_ID ? 0x80000000u : 0);
+    IdSummary &entry = m_ids[key];
+    entry.id = frame.Id;
+    entry.extended = frame.IdType == CAN_EXT_ID;
+    entry.frames++;
+    entry.last = frame;
+}
+
+double DisplayPolicy::itemsPerSecond(Level level, double offeredPerSecond) const
+{
+    switch (level) {
+    case Full:
+        return offeredPerSecond;
+    case Sampled:
+        return qMin(offeredPerSecond, 1000.0 / SampleIntervalMs);
+    case Summary:
+        return (qMax(m_ids.size(), m_summaryRows) + 1) * (1000.0 / SummaryIntervalMs);
+    case Counters:
+        break;
+    }
+    return 1000.0 / CountersIntervalMs;
+}
+
+bool DisplayPolicy::update(qint64 nowNs)
+{
+    if (m_windowStartNs < 0) {
+        m_windowStartNs = nowNs;
+        return false;
+    }
+
+    const qint64 elapsedNs = nowNs - m_windowStartNs;
+    if (elapsedNs < EvaluateIntervalMs * Q_INT64_C(1000000))
+        return false;
+
+    if (m_drawn > 0) {
+        const double nsPerItem = double(m_costNs) / m_drawn;
+        m_nsPerItem = m_nsPerItem > 0 ? 0.75 * m_nsPerItem + 0.25 * nsPerItem : nsPerItem;
+    }
+
+    const Level previous = m_level;
+    const double share = double(m_costNs) / elapsedNs;
+    if (share > Budget && m_level < Counters) {
+        m_level = static_cast<Level>(m_level + 1);
+        m_calmWindows = 0;
+    } else if (m_level > Full) {
+        const double offeredPerSecond = m_offered * 1e9 / elapsedNs;
+        const Level up = static_cast<Level>(m_level - 1);
+        const double predicted = itemsPerSecond(up, offeredPerSecond) * m_nsPerItem / 1e9;
+        m_calmWindows = predicted < Budget / 2 ? m_calmWindows + 1 : 0;
+        if (m_calmWindows >= CalmWindowsToStepUp) {
+            m_level = up;
+            m_calmWindows = 0;
+        }
+    }
+
+    if (m_level != previous && m_level != Summary)
+        m_ids.clear();
+
+    m_windowStartNs = nowNs;
+    m_costNs = 0;
+    m_offered = 0;
+    m_drawn = 0;
+    return m_level != previous;
+}
+
+QString DisplayPolicy::takeSummary()
+{
+    QVector<IdSummary> rows;
+    rows.reserve(m_ids.size());
+    for (const IdSummary &entry : m_ids)
+        rows.append(entry);
+    m_ids.clear();
+    m_summaryRows = rows.size();
+
+    std::sort(rows.begin(), rows.end(), [](const IdSummary &a, const IdSummary &b) {
+        return a.extended != b.extended ? b.extended : a.id < b.id;
+    });
+
+    QString text = QObject::tr("-- %1 IDs, %2 items skipped --\r\n").arg(rows.size()).arg(m_skipped);
+    for (const IdSummary &row : rows) {
+        text += QString("%1 x%2 ").arg(row.id, row.extended ? 8 : 3, 16, QChar('0')).arg(row.frames, -6);
+        if (row.last.FrameType == CAN_REMOTE_FRAME) {
+            text += QLatin1String(" remote");
+        } else {
+            for (int i = 0; i < row.last.DLC && i < 8; i++)
+                text += QString(" %1").arg(uint(quint8(row.last.Data[i])), 2, 16, QChar('0'));
+        }
+        text += QLatin1String("\r\n");
+    }
+    return text;
+}
+
+QString DisplayPolicy::takeCounters(qint64 nowNs)
+{
+    const double seconds = m_countersStartNs < 0 ? 0 : (nowNs - m_countersStartNs) / 1e9;
+    const double frames = seconds > 0 ? (m_frames - m_countersFrames) / seconds : 0;
+    const double skipped = seconds > 0 ? (m_skipped - m_countersSkipped) / seconds : 0;
+    m_countersStartNs = nowNs;
+    m_countersFrames = m_frames;
+    m_countersSkipped = m_skipped;
+
+    return QObject::tr("-- %1 frames total, %2 frames/s, %3 items/s not drawn --\r\n")
+            .arg(m_frames).arg(frames, 0, 'f', 0).arg(skipped, 0, 'f', 0);
+}
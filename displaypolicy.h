@@ -0,0 +1,92 @@
+#ifndef DISPLAYPOLICY_H
+#define DISPLAYPOLICY_H
+
+#include <QHash>
+#include <QString>
+
+#include "nuvbridge.h"
+
+// Decides how much of the received traffic the console draws, so a flood
+// that the GUI cannot keep up with degrades the display instead of the
+// receive path. Capture, logging and every other consumer still see all
+// data; only drawing is skipped.
+//
+// The time spent drawing is measured against the wall clock. When it takes
+// more than the budget, the display steps down one level: every item, then
+// one sampled item per SampleInterval, then a per-ID summary table, then a
+// counters line. It steps back up once the level above is predicted to fit
+// in half the budget for a whole second, using the measured cost per item.
+class DisplayPolicy
+{
+public:
+    enum Level {
+        Full,
+        Sampled,
+        Summary,
+        Counters
+    };
+
+    enum {
+        EvaluateIntervalMs = 250,
+        SampleIntervalMs = 50,
+        SummaryIntervalMs = 500,
+        CountersIntervalMs = 1000
+    };
+
+    void reset();
+
+    Level level() const { return m_level; }
+    static QString levelName(Level level);
+
+    // Whether the item arriving now should be drawn; skipped items are counted.
+    bool offer(qint64 nowNs);
+    void drawn(qint64 costNs, int items = 1)
+    {
+        m_costNs += costNs;
+        m_drawn += items;
+    }
+
+    // Counts a received CAN frame; at Summary level it also goes into the
+    // per-ID table.
+    void countFrame(const STR_CANMSG_T &frame);
+
+    // Re-evaluates the level once per EvaluateIntervalMs; returns true if
+    // it changed.
+    bool update(qint64 nowNs);
+
+    qint64 skipped() const { return m_skipped; }
+
+    // Text for the Summary and Counters levels; the per-ID table starts
+    // over after each call.
+    QString takeSummary();
+    QString takeCounters(qint64 nowNs);
+
+private:
+    struct IdSummary {
+        quint32 id;
+        bool extended;
+        qint64 frames;
+        STR_CANMSG_T last;
+    };
+
+    double itemsPerSecond(Level level, double offeredPerSecond) const;
+
+    Level m_level = Full;
+    qint64 m_windowStartNs = -1;
+    qint64 m_costNs = 0;
+    qint64 m_offered = 0;
+    qint64 m_drawn = 0;
+    double m_nsPerItem = 0;
+    int m_calmWindows = 0;
+    qint64 m_nextSampleNs = 0;
+    qint64 m_skipped = 0;
+
+    qint64 m_frames = 0;
+    qint64 m_countersFrames = 0;
+    qint64 m_countersSkipped = 0;
+    qint64 m_countersStartNs = -1;
+    QHash<quint32, IdSummary> m_ids;
+    int m_summaryRows = 0;          // IDs in the last summary drawn
+};
+
+#endif // DISPLAYPOLICY_H
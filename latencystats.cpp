@@ -0,0 +1,320 @@
+#include "latencystats.h"
+
+#include <QFile>
+#include <QHeaderView>
+#include <QTableWidget>
+#include <QTextStream>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <QtAlgorithms>
+
+#include <limits>
+
+enum {
+    RefreshInterval = 500   // ms
+};
+
+LatencyHistogram::LatencyHistogram() :
+    m_counts(BucketCount, 0)
+{
+}
+
+int LatencyHistogram::bucketIndex(qint64 value)
+{
+    const quint64 v = qBound<qint64>(0, value, (Q_INT64_C(1) << MaxValueBits) - 1);
+    if (v < 2 * SubBuckets)
+        return static_cast<int>(v);
+
+    // Keep the top SubBucketBits + 1 bits: (v >> shift) is in [64, 128).
+    const int msb = 63 - qCountLeadingZeroBits(v);
+    const int shift = msb - SubBucketBits;
+    return (shift + 1) * SubBuckets + static_cast<int>((v >> shift) - SubBuckets);
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < 2 * SubBuckets)
+        return index;
+
+    const int shift = index / SubBuckets - 1;
+    const qint64 sub = index % SubBuckets + SubBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 valueNs)
+{
+    m_counts[bucketIndex(valueNs)]++;
+    m_min = m_count == 0 ? valueNs : qMin(m_min, valueNs);
+    m_max = qMax(m_max, valueNs);
+    m_total += valueNs;
+    m_count++;
+}
+
+void LatencyHistogram::reset()
+{
+    m_counts.fill(0);
+    m_count = 0;
+    m_total = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+qint64 LatencyHistogram::valueAtPercentile(double percentile) const
+{
+    if (m_count == 0)
+        return 0;
+
+    const qint64 target = qMax<qint64>(1, static_cast<qint64>(percentile / 100.0 * m_count + 0.5));
+    qint64 seen = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        seen += m_counts.at(i);
+        if (seen >= target)
+            return qMin(bucketUpperBound(i), m_max);
+    }
+    return m_max;
+}
+
+LatencyRecorder::LatencyRecorder()
+{
+    m_clock.start();
+}
+
+// A CAN ID is at most 29 bits; bit 29 keeps the extended flag.
+static quint32 keyId(quint32 id)
+{
+    return (id & 0x1FFFFFFF) | ((id & LatencyRecorder::ExtendedId) ? 0x20000000u : 0);
+}
+
+static QString idName(quint32 a)
+{
+    return QString("0x%1%2").arg(a & 0x1FFFFFFF, 0, 16).arg((a & 0x20000000) ? "x" : "");
+}
+
+quint64 LatencyRecorder::key(Kind kind, quint32 a, quint32 b, bool detail)
+{
+    // kind:3 | detail:1 | a:30 | b:30
+    return quint64(kind) << 61 | quint64(detail) << 60
+            | quint64(a & 0x3FFFFFFF) << 30 | quint64(b & 0x3FFFFFFF);
+}
+
+QString LatencyRecorder::keyName(quint64 key)
+{
+    static const char *const kinds[] = { "I2C read", "I2C write", "SPI transfer", "CAN" };
+    const int kind = static_cast<int>(key >> 61);
+    const bool detail = (key >> 60) & 1;
+    const quint32 a = (key >> 30) & 0x3FFFFFFF;
+    const quint32 b = key & 0x3FFFFFFF;
+
+    if (!detail)
+        return QString("%1 (all)").arg(kinds[kind]);
+    if (kind == CanRequest)
+        return QString("CAN %1 -> %2").arg(idName(a), idName(b));
+    return QString("%1 0x%2").arg(kinds[kind]).arg(a, 2, 16, QChar('0'));
+}
+
+void LatencyRecorder::recordTransaction(Kind kind, int address, qint64 latencyNs)
+{
+    m_series[key(kind, 0, 0, false)].histogram.record(latencyNs);
+    if (address >= 0)
+        m_series[key(kind, static_cast<quint32>(address), 0, true)].histogram.record(latencyNs);
+}
+
+void LatencyRecorder::recordTimeout(Kind kind, int address)
+{
+    m_series[key(kind, 0, 0, false)].timeouts++;
+    if (address >= 0)
+        m_series[key(kind, static_cast<quint32>(address), 0, true)].timeouts++;
+}
+
+void LatencyRecorder::setCanPairs(const QVector<QPair<quint32, quint32> > &pairs)
+{
+    m_canPairs.clear();
+    m_canRequests.clear();
+    m_canPending.clear();
+    for (const auto &pair : pairs) {
+        m_canPairs.insert(pair.first, pair.second);
+        m_canRequests.insert(pair.second, pair.first);
+    }
+}
+
+QVector<QPair<quint32, quint32> > LatencyRecorder::canPairs() const
+{
+    QVector<QPair<quint32, quint32> > pairs;
+    for (auto it = m_canPairs.cbegin(); it != m_canPairs.cend(); ++it)
+        pairs.append(qMakePair(it.key(), it.value()));
+    return pairs;
+}
+
+void LatencyRecorder::canSent(quint32 id, bool extended)
+{
+    const qint64 now = nowNs();
+    expireCan(now);
+
+    const auto it = m_canPairs.constFind(extended ? id | ExtendedId : id);
+    if (it == m_canPairs.constEnd())
+        return;
+
+    // A request still pending is superseded; only the newest one is timed.
+    if (m_canPending.isEmpty())
+        m_canDeadline = now + m_timeoutNs;
+    m_canPending.insert(it.value(), now);
+}
+
+void LatencyRecorder::canReceived(quint32 id, bool extended)
+{
+    if (m_canPending.isEmpty())
+        return;
+
+    const qint64 now = nowNs();
+    expireCan(now);
+
+    const quint32 response = extended ? id | ExtendedId : id;
+    const auto it = m_canPending.find(response);
+    if (it == m_canPending.end())
+        return;
+
+    const qint64 latency = now - it.value();
+    m_canPending.erase(it);
+
+    const quint32 request = m_canRequests.value(response);
+    m_series[key(CanRequest, 0, 0, false)].histogram.record(latency);
+    m_series[key(CanRequest, keyId(request), keyId(response), true)].histogram.record(latency);
+}
+
+void LatencyRecorder::expireCan(qint64 now)
+{
+    if (m_canPending.isEmpty() || now < m_canDeadline)
+        return;
+
+    qint64 deadline = 0;
+    for (auto it = m_canPending.begin(); it != m_canPending.end(); ) {
+        const qint64 expiry = it.value() + m_timeoutNs;
+        if (now < expiry) {
+            deadline = deadline == 0 ? expiry : qMin(deadline, expiry);
+            ++it;
+            continue;
+        }
+        const quint32 request = m_canRequests.value(it.key());
+        m_series[key(CanRequest, 0, 0, false)].timeouts++;
+        m_series[key(CanRequest, keyId(request), keyId(it.key()), true)].timeouts++;
+        it = m_canPending.erase(it);
+    }
+    m_canDeadline = deadline;
+}
+
+void LatencyRecorder::expire(bool all)
+{
+    expireCan(all ? std::numeric_limits<qint64>::max() : nowNs());
+}
+
+QVector<LatencyRecorder::Summary> LatencyRecorder::summaries() const
+{
+    QVector<Summary> result;
+    result.reserve(m_series.size());
+    for (auto it = m_series.cbegin(); it != m_series.cend(); ++it) {
+        const LatencyHistogram &h = it.value().histogram;
+        Summary s;
+        s.name = keyName(it.key());
+        s.count = h.count();
+        s.timeouts = it.value().timeouts;
+        s.minimum = h.minimum();
+        s.p50 = h.valueAtPercentile(50.0);
+        s.p90 = h.valueAtPercentile(90.0);
+        s.p99 = h.valueAtPercentile(99.0);
+        s.p999 = h.valueAtPercentile(99.9);
+        s.maximum = h.maximum();
+        result.append(s);
+    }
+    return result;
+}
+
+bool LatencyRecorder::exportCsv(const QString &fileName, QString *errorString) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (errorString)
+            *errorString = file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "series,count,timeouts,min_us,p50_us,p90_us,p99_us,p99.9_us,max_us\n";
+    for (const Summary &s : summaries()) {
+        out << '"' << s.name << "\"," << s.count << ',' << s.timeouts;
+        for (qint64 ns : { s.minimum, s.p50, s.p90, s.p99, s.p999, s.maximum })
+            out << ',' << QString::number(ns / 1000.0, 'f', 3);
+        out << '\n';
+    }
+    return true;
+}
+
+void LatencyRecorder::reset()
+{
+    m_series.clear();
+    m_canPending.clear();
+}
+
+LatencyWindow::LatencyWindow(LatencyRecorder *recorder, QWidget *parent) :
+    QWidget(parent, Qt::Window),
+    m_recorder(recorder),
+    m_table(new QTableWidget),
+    m_timer(new QTimer(this))
+{
+    setWindowTitle(tr("Latency Statistics"));
+    resize(720, 300);
+
+    const QStringList headers = { tr("Series"), tr("Count"), tr("Timeouts"), tr("Min"), tr("p50"),
+                                  tr("p90"), tr("p99"), tr("p99.9"), tr("Max") };
+    m_table->setColumnCount(headers.size());
+    m_table->setHorizontalHeaderLabels(headers);
+    m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_table->verticalHeader()->hide();
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(m_table);
+
+    m_timer->setInterval(RefreshInterval);
+    connect(m_timer, &QTimer::timeout, this, &LatencyWindow::refresh);
+}
+
+void LatencyWindow::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refresh();
+    m_timer->start();
+}
+
+void LatencyWindow::hideEvent(QHideEvent *event)
+{
+    m_timer->stop();
+    QWidget::hideEvent(event);
+}
+
+void LatencyWindow::refresh()
+{
+    m_recorder->expire();
+    const QVector<LatencyRecorder::Summary> rows = m_recorder->summaries();
+    m_table->setRowCount(rows.size());
+
+    auto setCell = [this](int row, int column, const QString &text) {
+        QTableWidgetItem *item = m_table->item(row, column);
+        if (item == nullptr) {
+            item = new QTableWidgetItem;
+            if (column > 0)
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            m_table->setItem(row, column, item);
+        }
+        item->setText(text);
+    };
+
+    for (int row = 0; row < rows.size(); row++) {
+        const LatencyRecorder::Summary &s = rows.at(row);
+        setCell(row, 0, s.name);
+        setCell(row, 1, QString::number(s.count));
+        setCell(row, 2, QString::number(s.timeouts));
+        int column = 3;
+        for (qint64 ns : { s.minimum, s.p50, s.p90, s.p99, s.p999, s.maximum })
+            setCell(row, column++, QString("%1 ms").arg(ns / 1e6, 0, 'f', 3));
+    }
+}
@@ -0,0 +1,150 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include <QWidget>
+
+QT_BEGIN_NAMESPACE
+
+class QTableWidget;
+class QTimer;
+
+QT_END_NAMESPACE
+
+// Log-bucketed histogram in the style of HdrHistogram: every power of two is
+// split into SubBuckets linear buckets, so any recorded value is reported
+// within 1/SubBuckets of its true value, from nanoseconds up to about 18
+// minutes, with a fixed 2240-slot table and no allocation per sample.
+class LatencyHistogram
+{
+public:
+    enum {
+        SubBucketBits = 6,
+        SubBuckets = 1 << SubBucketBits,
+        MaxValueBits = 40,
+        BucketCount = (MaxValueBits - SubBucketBits + 1) * SubBuckets
+    };
+
+    LatencyHistogram();
+
+    void record(qint64 valueNs);
+    void reset();
+
+    qint64 count() const { return m_count; }
+    qint64 minimum() const { return m_count > 0 ? m_min : 0; }
+    qint64 maximum() const { return m_max; }
+    qint64 mean() const { return m_count > 0 ? m_total / m_count : 0; }
+
+    // Upper bound of the bucket holding the given percentile (0..100).
+    qint64 valueAtPercentile(double percentile) const;
+
+private:
+    static int bucketIndex(qint64 value);
+    static qint64 bucketUpperBound(int index);
+
+    QVector<quint32> m_counts;
+    qint64 m_count = 0;
+    qint64 m_total = 0;
+    qint64 m_min = 0;
+    qint64 m_max = 0;
+};
+
+// Latency histograms per transaction type, per I2C address and per CAN
+// request/response ID pair. A CAN pair is timed from sending a frame with
+// the request ID to the next received frame with the paired response ID;
+// a request left unanswered past the timeout counts as a timeout. CAN IDs
+// in pairs carry ExtendedId for 29-bit IDs, so 0x123 and 0x123x differ.
+class LatencyRecorder
+{
+public:
+    enum : quint32 {
+        ExtendedId = 0x80000000u
+    };
+
+    enum Kind {
+        I2cRead,
+        I2cWrite,
+        SpiTransfer,
+        CanRequest
+    };
+
+    struct Summary {
+        QString name;
+        qint64 count;
+        qint64 timeouts;
+        qint64 minimum;
+        qint64 p50;
+        qint64 p90;
+        qint64 p99;
+        qint64 p999;
+        qint64 maximum;
+    };
+
+    LatencyRecorder();
+
+    qint64 nowNs() const { return m_clock.nsecsElapsed(); }
+
+    // address is -1 for transactions without one (SPI).
+    void recordTransaction(Kind kind, int address, qint64 latencyNs);
+    void recordTimeout(Kind kind, int address);
+
+    // Same deadline as the I2C/SPI transaction queue.
+    void setTimeout(int ms) { m_timeoutNs = ms * Q_INT64_C(1000000); }
+
+    void setCanPairs(const QVector<QPair<quint32, quint32> > &pairs);
+    QVector<QPair<quint32, quint32> > canPairs() const;
+    void canSent(quint32 id, bool extended);
+    void canReceived(quint32 id, bool extended);
+    // Counts requests past their deadline as timeouts, or with all set,
+    // every request still waiting (when the port closes).
+    void expire(bool all = false);
+
+    bool isEmpty() const { return m_series.isEmpty(); }
+    QVector<Summary> summaries() const;
+    bool exportCsv(const QString &fileName, QString *errorString = nullptr) const;
+    void reset();
+
+private:
+    struct Series {
+        LatencyHistogram histogram;
+        qint64 timeouts = 0;
+    };
+
+    static quint64 key(Kind kind, quint32 a, quint32 b, bool detail);
+    static QString keyName(quint64 key);
+    void expireCan(qint64 now);
+
+    QElapsedTimer m_clock;
+    QMap<quint64, Series> m_series;
+    QHash<quint32, quint32> m_canPairs;      // request ID -> response ID
+    QHash<quint32, quint32> m_canRequests;   // response ID -> request ID
+    QHash<quint32, qint64> m_canPending;     // response ID -> send time
+    qint64 m_canDeadline = 0;                // earliest pending expiry
+    qint64 m_timeoutNs = 500 * Q_INT64_C(1000000);
+};
+
+class LatencyWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LatencyWindow(LatencyRecorder *recorder, QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void refresh();
+
+private:
+    LatencyRecorder *m_recorder;
+    QTableWidget *m_table = nullptr;
+    QTimer *m_timer = nullptr;
+};
+
+#endif // LATENCYSTATS_H
@@ -0,0 +1,20 @@
+# Headless bridge library with the C API in nubridge.h:
+#   qmake libnubridge.pro && make
+# Add CONFIG+=staticlib for a static build, and define NUBRIDGE_STATIC
+# in the code that links it.
+
+QT = core serialport
+
+CONFIG += c++14 hide_symbols
+
+TARGET = nubridge
+TEMPLATE = lib
+VERSION = 1.0.0
+
+DEFINES += NUBRIDGE_BUILD
+
+include(nubridge.pri)
+
+SOURCES += nubridge.cpp
+
+HEADERS += nubridge.h
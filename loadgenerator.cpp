@@ -0,0 +1,417 @@
+#include "loadgenerator.h"
+#include "bridgecodec.h"
+#include "tracerecorder.h"
+
+#include <QRegularExpression>
+#include <QTimer>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+enum {
+    MaxBatch = 1024,            // frames per pass before yielding to the event loop
+    MaxLength = 4096,           // I2C / SPI payload
+    MaxZipfIds = 0x10000
+};
+
+static bool parseId(const QString &text, quint32 *id, bool *extended)
+{
+    QString digits = text;
+    *extended = digits.endsWith('x', Qt::CaseInsensitive);
+    if (*extended)
+        digits.chop(1);
+
+    bool ok = false;
+    *id = digits.toUInt(&ok, 16);
+    if (!ok || *id > 0x1FFFFFFF)
+        return false;
+    if (*id > 0x7FF)
+        *extended = true;
+    return true;
+}
+
+// "<n>" or "<lo>-<hi>"
+static bool parseRange(const QString &text, int base, quint32 *low, quint32 *high)
+{
+    const QStringList parts = text.split('-');
+    if (parts.size() > 2)
+        return false;
+    bool okLow = false;
+    bool okHigh = false;
+    *low = parts.at(0).toUInt(&okLow, base);
+    *high = parts.size() == 2 ? parts.at(1).toUInt(&okHigh, base) : *low;
+    return okLow && (parts.size() == 1 || okHigh) && *low <= *high;
+}
+
+bool LoadProfile::parse(const QString &text, LoadProfile *profile, QString *errorString)
+{
+    LoadProfile p = *profile;
+
+    const QStringList words = text.trimmed().split(QRegularExpression("\\s+"));
+    for (const QString &word : words) {
+        if (word.isEmpty())
+            continue;
+
+        auto fail = [&](const QString &reason) {
+            if (errorString)
+                *errorString = QObject::tr("%1: %2").arg(word).arg(reason);
+            return false;
+        };
+
+        const int eq = word.indexOf('=');
+        if (eq <= 0)
+            return fail(QObject::tr("expected key=value"));
+        const QString key = word.left(eq).toLower();
+        const QString value = word.mid(eq + 1);
+        bool ok = true;
+
+        if (key == "mode") {
+            const QString mode = value.toLower();
+            if (mode == "can")
+                p.brgMode = BRG_MODE_CAN;
+            else if (mode == "i2c")
+                p.brgMode = BRG_MODE_I2C;
+            else if (mode == "spi")
+                p.brgMode = BRG_MODE_SPI;
+            else
+                return fail(QObject::tr("unknown mode"));
+        } else if (key == "rate") {
+            p.rate = value.toDouble(&ok);
+            if (!ok || p.rate <= 0)
+                return fail(QObject::tr("invalid rate"));
+        } else if (key == "burst") {
+            p.burst = value.toInt(&ok);
+            if (!ok || p.burst < 1)
+                return fail(QObject::tr("invalid burst"));
+        } else if (key == "count") {
+            p.count = value.toLongLong(&ok);
+            if (!ok || p.count < 0)
+                return fail(QObject::tr("invalid count"));
+        } else if (key == "duration") {
+            p.duration = value.toDouble(&ok);
+            if (!ok || p.duration < 0)
+                return fail(QObject::tr("invalid duration"));
+        } else if (key == "seed") {
+            p.seed = value.toULongLong(&ok, 0);
+            if (!ok)
+                return fail(QObject::tr("invalid seed"));
+        } else if (key == "ids") {
+            p.idList.clear();
+            QString range = value;
+            if (range.startsWith("zipf:", Qt::CaseInsensitive)) {
+                p.ids = ZipfIds;
+                range = range.mid(5);
+            } else {
+                p.ids = range.contains(',') ? ListIds : UniformIds;
+            }
+
+            if (p.ids == ListIds) {
+                for (const QString &item : range.split(',')) {
+                    quint32 id = 0;
+                    bool extended = false;
+                    if (!parseId(item, &id, &extended))
+                        return fail(QObject::tr("invalid ID %1").arg(item));
+                    p.idList.append(id | (extended ? 0x80000000u : 0));
+                }
+            } else {
+                const QStringList parts = range.split('-');
+                bool lowExtended = false;
+                bool highExtended = false;
+                if (parts.size() > 2 || !parseId(parts.at(0), &p.idLow, &lowExtended)
+                        || !parseId(parts.value(1, parts.at(0)), &p.idHigh, &highExtended)
+                        || p.idLow > p.idHigh)
+                    return fail(QObject::tr("invalid ID range"));
+                p.extended = lowExtended || highExtended;
+                if (p.ids == ZipfIds && p.idHigh - p.idLow >= MaxZipfIds)
+                    return fail(QObject::tr("zipf ranges are limited to %1 IDs").arg(int(MaxZipfIds)));
+            }
+        } else if (key == "dlc") {
+            std::fill(p.dlcWeights, p.dlcWeights + 9, 0);
+            if (value.contains(':')) {
+                for (const QString &item : value.split(',')) {
+                    const QStringList kv = item.split(':');
+                    bool okDlc = false;
+                    bool okWeight = false;
+                    const int dlc = kv.value(0).toInt(&okDlc);
+                    const int weight = kv.value(1).toInt(&okWeight);
+                    if (kv.size() != 2 || !okDlc || !okWeight || dlc < 0 || dlc > 8 || weight < 0)
+                        return fail(QObject::tr("invalid DLC weight %1").arg(item));
+                    p.dlcWeights[dlc] += weight;
+                }
+            } else {
+                quint32 low = 0;
+                quint32 high = 0;
+                if (!parseRange(value, 10, &low, &high) || high > 8)
+                    return fail(QObject::tr("invalid DLC"));
+                for (quint32 dlc = low; dlc <= high; dlc++)
+                    p.dlcWeights[dlc] = 1;
+            }
+            if (std::accumulate(p.dlcWeights, p.dlcWeights + 9, 0) <= 0)
+                return fail(QObject::tr("all DLC weights are zero"));
+        } else if (key == "rtr") {
+            p.remoteFraction = value.toDouble(&ok);
+            if (!ok || p.remoteFraction < 0 || p.remoteFraction > 1)
+                return fail(QObject::tr("invalid fraction"));
+        } else if (key == "addr") {
+            const uint address = value.toUInt(&ok, 16);
+            if (!ok || address > 0x7F)
+                return fail(QObject::tr("invalid I2C address"));
+            p.address = static_cast<quint8>(address);
+        } else if (key == "read") {
+            p.readFraction = value.toDouble(&ok);
+            if (!ok || p.readFraction < 0 || p.readFraction > 1)
+                return fail(QObject::tr("invalid fraction"));
+        } else if (key == "len") {
+            quint32 low = 0;
+            quint32 high = 0;
+            if (!parseRange(value, 10, &low, &high) || low < 1 || high > MaxLength)
+                return fail(QObject::tr("invalid length, 1 to %1").arg(int(MaxLength)));
+            p.minLength = static_cast<int>(low);
+            p.maxLength = static_cast<int>(high);
+        } else {
+            return fail(QObject::tr("unknown key"));
+        }
+    }
+
+    if (p.rate <= 0) {
+        if (errorString)
+            *errorString = QObject::tr("rate is required");
+        return false;
+    }
+
+    *profile = p;
+    return true;
+}
+
+LoadGenerator::LoadGenerator(QObject *parent) :
+    QObject(parent),
+    m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &LoadGenerator::sendDue);
+}
+
+bool LoadGenerator::start(const LoadProfile &profile, QString *errorString)
+{
+    stop();
+
+    if (profile.rate <= 0 || profile.burst < 1) {
+        if (errorString)
+            *errorString = tr("No rate given");
+        return false;
+    }
+
+    m_profile = profile;
+
+    // splitmix64 turns any seed, 0 included, into a usable xorshift state.
+    quint64 z = profile.seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    m_random = (z ^ (z >> 31)) | 1;
+
+    m_zipf.clear();
+    if (profile.ids == LoadProfile::ZipfIds) {
+        const int n = static_cast<int>(profile.idHigh - profile.idLow) + 1;
+        m_zipf.resize(n);
+        double total = 0;
+        for (int k = 0; k < n; k++) {
+            total += 1.0 / (k + 1);
+            m_zipf[k] = total;
+        }
+    }
+    m_dlcTotal = std::accumulate(profile.dlcWeights, profile.dlcWeights + 9, 0);
+
+    m_limit = profile.count;
+    if (profile.duration > 0) {
+        const qint64 frames = qMax<qint64>(1, qint64(profile.duration * profile.rate));
+        m_limit = m_limit > 0 ? qMin(m_limit, frames) : frames;
+    }
+
+    m_sent = 0;
+    m_bytes = 0;
+    m_maxLagUs = 0;
+    m_endUs = 0;
+    m_active = true;
+    m_clock.start();
+    m_timer->start(0);
+    return true;
+}
+
+void LoadGenerator::stop()
+{
+    if (m_active)
+        m_endUs = m_clock.nsecsElapsed() / 1000;
+    m_timer->stop();
+    m_active = false;
+}
+
+qint64 LoadGenerator::elapsedUs() const
+{
+    return m_active ? m_clock.nsecsElapsed() / 1000 : m_endUs;
+}
+
+double LoadGenerator::achievedRate() const
+{
+    // The first frame goes out at time 0, so n frames span n - 1 intervals.
+    const qint64 us = elapsedUs();
+    return m_sent > 1 && us > 0 ? (m_sent - 1) * 1e6 / us : 0;
+}
+
+QString LoadGenerator::summary() const
+{
+    const double achieved = achievedRate();
+    return tr("requested %1/s, achieved %2/s (%3 %), %4 frames, %5 bytes in %6 s, max lag %7 ms")
+            .arg(m_profile.rate, 0, 'f', 0)
+            .arg(achieved, 0, 'f', 0)
+            .arg(100.0 * achieved / m_profile.rate, 0, 'f', 1)
+            .arg(m_sent)
+            .arg(m_bytes)
+            .arg(elapsedUs() / 1e6, 0, 'f', 2)
+            .arg(m_maxLagUs / 1000.0, 0, 'f', 1);
+}
+
+// Burst k (frames k * burst onwards) is released at k * burst / rate.
+void LoadGenerator::sendDue()
+{
+    TRACE_ZONE("generator.pass");
+    const double burstUs = 1e6 * m_profile.burst / m_profile.rate;
+    const qint64 nowUs = m_clock.nsecsElapsed() / 1000;
+    qint64 due = (qint64(nowUs / burstUs) + 1) * m_profile.burst;
+    if (m_limit > 0)
+        due = qMin(due, m_limit);
+
+    if (due > m_sent) {
+        const qint64 releasedUs = qint64((m_sent / m_profile.burst) * burstUs);
+        m_maxLagUs = qMax(m_maxLagUs, nowUs - releasedUs);
+    }
+
+    for (int n = 0; m_sent < due && n < MaxBatch; n++) {
+        switch (m_profile.brgMode) {
+        case BRG_MODE_CAN:
+            nextCanFrame();
+            break;
+        case BRG_MODE_I2C:
+            nextI2cFrame();
+            break;
+        default:
+            nextSpiFrame();
+            break;
+        }
+        m_sent++;
+        m_bytes += m_frame.size();
+        emit frameReady(m_frame);
+        if (!m_active)
+            return;         // stopped from a connected slot
+    }
+
+    if (m_limit > 0 && m_sent >= m_limit) {
+        stop();
+        emit finished();
+        return;
+    }
+
+    if (m_sent < due) {
+        m_timer->start(0);
+        return;
+    }
+
+    const qint64 nextUs = qint64((m_sent / m_profile.burst) * burstUs);
+    const qint64 waitUs = nextUs - m_clock.nsecsElapsed() / 1000;
+    m_timer->start(waitUs > 0 ? static_cast<int>((waitUs + 999) / 1000) : 0);
+}
+
+// xorshift64*
+quint64 LoadGenerator::nextRandom()
+{
+    m_random ^= m_random >> 12;
+    m_random ^= m_random << 25;
+    m_random ^= m_random >> 27;
+    return m_random * 0x2545F4914F6CDD1Dull;
+}
+
+int LoadGenerator::randomLength()
+{
+    return m_profile.minLength + randomBelow(m_profile.maxLength - m_profile.minLength + 1);
+}
+
+void LoadGenerator::fillRandom(char *data, int size)
+{
+    while (size > 0) {
+        // Byte order fixed, so a seed gives the same bytes on every host.
+        uchar bytes[8];
+        qToLittleEndian(nextRandom(), bytes);
+        const int n = qMin(size, 8);
+        memcpy(data, bytes, n);
+        data += n;
+        size -= n;
+    }
+}
+
+void LoadGenerator::nextCanFrame()
+{
+    STR_CANMSG_T msg;
+    memset(&msg, 0, sizeof(msg));
+
+    bool extended = m_profile.extended;
+    switch (m_profile.ids) {
+    case LoadProfile::ZipfIds: {
+        const double pick = randomFraction() * m_zipf.last();
+        const int rank = static_cast<int>(std::upper_bound(m_zipf.constBegin(), m_zipf.constEnd(), pick)
+                                          - m_zipf.constBegin());
+        msg.Id = m_profile.idLow + static_cast<quint32>(qMin(rank, m_zipf.size() - 1));
+        break;
+    }
+    case LoadProfile::ListIds: {
+        const quint32 entry = m_profile.idList.at(randomBelow(m_profile.idList.size()));
+        msg.Id = entry & 0x1FFFFFFF;
+        extended = (entry & 0x80000000u) != 0;
+        break;
+    }
+    default:
+        msg.Id = m_profile.idLow + static_cast<quint32>(randomBelow(int(m_profile.idHigh - m_profile.idLow) + 1));
+        break;
+    }
+    msg.IdType = extended ? CAN_EXT_ID : CAN_STD_ID;
+
+    int pick = randomBelow(m_dlcTotal);
+    int dlc = 0;
+    while (pick >= m_profile.dlcWeights[dlc])
+        pick -= m_profile.dlcWeights[dlc++];
+    msg.DLC = static_cast<unsigned char>(dlc);
+
+    if (m_profile.remoteFraction > 0 && randomFraction() < m_profile.remoteFraction) {
+        msg.FrameType = CAN_REMOTE_FRAME;
+    } else {
+        msg.FrameType = CAN_DATA_FRAME;
+        fillRandom(msg.Data, dlc);
+    }
+
+    m_frame.resize(BridgeCodec::CanMessageSize);
+    BridgeCodec::encodeCanMessage(msg, m_frame.data(), m_frame.size());
+}
+
+void LoadGenerator::nextI2cFrame()
+{
+    const int length = randomLength();
+    if (randomFraction() < m_profile.readFraction) {
+        m_frame.resize(BridgeCodec::I2cReadSize);
+        BridgeCodec::encodeI2cRead(m_profile.address, length, m_frame.data(), m_frame.size());
+        return;
+    }
+
+    m_payload.resize(length);
+    fillRandom(m_payload.data(), length);
+    m_frame.resize(BridgeCodec::i2cWriteSize(length));
+    BridgeCodec::encodeI2cWrite(m_profile.address, m_payload.constData(), length,
+                                m_frame.data(), m_frame.size());
+}
+
+void LoadGenerator::nextSpiFrame()
+{
+    const int length = randomLength();
+    m_frame.resize(length);
+    fillRandom(m_frame.data(), length);
+}
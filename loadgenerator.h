@@ -0,0 +1,128 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVector>
+
+#include "bridgeport.h"
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+
+QT_END_NAMESPACE
+
+// What LoadGenerator sends, parsed from a line of space separated
+// key=value pairs, e.g.
+//   mode=can rate=5000 burst=20 ids=zipf:100-1ff dlc=8:3,0:1 seed=7 duration=10
+//
+//   mode=can|i2c|spi       interface; defaults to the caller's mode
+//   rate=<n>               frames per second (required)
+//   burst=<n>              frames released back to back; the average rate
+//                          is unchanged
+//   count=<n>              stop after n frames
+//   duration=<s>           stop after s seconds
+//   seed=<n>               same seed, same frames
+//   ids=<lo>-<hi>          uniform CAN IDs; zipf:<lo>-<hi> favours low IDs
+//                          (rank k sent 1/k as often); <id>,<id>,... picks
+//                          from a list. IDs are hex, a trailing 'x' or a
+//                          value above 0x7FF marks an extended ID.
+//   dlc=<n>|<lo>-<hi>|<n>:<weight>,...
+//   rtr=<fraction>         share of remote frames
+//   addr=<hex>             I2C address
+//   read=<fraction>        share of I2C reads, the rest are writes
+//   len=<n>|<lo>-<hi>      I2C / SPI payload length
+struct LoadProfile {
+    enum IdDistribution {
+        UniformIds,
+        ZipfIds,
+        ListIds
+    };
+
+    int brgMode = BRG_MODE_CAN;
+    double rate = 0;
+    int burst = 1;
+    qint64 count = 0;
+    double duration = 0;
+    quint64 seed = 1;
+
+    IdDistribution ids = UniformIds;
+    quint32 idLow = 0;
+    quint32 idHigh = 0x7FF;
+    bool extended = false;
+    QVector<quint32> idList;    // bit 31 marks an extended ID
+    int dlcWeights[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+    double remoteFraction = 0;
+
+    quint8 address = 0x50;
+    double readFraction = 0.5;
+    int minLength = 1;
+    int maxLength = 8;
+
+    static bool parse(const QString &text, LoadProfile *profile, QString *errorString = nullptr);
+};
+
+// Sends seeded synthetic traffic at a target rate. Frames are emitted in
+// the form the send box uses (a packed STR_CANMSG_T, an encoded I2C
+// request or the SPI MOSI bytes), so they take the same path to the port
+// or the loopback. Frames that are due go out in one pass, so a late
+// timer catches up; a receiver that can't keep up shows as lag and a
+// lower achieved rate.
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoadGenerator(QObject *parent = nullptr);
+
+    bool start(const LoadProfile &profile, QString *errorString = nullptr);
+    void stop();
+    bool isActive() const { return m_active; }
+
+    const LoadProfile &profile() const { return m_profile; }
+    qint64 framesSent() const { return m_sent; }
+    qint64 bytesSent() const { return m_bytes; }
+    qint64 maxLagUs() const { return m_maxLagUs; }
+    qint64 elapsedUs() const;
+    double achievedRate() const;
+
+    // "requested 5000/s, achieved 4998/s (99.9 %), 50000 frames, ..."
+    QString summary() const;
+
+signals:
+    void frameReady(const QByteArray &frame);
+    void finished();
+
+private slots:
+    void sendDue();
+
+private:
+    quint64 nextRandom();
+    int randomBelow(int n) { return static_cast<int>((nextRandom() >> 32) * quint64(n) >> 32); }
+    double randomFraction() { return (nextRandom() >> 11) * (1.0 / 9007199254740992.0); }
+    int randomLength();
+    void fillRandom(char *data, int size);
+    void nextCanFrame();
+    void nextI2cFrame();
+    void nextSpiFrame();
+
+    LoadProfile m_profile;
+    QVector<double> m_zipf;     // cumulative weights by rank
+    int m_dlcTotal = 0;
+    quint64 m_random = 0;
+    QByteArray m_frame;
+    QByteArray m_payload;
+
+    QTimer *m_timer = nullptr;
+    QElapsedTimer m_clock;
+    qint64 m_limit = 0;         // frames to send, 0 until stopped
+    qint64 m_sent = 0;
+    qint64 m_bytes = 0;
+    qint64 m_maxLagUs = 0;
+    qint64 m_endUs = 0;
+    bool m_active = false;
+};
+
+#endif // LOADGENERATOR_H
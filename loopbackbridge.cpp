@@ -0,0 +1,132 @@
+#include "loopbackbridge.h"
+#include "bridgecodec.h"
+#include "bridgeport.h"
+#include "tracerecorder.h"
+
+#include <QTimer>
+
+LoopbackBridge::LoopbackBridge(QObject *parent) :
+    QObject(parent),
+    m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &LoopbackBridge::deliver);
+}
+
+void LoopbackBridge::start(int brgMode, int delayUs, int jitterUs)
+{
+    stop();
+
+    m_mode = brgMode;
+    m_delayUs = qMax(0, delayUs);
+    m_jitterUs = qMax(0, jitterUs);
+    m_lastDueNs = 0;
+    m_written = 0;
+    m_framesLooped = 0;
+    m_clock.start();
+    m_active = true;
+}
+
+void LoopbackBridge::stop()
+{
+    m_active = false;
+    m_timer->stop();
+    m_queue.clear();
+    m_written = 0;
+}
+
+void LoopbackBridge::setMode(int brgMode)
+{
+    // Answers to the old mode's requests would not parse in the new one.
+    m_mode = brgMode;
+    m_queue.clear();
+}
+
+void LoopbackBridge::write(const char *data, int size)
+{
+    if (!m_active || size <= 0)
+        return;
+
+    Pending pending;
+    switch (m_mode) {
+    case BRG_MODE_CAN: {
+        STR_CANMSG_T msg;
+        if (!BridgeCodec::decodeCanData(data, size, &msg))
+            break;
+        pending.data.resize(BridgeCodec::CanMessageSize);
+        BridgeCodec::encodeCanMessage(msg, pending.data.data(), pending.data.size());
+        break;
+    }
+    case BRG_MODE_I2C: {
+        quint8 address = 0;
+        int length = 0;
+        if (!BridgeCodec::decodeI2cRead(data, size, &address, &length))
+            break;
+        pending.data.resize(length);
+        for (int i = 0; i < length; i++)
+            pending.data[i] = static_cast<char>(i);
+        break;
+    }
+    default:
+        pending.data = QByteArray(data, size);
+        break;
+    }
+
+    m_written += size;
+    m_framesLooped++;
+
+    if (!pending.data.isEmpty()) {
+        qint64 delayNs = qint64(m_delayUs) * 1000;
+        if (m_jitterUs > 0)
+            delayNs += qint64(nextRandom() % quint64(m_jitterUs + 1)) * 1000;
+        pending.dueNs = qMax(m_clock.nsecsElapsed() + delayNs, m_lastDueNs);
+        m_lastDueNs = pending.dueNs;
+        m_queue.enqueue(pending);
+    }
+    schedule();
+}
+
+void LoopbackBridge::schedule()
+{
+    qint64 waitNs;
+    if (m_written > 0)
+        waitNs = 0;
+    else if (!m_queue.isEmpty())
+        waitNs = m_queue.head().dueNs - m_clock.nsecsElapsed();
+    else
+        return;
+
+    const int ms = waitNs > 0 ? int((waitNs + 999999) / 1000000) : 0;
+    if (!m_timer->isActive() || m_timer->remainingTime() > ms)
+        m_timer->start(ms);
+}
+
+void LoopbackBridge::deliver()
+{
+    TRACE_ZONE("loopback.deliver");
+    if (m_written > 0) {
+        const qint64 written = m_written;
+        m_written = 0;
+        emit bytesWritten(written);
+    }
+
+    const qint64 now = m_clock.nsecsElapsed();
+    m_batch.resize(0);
+    while (!m_queue.isEmpty() && m_queue.head().dueNs <= now)
+        m_batch.append(m_queue.dequeue().data);
+    if (!m_batch.isEmpty())
+        emit dataReceived(m_batch);
+
+    if (m_active)
+        schedule();
+}
+
+// xorshift64*; the jitter only needs to be spread, not reproducible.
+quint64 LoopbackBridge::nextRandom()
+{
+    m_random ^= m_random >> 12;
+    m_random ^= m_random << 25;
+    m_random ^= m_random >> 27;
+    return m_random * 0x2545F4914F6CDD1Dull;
+}
@@ -0,0 +1,75 @@
+#ifndef LOOPBACKBRIDGE_H
+#define LOOPBACKBRIDGE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QQueue>
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+
+QT_END_NAMESPACE
+
+// Stands in for the bridge when no adapter is attached: every frame the
+// host writes comes back the way the firmware would answer it, so the
+// whole receive path can be exercised offline. A CAND frame returns as a
+// received STR_CANMSG_T, an I2C read returns the requested number of bytes
+// (a counting pattern), an I2C write returns nothing and SPI returns MOSI
+// as MISO, as if the two lines were wired together.
+//
+// Answers are delivered after the configured delay plus a uniform random
+// jitter, never out of order; everything due at the same time arrives as
+// one read. bytesWritten is emitted for each frame from the event loop,
+// like QSerialPort does.
+class LoopbackBridge : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoopbackBridge(QObject *parent = nullptr);
+
+    void start(int brgMode, int delayUs, int jitterUs);
+    void stop();
+    bool isActive() const { return m_active; }
+
+    void setMode(int brgMode);
+    int mode() const { return m_mode; }
+
+    // One frame as it would be written to the port.
+    void write(const char *data, int size);
+
+    qint64 framesLooped() const { return m_framesLooped; }
+
+signals:
+    void dataReceived(const QByteArray &data);
+    void bytesWritten(qint64 bytes);
+
+private slots:
+    void deliver();
+
+private:
+    struct Pending {
+        qint64 dueNs;
+        QByteArray data;
+    };
+
+    void schedule();
+    quint64 nextRandom();
+
+    QTimer *m_timer = nullptr;
+    QElapsedTimer m_clock;
+    QQueue<Pending> m_queue;
+    QByteArray m_batch;
+    qint64 m_lastDueNs = 0;
+    qint64 m_written = 0;
+    qint64 m_framesLooped = 0;
+    int m_mode = 0;
+    int m_delayUs = 0;
+    int m_jitterUs = 0;
+    quint64 m_random = 0x9E3779B97F4A7C15ull;
+    bool m_active = false;
+};
+
+#endif // LOOPBACKBRIDGE_H
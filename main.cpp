@@ -49,13 +49,239 @@
 ****************************************************************************/
 
 #include "mainwindow.h"
+#include "captureconverter.h"
+#include "loadgenerator.h"
+#include "loopbackbridge.h"
+#include "streamintegrity.h"
+#include "tracerecorder.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSerialPort>
+#include <QSerialPortInfo>
+#include <QTimer>
+
+#include <cstring>
+
+enum {
+    DrainTime = 500     // ms to wait for answers after the last frame
+};
+
+// Options that run without a window.
+static bool isCommandLineMode(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--convert", 9) == 0 || strncmp(argv[i], "--generate", 10) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Drives a bridge, a pty or the loopback with LoadGenerator until the
+// profile's count or duration is reached, then reports what went out and
+// what came back.
+static int runGenerator(const QString &text, const QString &portName, qint32 clock)
+{
+    LoadProfile profile;
+    QString errorString;
+    if (!LoadProfile::parse(text, &profile, &errorString)) {
+        qCritical("%s", qPrintable(errorString));
+        return 2;
+    }
+    if (profile.count == 0 && profile.duration <= 0) {
+        qCritical("The profile needs count= or duration=");
+        return 2;
+    }
+
+    if (clock <= 0) {
+        if (profile.brgMode == BRG_MODE_I2C)
+            clock = 100000;
+        else if (profile.brgMode == BRG_MODE_SPI)
+            clock = 1000000;
+        else
+            clock = 500000;
+    }
+
+    LoadGenerator generator;
+    LoopbackBridge loopback;
+    QSerialPort port;
+    StreamIntegrity integrity;
+    QElapsedTimer readClock;
+    qint64 received = 0;
+
+    auto receive = [&](const char *data, int size) {
+        const qint64 timeUs = readClock.nsecsElapsed() / 1000;
+        received += size;
+        integrity.checkRead(size, timeUs);
+        if (profile.brgMode == BRG_MODE_CAN)
+            integrity.feedCan(data, size, timeUs, [](const STR_CANMSG_T &) {});
+    };
+    auto send = [&](const char *data, int size) {
+        if (loopback.isActive())
+            loopback.write(data, size);
+        else if (profile.brgMode == BRG_MODE_CAN)
+            port.write(data, size);
+        else
+            writeBridgeFrame(&port, data, size);
+    };
+
+    const bool useLoopback = portName.isEmpty() || portName == "loopback";
+    if (useLoopback) {
+        loopback.start(profile.brgMode, 0, 0);
+        QObject::connect(&loopback, &LoopbackBridge::dataReceived, [&](const QByteArray &data) {
+            receive(data.constData(), data.size());
+        });
+    } else {
+        // A pty or a port QSerialPortInfo doesn't list is opened by path.
+        const QSerialPortInfo info(portName);
+        BridgeConfig config = {};
+        config.name = info.isNull() ? portName : info.portName();
+        config.usbVendorID = info.vendorIdentifier();
+        config.usbProductID = info.productIdentifier();
+        if (profile.brgMode == BRG_MODE_I2C) {
+            setI2cParameters(&config, clock, 1);
+        } else if (profile.brgMode == BRG_MODE_SPI) {
+            setSpiParameters(&config, clock, 1, 0, false, false);
+        } else {
+            config.brgMode = BRG_MODE_CAN;
+            config.baudRate = clock;
+            config.dataBits = QSerialPort::Data8;
+            config.parity = QSerialPort::NoParity;
+            config.stopBits = QSerialPort::OneStop;
+            config.normalModeEnabled = true;
+        }
+        if (!openBridgePort(&port, config)) {
+            qCritical("%s: %s", qPrintable(portName), qPrintable(port.errorString()));
+            return 1;
+        }
+        QObject::connect(&port, &QSerialPort::readyRead, [&]() {
+            char buf[4096];
+            qint64 n;
+            while ((n = port.read(buf, sizeof(buf))) > 0)
+                receive(buf, static_cast<int>(n));
+        });
+    }
+
+    QObject::connect(&generator, &LoadGenerator::frameReady, [&](const QByteArray &frame) {
+        if (profile.brgMode == BRG_MODE_CAN) {
+            char data[BridgeCodec::CanDataSize];
+            const int size = BridgeCodec::wrapCanData(frame.constData(), frame.size(), data, sizeof(data));
+            send(data, size);
+        } else {
+            send(frame.constData(), frame.size());
+        }
+    });
+    QObject::connect(&generator, &LoadGenerator::finished, [&]() {
+        QTimer::singleShot(DrainTime, QCoreApplication::instance(), &QCoreApplication::quit);
+    });
+
+    readClock.start();
+    if (!generator.start(profile, &errorString)) {
+        qCritical("%s", qPrintable(errorString));
+        return 2;
+    }
+    QCoreApplication::exec();
+
+    qInfo("Sent: %s", qPrintable(generator.summary()));
+    const StreamIntegrity::Stats stats = integrity.stats();
+    if (profile.brgMode == BRG_MODE_CAN) {
+        qInfo("Received: %lld frames, %lld bytes skipped, longest stall %lld ms",
+              stats.frames, stats.skippedBytes, stats.longestStallUs / 1000);
+    } else {
+        qInfo("Received: %lld bytes, longest stall %lld ms", received, stats.longestStallUs / 1000);
+    }
+    return 0;
+}
+
+static int runCommandLine(const QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption convertOption("convert", "Convert a capture to text.", "capture");
+    const QCommandLineOption formatOption("format", "Output format: csv, candump or asc.", "format", "csv");
+    const QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                          "Output file; defaults to the capture name with the format's suffix.",
+                                          "file");
+    const QCommandLineOption generateOption("generate",
+                                            "Send synthetic traffic, e.g. \"mode=can rate=5000 ids=100-1ff duration=10\".",
+                                            "profile");
+    const QCommandLineOption portOption("port", "Port or pty for --generate; defaults to the offline loopback.", "port");
+    const QCommandLineOption clockOption("clock", "CAN bit rate or I2C / SPI clock for --generate.", "hz");
+    const QCommandLineOption traceOption("trace", "Write trace zones of --generate as Chrome trace-event JSON.", "file");
+    parser.addOption(convertOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.addOption(generateOption);
+    parser.addOption(portOption);
+    parser.addOption(clockOption);
+    parser.addOption(traceOption);
+    parser.process(app);
+
+    if (parser.isSet(generateOption)) {
+        if (parser.isSet(traceOption))
+            TraceRecorder::start();
+        const int result = runGenerator(parser.value(generateOption), parser.value(portOption),
+                                        parser.value(clockOption).toInt());
+        if (parser.isSet(traceOption)) {
+            TraceRecorder::stop();
+            QString errorString;
+            if (!TraceRecorder::writeJson(parser.value(traceOption), &errorString))
+                qCritical("%s", qPrintable(errorString));
+        }
+        return result;
+    }
+
+    CaptureConverter::Format format;
+    if (!CaptureConverter::formatFromName(parser.value(formatOption), &format)) {
+        qCritical("Unknown format %s", qPrintable(parser.value(formatOption)));
+        return 2;
+    }
+
+    const QString capture = parser.value(convertOption);
+    QString output = parser.value(outputOption);
+    if (output.isEmpty()) {
+        const QFileInfo info(capture);
+        output = info.path() + '/' + info.completeBaseName() + '.' + CaptureConverter::fileSuffix(format);
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    CaptureConverter converter;
+    QString errorString;
+    if (!converter.convert(capture, output, format, &errorString)) {
+        qCritical("%s", qPrintable(errorString));
+        return 1;
+    }
+
+    qInfo("Wrote %s in %.1f s", qPrintable(output), clock.elapsed() / 1000.0);
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    QElapsedTimer startup;
+    startup.start();
+
+    if (isCommandLineMode(argc, argv)) {
+        QCoreApplication a(argc, argv);
+        return runCommandLine(a);
+    }
+
     QApplication a(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption traceOption("trace",
+                                         "Record trace zones from startup and write them as Chrome trace-event JSON on exit.",
+                                         "file");
+    parser.addOption(traceOption);
+    parser.process(a);
+
     MainWindow w;
+    w.setStartupClock(startup);
+    if (parser.isSet(traceOption))
+        w.startTrace(parser.value(traceOption));
     w.show();
     return a.exec();
 }
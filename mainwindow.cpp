@@ -52,21 +52,70 @@
 #include "ui_mainwindow.h"
 #include "settingsdialog.h"
 #include "console.h"
+#include "deviceregistry.h"
 #include "Logger.h"
+#include "signalplot.h"
+#include "capturefile.h"
+#include "portreconnector.h"
+#include "bulktransfer.h"
+#include "transactionqueue.h"
+#include "bridgecodec.h"
+#include "latencystats.h"
+#include "streamserver.h"
+#include "socketcanbridge.h"
+#include "bridgeport.h"
+#include "cangateway.h"
+#include "captureviewer.h"
+#include "captureconverter.h"
+#include "candumpreader.h"
+#include "busload.h"
+#include "loopbackbridge.h"
+#include "loadgenerator.h"
+#include "tracerecorder.h"
+#include "writeledger.h"
 
 #include <QCloseEvent>
 #include <QDesktopServices>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QRegularExpression>
 #include <QTimer>
+#include <QtConcurrent>
 #include <QMessageBox>
+#include <QProgressDialog>
+
+#include <cstring>
+
+enum {
+    StreamPort = 50520,
+    DefaultCanBitRate = 500000
+};
+
+static const char StreamSocketName[] = "nutool-bridge";
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     m_ui(new Ui::MainWindow),
     m_status(new QLabel),
     m_written(new QLabel),
-    m_settings(new SettingsDialog),
+    m_displayLevel(new QLabel),
     m_serial(new QSerialPort(this)),
-    m_console(new Console)
+    m_console(new Console),
+    m_reconnector(new PortReconnector(this)),
+    m_bulk(new BulkTransfer(this)),
+    m_transactions(new BridgeTransactionQueue(this)),
+    m_stream(new StreamServer(this)),
+    m_socketCan(new SocketCanBridge(this)),
+    m_gateway(new CanGateway(this)),
+    m_replay(new CandumpReplay(this)),
+    m_loopback(new LoopbackBridge(this)),
+    m_generator(new LoadGenerator(this)),
+    m_latency(new LatencyRecorder),
+    m_busLoad(new BusLoadMeter),
+    m_writes(new WriteLedger)
 {
     m_ui->setupUi(this);
     m_ui->verticalLayout_4->addWidget(m_console);
@@ -76,6 +125,7 @@ MainWindow::MainWindow(QWidget *parent) :
     m_ui->statusBar->addPermanentWidget(m_status);
 
     m_ui->statusBar->addWidget(m_written);
+    m_ui->statusBar->addPermanentWidget(m_displayLevel);
 
     initActionsConnections();
 
@@ -88,15 +138,84 @@ MainWindow::MainWindow(QWidget *parent) :
             SLOT(processErrors(QSerialPort::SerialPortError)));
 #endif
     connect(m_serial, &QSerialPort::readyRead, this, &MainWindow::processReceivedFrames);
+    connect(m_reconnector, &PortReconnector::deviceFound, this, &MainWindow::reconnectSerialPort);
+
+    // Bulk chunks and queued transactions are retired on their own bytes only.
+    connect(m_serial, &QSerialPort::bytesWritten, this, &MainWindow::portBytesWritten);
+    connect(m_bulk, &BulkTransfer::sendFrame, [this](const QByteArray &frame) {
+        writeFrame(frame, WriteBulk);
+    });
+    connect(m_bulk, &BulkTransfer::progress, [this](qint64 done, qint64 total, double bytesPerSecond) {
+        m_written->setText(tr("Bulk: %1 / %2 KiB, %3 KiB/s")
+                           .arg(done / 1024).arg(total / 1024).arg(bytesPerSecond / 1024.0, 0, 'f', 1));
+    });
+    connect(m_transactions, &BridgeTransactionQueue::sendFrame, [this](const QByteArray &frame) {
+        writeFrame(frame, WriteTransactions);
+    });
+    connect(m_transactions, &BridgeTransactionQueue::finished, this, &MainWindow::processTransaction);
+    m_latency->setTimeout(m_transactions->timeout());
+    // Clients transmit the same frames the send box produces, if allowed.
+    connect(m_stream, &StreamServer::frameReceived, this, &MainWindow::sendClientFrame);
+    connect(m_stream, &StreamServer::clientCountChanged, [this](int count) {
+        m_ui->statusBar->showMessage(tr("Stream clients: %1").arg(count), 3000);
+    });
+    connect(m_socketCan, &SocketCanBridge::frameReceived, [this](const STR_CANMSG_T &frame) {
+        if (m_mode != BRG_MODE_CAN)
+            return;
+        char raw[BridgeCodec::CanMessageSize];
+        sendFrame(QByteArray(raw, BridgeCodec::encodeCanMessage(frame, raw, sizeof(raw))));
+    });
+    connect(m_gateway, &CanGateway::statisticsChanged, m_written, &QLabel::setText);
+    connect(m_gateway, &CanGateway::stopped, [this](const QString &reason) {
+        m_ui->actionGateway->setChecked(false);
+        QMessageBox::warning(this, tr("CAN Gateway"), reason);
+    });
+    connect(m_replay, &CandumpReplay::frameReady, this, &MainWindow::replayCanFrame);
+    connect(m_replay, &CandumpReplay::finished, [this]() {
+        const QSignalBlocker blocker(m_ui->actionReplayCandump);
+        m_ui->actionReplayCandump->setChecked(false);
+        m_written->setText(tr("Replay done: %1 frames, %2 lines skipped")
+                           .arg(m_replay->framesReplayed()).arg(m_replay->linesSkipped()));
+    });
+    connect(m_loopback, &LoopbackBridge::dataReceived, this, &MainWindow::receiveLoopback);
+    connect(m_loopback, &LoopbackBridge::bytesWritten, this, &MainWindow::portBytesWritten);
+    connect(m_generator, &LoadGenerator::frameReady, this, &MainWindow::sendFrame);
+    connect(m_generator, &LoadGenerator::finished, [this]() {
+        const QSignalBlocker blocker(m_ui->actionLoadGenerator);
+        m_ui->actionLoadGenerator->setChecked(false);
+        reportLoadGenerator();
+    });
+    connect(m_bulk, &BulkTransfer::finished, [this](bool ok, const QString &message) {
+        m_written->setText(message);
+        if (m_logger != 0) {
+            m_logger->write((ok ? "Bulk transfer done: " : "Bulk transfer failed: ") + message);
+        }
+    });
 
     for (int i = 0; i < 3; i++) {
         m_arrWidgets[i] = m_ui->sendFrameBox->widget(i);
     }
     m_ui->sendFrameBox->setTabBarAutoHide(true);
+
+    m_hexText.reserve(m_rxPool.stats().blockSize * 3 + 1);
+    m_captureClock.start();
+
+    m_displayTimer = new QTimer(this);
+    m_displayTimer->setInterval(DisplayPolicy::EvaluateIntervalMs);
+    connect(m_displayTimer, &QTimer::timeout, this, &MainWindow::updateDisplayLevel);
+    m_displayTimer->start();
+    updateDisplayLevel();
+
+    // Report the first paint of the console, then do deferred startup work.
+    m_console->viewport()->installEventFilter(this);
 }
 
 MainWindow::~MainWindow()
 {
+    delete m_latency;
+    delete m_busLoad;
+    delete m_writes;
+    delete m_capture;
     delete m_settings;
     delete m_ui;
 }
@@ -106,59 +225,230 @@ void MainWindow::initActionsConnections()
     m_ui->actionDisconnect->setEnabled(false);
 
     connect(m_ui->sendFrameBox, &SendFrameBox::sendFrame, this, &MainWindow::sendFrame);
-    connect(m_ui->actionConnect, &QAction::triggered, m_settings, &SettingsDialog::show);
-    connect(m_settings, &QDialog::accepted, this, &MainWindow::openSerialPort);
+    connect(m_ui->sendFrameBox, &SendFrameBox::i2cRead, [this](quint8 address, int size) {
+        m_transactions->i2cRead(address, size);
+    });
+    connect(m_ui->sendFrameBox, &SendFrameBox::i2cWrite, [this](quint8 address, const QByteArray &data) {
+        m_transactions->i2cWrite(address, data);
+    });
+    connect(m_ui->sendFrameBox, &SendFrameBox::spiTransfer, [this](const QByteArray &mosi) {
+        m_transactions->spiTransfer(mosi);
+    });
+    connect(m_ui->actionConnect, &QAction::triggered, [this]() {
+        // Normally built ahead of time; if not, the port scan and the
+        // dialog construction land here.
+        QElapsedTimer clock;
+        clock.start();
+        SettingsDialog *dialog = settingsDialog();
+        qInfo("Startup: settings dialog ready in %lld ms", clock.elapsed());
+        dialog->show();
+    });
     connect(m_ui->actionDisconnect, &QAction::triggered, this, &MainWindow::closeSerialPort);
     connect(m_ui->actionQuit, &QAction::triggered, this, &QWidget::close);
     connect(m_ui->actionAboutQt, &QAction::triggered, qApp, &QApplication::aboutQt);
     connect(m_ui->actionClearLog, &QAction::triggered, m_ui->receivedMessagesEdit, &QTextEdit::clear);
     connect(m_ui->actionClearLog, &QAction::triggered, m_console, &Console::clear);
+    connect(m_ui->actionChangesOnly, &QAction::toggled, [this](bool enable) {
+        m_changesOnly = enable;
+        m_changes.reset();
+    });
     connect(m_ui->actionAboutNuTool, &QAction::triggered, this, &MainWindow::aboutNuTool);
+    connect(m_ui->actionLoadDbc, &QAction::triggered, this, &MainWindow::loadDbc);
+    connect(m_ui->actionSignalPlot, &QAction::triggered, this, &MainWindow::showSignalPlot);
+    connect(m_ui->actionBulkTransfer, &QAction::triggered, this, &MainWindow::startBulkTransfer);
+    connect(m_ui->actionLatencyStats, &QAction::triggered, this, &MainWindow::showLatencyStats);
+    connect(m_ui->actionCanLatencyPairs, &QAction::triggered, this, &MainWindow::editCanLatencyPairs);
+    connect(m_ui->actionBusLoad, &QAction::triggered, this, &MainWindow::showBusLoad);
+    connect(m_ui->actionTrace, &QAction::toggled, this, &MainWindow::toggleTrace);
+    connect(m_ui->actionStreamServer, &QAction::toggled, this, &MainWindow::toggleStreamServer);
+    connect(m_ui->actionStreamTransmit, &QAction::toggled, m_stream, &StreamServer::setClientTransmit);
+    connect(m_ui->actionSocketCan, &QAction::toggled, this, &MainWindow::toggleSocketCan);
+    connect(m_ui->actionGateway, &QAction::toggled, this, &MainWindow::toggleGateway);
+    connect(m_ui->actionOpenCapture, &QAction::triggered, this, &MainWindow::openCapture);
+    connect(m_ui->actionConvertCapture, &QAction::triggered, this, &MainWindow::convertCapture);
+    connect(m_ui->actionReplayCandump, &QAction::toggled, this, &MainWindow::toggleCandumpReplay);
+    connect(m_ui->actionLoopback, &QAction::toggled, this, &MainWindow::toggleLoopback);
+    connect(m_ui->actionLoadGenerator, &QAction::toggled, this, &MainWindow::toggleLoadGenerator);
+    // Offline, the send box shows all three tabs; the loopback follows the selected one.
+    connect(m_ui->sendFrameBox, &QTabWidget::currentChanged, [this](int index) {
+        if (m_loopback->isActive() && index >= 0)
+            startLoopbackSession(index);
+    });
+    m_ui->actionSocketCan->setEnabled(SocketCanBridge::isSupported());
 }
 
-void MainWindow::processErrors(QSerialPort::SerialPortError error)
+SettingsDialog *MainWindow::settingsDialog()
 {
-    if (error == QSerialPort::ResourceError) {
-        QMessageBox::critical(this, tr("Critical Error"), m_serial->errorString());
-        closeSerialPort();
+    if (m_settings == nullptr) {
+        m_settings = new SettingsDialog;
+        connect(m_settings, &QDialog::accepted, this, &MainWindow::openSerialPort);
     }
+
+    return m_settings;
 }
 
-void MainWindow::openSerialPort()
+void MainWindow::setStartupClock(const QElapsedTimer &clock)
 {
-    const SettingsDialog::Settings p = m_settings->settings();
-    m_serial->setPortName(p.name);
+    m_startupClock = clock;
+}
 
-    qint32 iProBridge = 0;
+// Records from now on and writes fileName when recording stops, at the
+// latest on exit.
+void MainWindow::startTrace(const QString &fileName)
+{
+    m_traceFile = fileName;
+    m_ui->actionTrace->setChecked(true);
+}
 
-    if (p.usbVendorID == 0x0416) {
-        if ((p.usbProductID == 0x5204) || (p.usbProductID == 0x5205) || (p.usbProductID == 0x2008)) {
-            iProBridge = 2;
+void MainWindow::toggleTrace(bool enable)
+{
+    if (enable) {
+        TraceRecorder::start();
+        m_written->setText(tr("Recording trace"));
+        return;
+    }
+
+    if (!TraceRecorder::isEnabled())
+        return;
+    TraceRecorder::stop();
+
+    QString fileName = m_traceFile;
+    m_traceFile.clear();
+    if (fileName.isEmpty()) {
+        fileName = QFileDialog::getSaveFileName(this, tr("Save Trace"), "trace.json",
+                                                tr("Chrome trace files (*.json);;All files (*)"));
+        if (fileName.isEmpty()) {
+            m_written->setText(tr("Trace discarded"));
+            return;
         }
+    }
+
+    QString errorString;
+    if (!TraceRecorder::writeJson(fileName, &errorString)) {
+        QMessageBox::critical(this, tr("Save Trace"), errorString);
+        return;
+    }
+    m_written->setText(tr("Wrote %1 zones to %2").arg(TraceRecorder::zoneCount())
+                       .arg(QFileInfo(fileName).fileName()));
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_console->viewport() && event->type() == QEvent::Paint) {
+        m_console->viewport()->removeEventFilter(this);
+
+        if (m_startupClock.isValid())
+            qInfo("Startup: first paint after %lld ms", m_startupClock.elapsed());
+
+        // Start the port scan on the thread pool and build the settings
+        // dialog once the window is up, so the first Connect is instant.
+        QTimer::singleShot(0, this, [this]() {
+            DeviceRegistry::instance();
+            settingsDialog();
+        });
+    }
+
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::processErrors(QSerialPort::SerialPortError error)
+{
+    if (error != QSerialPort::ResourceError)
+        return;
 
-        if ((p.usbProductID == 0x200A)) {
-            iProBridge = 3;
+    if (!m_deviceConnected) {
+        if (m_reconnector->state() == PortReconnector::Idle) {
+            QMessageBox::critical(this, tr("Critical Error"), m_serial->errorString());
+            closeSerialPort();
         }
+        return;
     }
 
-    // NuLink2/3-Pro uses the most significant bits in baudRate to switch the interface.
-    if (iProBridge > 0) {
-        qint32 baudRate = (p.baudRate & 0x0FFFFFFF) | ((p.brgMode + 1) << 28);
-        m_serial->setBaudRate(baudRate);
-    } else {
-        m_serial->setBaudRate(p.baudRate);
+    // The adapter went away while a capture was running, most likely a USB
+    // glitch. Keep the capture open and look for the same adapter again.
+    const QString reason = m_serial->errorString();
+    m_serial->close();
+    m_deviceConnected = false;
+
+    if (m_logger != 0) {
+        m_logger->write("Connection lost: " + reason);
+    }
+    if (m_capture != nullptr) {
+        m_capture->writeRecord(CaptureMarker, QString("Connection lost: " + reason).toUtf8());
+    }
+
+    m_status->setText(tr("Connection to %1 lost, reconnecting...").arg(m_activeSettings.name));
+    m_reconnector->start(m_activeSettings.name, m_activeSerialNumber, m_activeLocation);
+}
+
+void MainWindow::reconnectSerialPort(const QString &portName)
+{
+    SettingsDialog::Settings p = m_activeSettings;
+    p.name = portName;
+
+    if (!startSession(p)) {
+        m_status->setText(tr("Connection to %1 lost, reconnecting (attempt %2)...")
+                          .arg(m_activeSettings.name).arg(m_reconnector->attempts()));
+        m_reconnector->retry();
+        return;
     }
 
-    m_serial->setDataBits(p.dataBits);
-    m_serial->setParity(p.parity);
-    m_serial->setStopBits(p.stopBits);
-    m_serial->setFlowControl(QSerialPort::NoFlowControl);
-    if (m_serial->open(QIODevice::ReadWrite)) {
-        m_serial->setDataTerminalReady(true);
+    const qint64 downtime = m_reconnector->finish();
+    m_activeSettings = p;
+    m_deviceConnected = true;
+
+    const QString text = tr("Reconnected to %1 after %2 s").arg(p.name).arg(downtime / 1000.0, 0, 'f', 1);
+    m_status->setText(text);
+
+    if (m_logger != 0) {
+        m_logger->write(text);
+    }
+    if (m_capture != nullptr) {
+        m_capture->writeGap(downtime * 1000);
+    }
+}
+
+bool MainWindow::startSession(const SettingsDialog::Settings &p)
+{
+    m_integrity.reset();
+    m_writes->clear();
+    if (!openBridgePort(m_serial, p))
+        return false;
+
+    // openBridgePort queued the CANC block.
+    if (p.brgMode == BRG_MODE_CAN)
+        m_writes->add(WriteOther, BridgeCodec::CanConfigSize);
+    return true;
+}
+
+void MainWindow::openSerialPort()
+{
+    QElapsedTimer connectClock;
+    connectClock.start();
+
+    const SettingsDialog::Settings p = settingsDialog()->settings();
+    const qint32 iProBridge = bridgeGeneration(p.usbVendorID, p.usbProductID);
+
+    m_reconnector->stop();
+    m_ui->actionLoopback->setChecked(false);
+
+    if (startSession(p)) {
+        m_activeSettings = p;
+        m_activeSerialNumber.clear();
+        m_activeLocation.clear();
+        const QVector<BridgeDevice> devices = DeviceRegistry::instance()->devices();
+        for (const BridgeDevice &dev : devices) {
+            if (dev.portName == p.name) {
+                m_activeSerialNumber = dev.serialNumber;
+                m_activeLocation = dev.systemLocation;
+            }
+        }
+
         m_deviceConnected = true;
         m_numberFramesWritten = 0;
         m_ui->actionConnect->setEnabled(false);
         m_ui->actionDisconnect->setEnabled(true);
+        m_ui->actionLoopback->setEnabled(false);
         if (p.normalModeEnabled) {
             m_ui->sendFrameBox->show();
         } else {
@@ -175,52 +465,11 @@ void MainWindow::openSerialPort()
         m_ui->sendFrameBox->insertTab(0, m_arrWidgets[p.brgMode], tr(""));
 
         m_mode = p.brgMode;
-        if (m_mode == BRG_MODE_CAN) { // for CAN interface only
-            // QByteArray ba = "CANC";
-            QByteArray ba;
-            int i = 0;
-            ba.resize(32);
-            ba[i++] = 'C';
-            ba[i++] = 'A';
-            ba[i++] = 'N';
-            ba[i++] = 'C';
-
-            ba[i++] = 1;
-            ba[i++] = 0;
-            ba[i++] = 0;
-            ba[i++] = 0;
-
-            ba[i++] = (p.baudRate & 0xFF);
-            ba[i++] = (p.baudRate >> 8) & 0xFF;
-            ba[i++] = (p.baudRate >> 16) & 0xFF;
-            ba[i++] = (p.baudRate >> 24) & 0xFF;
-
-            ba[i++] = (p.normalModeEnabled ? 0 : 1);
-            ba[i++] = 0;
-            ba[i++] = 0;
-            ba[i++] = 0;
-
-            ba[i++] = (p.canID[0] & 0xFF);
-            ba[i++] = (p.canID[0] >> 8) & 0xFF;
-            ba[i++] = (p.canID[0] >> 16) & 0xFF;
-            ba[i++] = (p.canID[0] >> 24) & 0xFF;
-
-            ba[i++] = (p.canID[1] & 0xFF);
-            ba[i++] = (p.canID[1] >> 8) & 0xFF;
-            ba[i++] = (p.canID[1] >> 16) & 0xFF;
-            ba[i++] = (p.canID[1] >> 24) & 0xFF;
-
-            ba[i++] = (p.canID[2] & 0xFF);
-            ba[i++] = (p.canID[2] >> 8) & 0xFF;
-            ba[i++] = (p.canID[2] >> 16) & 0xFF;
-            ba[i++] = (p.canID[2] >> 24) & 0xFF;
-
-            ba[i++] = (p.canID[3] & 0xFF);
-            ba[i++] = (p.canID[3] >> 8) & 0xFF;
-            ba[i++] = (p.canID[3] >> 16) & 0xFF;
-            ba[i++] = (p.canID[3] >> 24) & 0xFF;
-            m_serial->write(ba);
-            // m_serial->flush();
+        m_display.reset();
+        m_changes.reset();
+        if (m_mode == BRG_MODE_CAN) {
+            m_busLoad->reset();
+            m_busLoad->setBitRate(p.baudRate);
         }
 
         if (m_logger == 0) {
@@ -228,6 +477,17 @@ void MainWindow::openSerialPort()
         }
 
         m_logger->write("Open " + p.name);
+
+        if (m_capture == nullptr) {
+            m_capture = new CaptureWriter;
+            m_capture->open("LogData.nucap");
+        }
+        m_capture->writeSession(p.brgMode, p.baudRate, p.name);
+        m_stream->setSession(CaptureWriter::sessionPayload(p.brgMode, p.baudRate, p.name));
+
+        const qint64 ms = connectClock.elapsed();
+        qInfo("Startup: connected to %s in %lld ms", qPrintable(p.name), ms);
+        m_logger->write(QString("Connected in %1 ms").arg(ms));
     } else {
         m_deviceConnected = false;
         QMessageBox::critical(this, tr("Error"), m_serial->errorString());
@@ -242,22 +502,38 @@ void MainWindow::openSerialPort()
             delete m_logger;
             m_logger = nullptr;
         }
+
+        delete m_capture;
+        m_capture = nullptr;
     }
 }
 
 void MainWindow::closeSerialPort()
 {
+    m_ui->actionLoadGenerator->setChecked(false);
+    m_reconnector->stop();
+    m_bulk->cancel();
+    m_transactions->cancelAll();
+    exportLatencyStats();
+    logRxPoolStats();
+    logIntegrityStats();
+
     if (m_serial->isOpen())
         m_serial->close();
+    m_writes->clear();
 
     if (m_logger != 0) {
         delete m_logger;
         m_logger = nullptr;
     }
 
+    delete m_capture;
+    m_capture = nullptr;
+
     m_deviceConnected = false;
     m_ui->actionConnect->setEnabled(true);
     m_ui->actionDisconnect->setEnabled(false);
+    m_ui->actionLoopback->setEnabled(true);
 
     m_ui->sendFrameBox->show();
 
@@ -270,38 +546,985 @@ void MainWindow::closeSerialPort()
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
-    m_settings->close();
+    m_ui->actionTrace->setChecked(false);
+    if (m_settings != nullptr)
+        m_settings->close();
     event->accept();
 }
 
+// Writes "aa bb cc\r\n" into out, which must hold size * 3 + 1 bytes.
+static int formatHex(const char *data, int size, char *out)
+{
+    static const char digits[] = "0123456789abcdef";
+    char *p = out;
+    for (int i = 0; i < size; i++) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        if (i > 0)
+            *p++ = ' ';
+        *p++ = digits[c >> 4];
+        *p++ = digits[c & 0xF];
+    }
+    *p++ = '\r';
+    *p++ = '\n';
+    return static_cast<int>(p - out);
+}
+
 void MainWindow::processReceivedFrames()
 {
-    const QByteArray data = m_serial->readAll();
-    m_console->putData(data.toHex(' '));
-    m_console->putData("\r\n");
+    // Read straight into pooled blocks; a burst larger than one block is
+    // handled block by block.
+    while (m_serial->bytesAvailable() > 0) {
+        RxBuffer buffer = m_rxPool.acquire();
+        qint64 n;
+        {
+            TRACE_ZONE("serial.read");
+            n = m_serial->read(buffer.data(), buffer.capacity());
+        }
+        if (n <= 0)
+            break;
+        buffer.setSize(static_cast<int>(n));
+        processReceivedData(buffer);
+    }
+
+    if (m_integrity.hasEvents())
+        reportIntegrityEvents();
+}
+
+void MainWindow::processReceivedData(const RxBuffer &buffer)
+{
+    TRACE_ZONE("rx.process");
+    const char *data = buffer.constData();
+    const int size = buffer.size();
+    const qint64 timeUs = m_captureClock.nsecsElapsed() / 1000;
+    m_integrity.checkRead(size, timeUs);
+
+    if (m_capture != nullptr) {
+        m_capture->writeRecord(CaptureRx, data, size);
+    }
+    if (m_mode != BRG_MODE_CAN) {
+        m_stream->publish(CaptureRx, data, size);
+    }
+
+    // Bulk responses go to the transfer engine only; dumping a megabyte of
+    // hex into the console would stall the transfer.
+    if (m_bulk->isActive()) {
+        m_bulk->processResponse(data, size);
+        return;
+    }
+
+    // Replies to queued I2C and SPI requests are reported per transaction.
+    if (m_mode != BRG_MODE_CAN && m_transactions->hasPending()) {
+        m_transactions->processResponse(data, size);
+        return;
+    }
+
+    // m_hexText keeps its capacity across calls, so this does not reallocate.
+    int hexSize;
+    {
+        TRACE_ZONE("rx.hex");
+        m_hexText.resize(size * 3 + 1);
+        hexSize = formatHex(data, size, m_hexText.data());
+        m_hexText.resize(hexSize);
+    }
+    // In change-only mode the console shows decoded frames instead.
+    if (!m_changesOnly || m_mode != BRG_MODE_CAN)
+        showOnConsole(m_hexText);
 
     if (m_logger != 0) {
-        m_logger->write(data.toHex(' '));
+        m_logger->write(m_hexText.constData(), hexSize - 2);
+    }
+
+    if (m_mode == BRG_MODE_CAN) {
+        m_integrity.feedCan(data, size, timeUs, [this, timeUs](const STR_CANMSG_T &frame) {
+            char raw[BridgeCodec::CanMessageSize];
+            m_stream->publish(CaptureCanFrame, raw, BridgeCodec::encodeCanMessage(frame, raw, sizeof(raw)));
+            m_socketCan->writeFrame(frame);
+            m_latency->canReceived(frame.Id, frame.IdType == CAN_EXT_ID);
+            m_busLoad->addFrame(frame, timeUs);
+            processCanFrame(frame);
+        });
     }
 }
 
-void MainWindow::sendFrame(const QByteArray &frame) const
+void MainWindow::processTransaction(const BridgeTransaction &transaction)
+{
+    const char *status = "";
+    switch (transaction.status) {
+    case BridgeTransaction::Timeout:
+        status = " timeout";
+        break;
+    case BridgeTransaction::Cancelled:
+        status = " cancelled";
+        break;
+    default:
+        break;
+    }
+
+    const LatencyRecorder::Kind kind = static_cast<LatencyRecorder::Kind>(transaction.type);
+    const int address = transaction.type == BridgeTransaction::SpiTransfer ? -1 : transaction.address;
+    if (transaction.status == BridgeTransaction::Ok)
+        m_latency->recordTransaction(kind, address, transaction.latencyNs);
+    else if (transaction.status == BridgeTransaction::Timeout)
+        m_latency->recordTimeout(kind, address);
+
+    QByteArray text;
+    const bool ok = transaction.status == BridgeTransaction::Ok;
+    if (transaction.type == BridgeTransaction::SpiTransfer) {
+        text = QString("SPI [%1]%2 MOSI: ").arg(transaction.size).arg(status).toLatin1();
+        text += transaction.data.toHex(' ');
+        if (ok)
+            text += " MISO: " + transaction.response.toHex(' ');
+    } else {
+        text = QString("I2C %1 0x%2 [%3]%4")
+                .arg(transaction.type == BridgeTransaction::I2cRead ? "R" : "W")
+                .arg(uint(transaction.address), 2, 16, QChar('0'))
+                .arg(transaction.size)
+                .arg(status).toLatin1();
+        if (transaction.type == BridgeTransaction::I2cRead && ok)
+            text += ": " + transaction.response.toHex(' ');
+    }
+
+    text += QString(" (%1 ms)").arg(transaction.latencyNs / 1e6, 0, 'f', 3).toLatin1();
+
+    text += "\r\n";
+    // Shed like received data when the console can't keep up.
+    showOnConsole(text);
+
+    if (m_logger != 0) {
+        m_logger->write(text.constData(), text.size() - 2);
+    }
+}
+
+void MainWindow::exportLatencyStats()
+{
+    // Nothing more will answer once the port closes.
+    m_latency->expire(true);
+    if (m_latency->isEmpty())
+        return;
+
+    for (const LatencyRecorder::Summary &stats : m_latency->summaries()) {
+        const QString text = QString("Latency %1: %2 ok, %3 timeouts, p50 %4 / p99 %5 / max %6 ms")
+                .arg(stats.name)
+                .arg(stats.count)
+                .arg(stats.timeouts)
+                .arg(stats.p50 / 1e6, 0, 'f', 3)
+                .arg(stats.p99 / 1e6, 0, 'f', 3)
+                .arg(stats.maximum / 1e6, 0, 'f', 3);
+        qInfo("%s", qPrintable(text));
+        if (m_logger != 0) {
+            m_logger->write(text);
+        }
+    }
+
+    QString errorString;
+    if (!m_latency->exportCsv("LatencyData.csv", &errorString))
+        qWarning("Latency export failed: %s", qPrintable(errorString));
+
+    m_latency->reset();
+}
+
+void MainWindow::logRxPoolStats()
+{
+    const RxBufferPool::Stats stats = m_rxPool.stats();
+    const QString text = QString("RX pool: %1 reads, %2 of %3 blocks peak, %4 heap fallbacks")
+            .arg(stats.acquired)
+            .arg(stats.highWater)
+            .arg(stats.blocks)
+            .arg(stats.overflows);
+    qInfo("%s", qPrintable(text));
+    if (m_logger != 0) {
+        m_logger->write(text);
+    }
+
+    m_rxPool.resetStats();
+}
+
+void MainWindow::reportIntegrityEvents()
+{
+    for (const StreamIntegrity::Event &event : m_integrity.takeEvents()) {
+        const QString text = StreamIntegrity::describe(event);
+        if (m_capture != nullptr) {
+            m_capture->writeRecord(CaptureMarker, text.toUtf8());
+        }
+        if (m_logger != 0) {
+            m_logger->write(text);
+        }
+        m_ui->statusBar->showMessage(text, 5000);
+    }
+}
+
+void MainWindow::logIntegrityStats()
+{
+    const StreamIntegrity::Stats stats = m_integrity.stats();
+    const QString text = QString("Integrity: %1 bytes, %2 CAN frames, %3 resyncs "
+                                 "(%4 IdType, %5 FrameType, %6 DLC, %7 ID), %8 bytes skipped, "
+                                 "%9 host stalls, longest %10 ms")
+            .arg(stats.bytes)
+            .arg(stats.frames)
+            .arg(stats.events[StreamIntegrity::BadIdType] + stats.events[StreamIntegrity::BadFrameType]
+                 + stats.events[StreamIntegrity::BadDlc] + stats.events[StreamIntegrity::BadId])
+            .arg(stats.events[StreamIntegrity::BadIdType])
+            .arg(stats.events[StreamIntegrity::BadFrameType])
+            .arg(stats.events[StreamIntegrity::BadDlc])
+            .arg(stats.events[StreamIntegrity::BadId])
+            .arg(stats.skippedBytes)
+            .arg(stats.events[StreamIntegrity::HostStall])
+            .arg(stats.longestStallUs / 1000);
+    qInfo("%s", qPrintable(text));
+    if (m_logger != 0) {
+        m_logger->write(text);
+    }
+
+    m_integrity.resetStats();
+}
+
+void MainWindow::processCanFrame(const STR_CANMSG_T &frame)
+{
+    TRACE_ZONE("can.frame");
+    m_display.countFrame(frame);
+
+    bool show = true;
+    if (m_changesOnly) {
+        quint8 changedBytes = 0;
+        const ChangeFilter::Result result = m_changes.update(frame, &changedBytes);
+        show = result != ChangeFilter::Unchanged;
+        if (show)
+            showCanChange(frame, result, changedBytes);
+    }
+
+    if (m_dbc.isEmpty())
+        return;
+
+    int message;
+    const int count = m_dbc.decode(frame, m_dbcValues.data(), &message);
+    if (count == 0)
+        return;
+
+    if (m_plotWindow != nullptr) {
+        const qint64 timeUs = m_captureClock.nsecsElapsed() / 1000;
+        for (int i = 0; i < count; i++)
+            m_plotWindow->plot()->addSample(m_dbcValues.at(i).signal, timeUs, m_dbcValues.at(i).value);
+    }
+
+    const DbcMessage &msg = m_dbc.messages().at(message);
+    QString text = msg.name + QLatin1Char(':');
+    for (int i = 0; i < count; i++) {
+        const DbcSignal &sig = m_dbc.signalAt(m_dbcValues.at(i).signal);
+        text += QLatin1Char(' ') + sig.name + QLatin1Char('=')
+                + QString::number(m_dbcValues.at(i).value, 'g', 8);
+        if (!sig.unit.isEmpty())
+            text += QLatin1Char(' ') + sig.unit;
+    }
+
+    if (show)
+        showOnConsole(text.toUtf8() + "\r\n");
+
+    if (m_logger != 0) {
+        m_logger->write(text);
+    }
+}
+
+// Capture and logging never go through here, so they keep the full rate
+// whatever the display level.
+void MainWindow::showOnConsole(const QByteArray &text)
+{
+    const qint64 startNs = m_captureClock.nsecsElapsed();
+    if (!m_display.offer(startNs))
+        return;
+
+    m_console->putData(text);
+    m_display.drawn(m_captureClock.nsecsElapsed() - startNs);
+}
+
+// "123       [8] 11 22 33 44 55 66 77 88" with the changed bytes highlighted;
+// a new ID is shown without highlights.
+void MainWindow::showCanChange(const STR_CANMSG_T &frame, ChangeFilter::Result result, quint8 changedBytes)
+{
+    const qint64 startNs = m_captureClock.nsecsElapsed();
+    if (!m_display.offer(startNs))
+        return;
+
+    static const char digits[] = "0123456789abcdef";
+    enum {
+        IdWidth = 10,
+        DataColumn = IdWidth + 4
+    };
+
+    char line[DataColumn + 8 * 3 + 8];
+    memset(line, ' ', DataColumn);
+    const int idDigits = frame.IdType == CAN_EXT_ID ? 8 : 3;
+    for (int i = 0; i < idDigits; i++)
+        line[i] = digits[(frame.Id >> (4 * (idDigits - 1 - i))) & 0xF];
+    const int dlc = frame.DLC > 8 ? 8 : frame.DLC;
+    line[IdWidth] = '[';
+    line[IdWidth + 1] = static_cast<char>('0' + dlc);
+    line[IdWidth + 2] = ']';
+
+    int size = DataColumn;
+    if (frame.FrameType == CAN_REMOTE_FRAME) {
+        memcpy(line + size, "remote", 6);
+        size += 6;
+    } else {
+        for (int i = 0; i < dlc; i++) {
+            const unsigned char b = static_cast<unsigned char>(frame.Data[i]);
+            line[size++] = digits[b >> 4];
+            line[size++] = digits[b & 0xF];
+            line[size++] = ' ';
+        }
+    }
+    line[size++] = '\r';
+    line[size++] = '\n';
+
+    const QByteArray text = QByteArray::fromRawData(line, size);
+    if (result == ChangeFilter::Changed && frame.FrameType != CAN_REMOTE_FRAME)
+        m_console->putHighlighted(text, DataColumn, 3, 2, changedBytes);
+    else
+        m_console->putData(text);
+    m_display.drawn(m_captureClock.nsecsElapsed() - startNs);
+}
+
+void MainWindow::updateDisplayLevel()
+{
+    const qint64 nowNs = m_captureClock.nsecsElapsed();
+    if (m_display.update(nowNs)) {
+        const QString text = tr("Display level: %1").arg(DisplayPolicy::levelName(m_display.level()));
+        if (m_logger != 0) {
+            m_logger->write(text);
+        }
+        m_displayOutputNs = nowNs;
+    }
+
+    // The reduced levels draw on their own schedule instead of per item.
+    const DisplayPolicy::Level level = m_display.level();
+    if ((level == DisplayPolicy::Summary || level == DisplayPolicy::Counters) && nowNs >= m_displayOutputNs) {
+        const int intervalMs = level == DisplayPolicy::Summary ? DisplayPolicy::SummaryIntervalMs
+                                                               : DisplayPolicy::CountersIntervalMs;
+        m_displayOutputNs = nowNs + intervalMs * Q_INT64_C(1000000);
+
+        const QString text = level == DisplayPolicy::Summary ? m_display.takeSummary()
+                                                             : m_display.takeCounters(nowNs);
+        const qint64 startNs = m_captureClock.nsecsElapsed();
+        m_console->putData(text.toUtf8());
+        m_display.drawn(m_captureClock.nsecsElapsed() - startNs, text.count(QLatin1Char('\n')));
+    }
+
+    if (level == DisplayPolicy::Full) {
+        m_displayLevel->setText(tr("Display: full"));
+        m_displayLevel->setStyleSheet(QString());
+    } else {
+        m_displayLevel->setText(tr("Display: %1, %2 skipped")
+                                .arg(DisplayPolicy::levelName(level)).arg(m_display.skipped()));
+        m_displayLevel->setStyleSheet(QStringLiteral("color: #b00000"));
+    }
+}
+
+void MainWindow::loadDbc()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Load DBC"), QString(),
+                                                          tr("CAN database (*.dbc);;All files (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    // A failed load leaves the database empty; keep the buffer and the plot
+    // in step with it either way.
+    QString errorString;
+    const bool ok = m_dbc.load(fileName, &errorString);
+    m_dbcValues.resize(m_dbc.maxSignalsPerMessage());
+    if (!ok) {
+        QMessageBox::critical(this, tr("Error"), errorString);
+        if (m_plotWindow != nullptr)
+            updatePlotSignals();
+        return;
+    }
+
+    m_status->setText(tr("Loaded %1 messages, %2 signals").arg(m_dbc.messages().size()).arg(m_dbc.signalCount()));
+
+    if (m_plotWindow != nullptr)
+        updatePlotSignals();
+}
+
+void MainWindow::updatePlotSignals()
+{
+    QStringList names;
+    for (int i = 0; i < m_dbc.signalCount(); i++) {
+        const DbcSignal &sig = m_dbc.signalAt(i);
+        names << m_dbc.messages().at(sig.message).name + QLatin1Char('.') + sig.name;
+    }
+
+    m_plotWindow->setSignalNames(names);
+}
+
+void MainWindow::showSignalPlot()
+{
+    if (m_plotWindow == nullptr) {
+        m_plotWindow = new SignalPlotWindow(this);
+        updatePlotSignals();
+    }
+
+    m_plotWindow->show();
+    m_plotWindow->raise();
+}
+
+void MainWindow::showLatencyStats()
+{
+    if (m_latencyWindow == nullptr)
+        m_latencyWindow = new LatencyWindow(m_latency, this);
+
+    m_latencyWindow->show();
+    m_latencyWindow->raise();
+}
+
+void MainWindow::showBusLoad()
+{
+    if (m_busLoadWindow == nullptr)
+        m_busLoadWindow = new BusLoadWindow(m_busLoad, &m_captureClock, this);
+
+    m_busLoadWindow->show();
+    m_busLoadWindow->raise();
+}
+
+void MainWindow::editCanLatencyPairs()
 {
-    if (m_deviceConnected) { // On-Line mode
-        if (m_mode == BRG_MODE_CAN) { // for can only
-            QByteArray data("CAND");
-            data.append(frame);
-            m_serial->write(data);
-        } else { // for i2c & spi
-            // for debug purpose only, printf output data
-            // m_console->putData("\r\nOffLine: ");
-            // m_console->putData(frame.toHex());
-            m_serial->setRequestToSend(true);
-            m_serial->write(frame);
-            m_serial->flush();
-            m_serial->setRequestToSend(false);
+    // An extended ID is written with a trailing 'x' unless it needs 29 bits anyway.
+    auto idText = [](quint32 id) {
+        const quint32 value = id & ~LatencyRecorder::ExtendedId;
+        const bool suffix = (id & LatencyRecorder::ExtendedId) && value <= 0x7FF;
+        return QString::number(value, 16) + (suffix ? "x" : "");
+    };
+    auto parseId = [](QString text, quint32 *id) {
+        const bool extended = text.endsWith('x', Qt::CaseInsensitive);
+        if (extended)
+            text.chop(1);
+        bool ok = false;
+        *id = text.toUInt(&ok, 16);
+        if (!ok || *id > 0x1FFFFFFF)
+            return false;
+        if (extended || *id > 0x7FF)
+            *id |= LatencyRecorder::ExtendedId;
+        return true;
+    };
+
+    QStringList current;
+    for (const auto &pair : m_latency->canPairs())
+        current << idText(pair.first) + ':' + idText(pair.second);
+
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, tr("CAN Latency Pairs"),
+                                               tr("Request:response ID pairs in hex, e.g. 7E0:7E8, 18DA10F1:18DAF110\n"
+                                                  "A trailing x marks a short extended ID, e.g. 100x:101x"),
+                                               QLineEdit::Normal, current.join(", "), &ok);
+    if (!ok)
+        return;
+
+    QVector<QPair<quint32, quint32> > pairs;
+    for (const QString &item : text.split(QRegularExpression("[,;\\s]+"), QString::SkipEmptyParts)) {
+        const QStringList ids = item.split(':');
+        quint32 request = 0;
+        quint32 response = 0;
+        if (ids.size() != 2 || !parseId(ids.at(0), &request) || !parseId(ids.at(1), &response)) {
+            QMessageBox::warning(this, tr("CAN Latency Pairs"), tr("Invalid pair \"%1\"").arg(item));
+            return;
         }
-    } else { // Off-Line Mode
+        pairs.append(qMakePair(request, response));
+    }
+
+    m_latency->setCanPairs(pairs);
+}
+
+void MainWindow::toggleStreamServer(bool enable)
+{
+    if (!enable) {
+        m_stream->close();
+        m_ui->statusBar->showMessage(tr("Stream server stopped"), 3000);
+        return;
+    }
+
+    QString errorString;
+    if (!m_stream->listen(StreamPort, StreamSocketName, &errorString)) {
+        QMessageBox::critical(this, tr("Stream Server"), errorString);
+        m_ui->actionStreamServer->setChecked(false);
+        return;
+    }
+
+    m_ui->statusBar->showMessage(tr("Streaming on 127.0.0.1:%1 and local socket \"%2\"")
+                                 .arg(int(StreamPort)).arg(StreamSocketName), 5000);
+}
+
+void MainWindow::sendClientFrame(const QByteArray &frame)
+{
+    if (m_mode == BRG_MODE_CAN) {
+        sendFrame(frame);
+        return;
+    }
+
+    // I2C and SPI requests go through the queue, so their replies are
+    // matched like the send box's.
+    if (m_mode == BRG_MODE_SPI) {
+        if (!frame.isEmpty())
+            m_transactions->spiTransfer(frame);
+        return;
+    }
+
+    quint8 address = 0;
+    int length = 0;
+    if (frame.size() == BridgeCodec::I2cReadSize
+            && BridgeCodec::decodeI2cRead(frame.constData(), frame.size(), &address, &length)) {
+        m_transactions->i2cRead(address, length);
+    } else if (frame.size() > BridgeCodec::I2cWriteHeaderSize && (frame.at(0) & 0x80) == 0 && frame.at(1) == 0) {
+        m_transactions->i2cWrite(static_cast<quint8>(frame.at(0)), frame.mid(BridgeCodec::I2cWriteHeaderSize));
+    } else {
+        m_ui->statusBar->showMessage(tr("Stream client sent an invalid I2C request (%1 bytes)").arg(frame.size()), 5000);
+    }
+}
+
+void MainWindow::toggleSocketCan(bool enable)
+{
+    if (!enable) {
+        if (m_socketCan->isOpen()) {
+            m_ui->statusBar->showMessage(tr("SocketCAN %1 closed: %2 frames out, %3 in, %4 dropped")
+                                         .arg(m_socketCan->interfaceName())
+                                         .arg(m_socketCan->framesToSocket())
+                                         .arg(m_socketCan->framesFromSocket())
+                                         .arg(m_socketCan->framesDropped()), 5000);
+        }
+        m_socketCan->close();
+        return;
+    }
+
+    bool ok = false;
+    const QString name = QInputDialog::getText(this, tr("SocketCAN Bridge"), tr("CAN interface:"),
+                                               QLineEdit::Normal, "vcan0", &ok).trimmed();
+    QString errorString;
+    if (!ok || name.isEmpty() || !m_socketCan->open(name, &errorString)) {
+        if (!errorString.isEmpty())
+            QMessageBox::critical(this, tr("SocketCAN Bridge"), errorString);
+        m_ui->actionSocketCan->setChecked(false);
+        return;
+    }
+
+    m_ui->statusBar->showMessage(tr("Bridging CAN traffic to %1").arg(name), 5000);
+}
+
+void MainWindow::toggleGateway(bool enable)
+{
+    if (!enable) {
+        if (m_gateway->isActive()) {
+            const QString text = m_gateway->statistics();
+            m_gateway->stop();
+            m_written->setText(text);
+            if (m_logger != 0) {
+                m_logger->write("Gateway stopped: " + text);
+            }
+        }
+        return;
+    }
+
+    // Any two present bridges except the one this window is using.
+    QStringList ports;
+    QVector<BridgeDevice> candidates;
+    for (const BridgeDevice &dev : DeviceRegistry::instance()->devices()) {
+        if (!dev.present || (m_serial->isOpen() && dev.portName == m_serial->portName()))
+            continue;
+        ports << QString("%1 (%2)").arg(dev.portName).arg(dev.serialNumber);
+        candidates.append(dev);
+    }
+
+    auto cancel = [this]() {
+        m_ui->actionGateway->setChecked(false);
+    };
+
+    if (candidates.size() < 2) {
+        QMessageBox::information(this, tr("CAN Gateway"), tr("Connect two free bridges first."));
+        cancel();
+        return;
+    }
+
+    bool ok = false;
+    const QString a = QInputDialog::getItem(this, tr("CAN Gateway"), tr("Port A:"), ports, 0, false, &ok);
+    if (!ok) {
+        cancel();
+        return;
+    }
+    const int indexA = ports.indexOf(a);
+    ports.removeAt(indexA);
+    const BridgeDevice devA = candidates.takeAt(indexA);
+
+    const QString b = QInputDialog::getItem(this, tr("CAN Gateway"), tr("Port B:"), ports, 0, false, &ok);
+    if (!ok) {
+        cancel();
+        return;
+    }
+    const BridgeDevice devB = candidates.at(ports.indexOf(b));
+
+    // No rule file means every frame is forwarded unchanged.
+    QString errorString;
+    const QString rules = QFileDialog::getOpenFileName(this, tr("Gateway Rules"), QString(),
+                                                       tr("Rule files (*.txt *.rules);;All files (*)"));
+    if (rules.isEmpty()) {
+        m_gateway->rules()->clear();
+    } else if (!m_gateway->rules()->load(rules, &errorString)) {
+        QMessageBox::critical(this, tr("CAN Gateway"), errorString);
+        cancel();
+        return;
+    }
+
+    SettingsDialog::Settings pa = settingsDialog()->settings();
+    pa.brgMode = BRG_MODE_CAN;
+    SettingsDialog::Settings pb = pa;
+    pa.name = devA.portName;
+    pa.usbVendorID = devA.vendorId;
+    pa.usbProductID = devA.productId;
+    pb.name = devB.portName;
+    pb.usbVendorID = devB.vendorId;
+    pb.usbProductID = devB.productId;
+
+    if (!m_gateway->start(pa, pb, &errorString)) {
+        QMessageBox::critical(this, tr("CAN Gateway"), errorString);
+        cancel();
+        return;
+    }
+
+    m_written->setText(tr("Gateway %1 <-> %2, %3 rules").arg(pa.name).arg(pb.name)
+                       .arg(m_gateway->rules()->ruleCount()));
+}
+
+void MainWindow::openCapture()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Open Capture"), QString(),
+                                                          tr("Captures (*.nucap);;All files (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    // Each capture gets its own window, deleted when closed.
+    CaptureViewer *viewer = new CaptureViewer(this);
+    QString errorString;
+    if (!viewer->open(fileName, &errorString)) {
+        delete viewer;
+        QMessageBox::critical(this, tr("Open Capture"), errorString);
+        return;
+    }
+    viewer->show();
+}
+
+void MainWindow::convertCapture()
+{
+    const QString capture = QFileDialog::getOpenFileName(this, tr("Convert Capture"), QString(),
+                                                         tr("Captures (*.nucap);;All files (*)"));
+    if (capture.isEmpty())
+        return;
+
+    const QStringList formats = { "CSV", "candump", "ASC" };
+    bool ok = false;
+    const QString formatName = QInputDialog::getItem(this, tr("Convert Capture"), tr("Format:"),
+                                                     formats, 0, false, &ok);
+    CaptureConverter::Format format;
+    if (!ok || !CaptureConverter::formatFromName(formatName, &format))
+        return;
+
+    const QFileInfo info(capture);
+    const QString suffix = CaptureConverter::fileSuffix(format);
+    const QString output = QFileDialog::getSaveFileName(
+                this, tr("Convert Capture"), info.path() + '/' + info.completeBaseName() + '.' + suffix,
+                tr("%1 files (*.%2);;All files (*)").arg(formatName).arg(suffix));
+    if (output.isEmpty())
+        return;
+
+    // The conversion blocks a pool thread and fans out to the rest.
+    CaptureConverter *converter = new CaptureConverter(this);
+    QProgressDialog *progress = new QProgressDialog(tr("Converting %1...").arg(info.fileName()),
+                                                    tr("Cancel"), 0, 1000, this);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+    progress->setMinimumDuration(500);
+    connect(progress, &QProgressDialog::canceled, converter, &CaptureConverter::cancel);
+    connect(converter, &CaptureConverter::progress, progress, [progress](qint64 done, qint64 total) {
+        progress->setValue(total > 0 ? static_cast<int>(done * 1000 / total) : 0);
+    });
+
+    QString *errorString = new QString;
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [=]() {
+        const bool canceled = progress->wasCanceled();
+        progress->close();
+        if (watcher->result())
+            m_written->setText(tr("Converted to %1").arg(output));
+        else if (!canceled)
+            QMessageBox::critical(this, tr("Convert Capture"), *errorString);
+        delete errorString;
+        converter->deleteLater();
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([=]() {
+        return converter->convert(capture, output, format, errorString);
+    }));
+}
+
+void MainWindow::toggleCandumpReplay(bool enable)
+{
+    if (!enable) {
+        if (m_replay->isActive()) {
+            m_replay->stop();
+            m_written->setText(tr("Replay stopped: %1 frames, %2 lines skipped")
+                               .arg(m_replay->framesReplayed()).arg(m_replay->linesSkipped()));
+        }
+        return;
+    }
+
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Replay candump Log"), QString(),
+                                                          tr("candump logs (*.log);;All files (*)"));
+    QString errorString;
+    if (fileName.isEmpty() || !m_replay->start(fileName, &errorString)) {
+        if (!errorString.isEmpty())
+            QMessageBox::critical(this, tr("Replay candump Log"), errorString);
+        m_ui->actionReplayCandump->setChecked(false);
+        return;
+    }
+
+    m_written->setText(tr("Replaying %1").arg(QFileInfo(fileName).fileName()));
+}
+
+// Replayed frames take the path of received ones and, like frames from the
+// send box, go out on the bus when a bridge is connected in CAN mode.
+void MainWindow::replayCanFrame(const STR_CANMSG_T &frame)
+{
+    char raw[BridgeCodec::CanMessageSize];
+    const int size = BridgeCodec::encodeCanMessage(frame, raw, sizeof(raw));
+    // Looped back frames come through the receive path anyway.
+    if (m_loopback->isActive()) {
+        sendFrame(QByteArray::fromRawData(raw, size));
+        return;
+    }
+
+    m_stream->publish(CaptureCanFrame, raw, size);
+    m_socketCan->writeFrame(frame);
+    processCanFrame(frame);
+
+    if (!m_deviceConnected || m_mode == BRG_MODE_CAN)
+        sendFrame(QByteArray::fromRawData(raw, size));
+}
+
+void MainWindow::toggleLoopback(bool enable)
+{
+    if (!enable) {
+        if (!m_loopback->isActive())
+            return;
+        m_ui->actionLoadGenerator->setChecked(false);
+        m_loopback->stop();
+        m_writes->clear();
+        m_transactions->cancelAll();
+        logIntegrityStats();
+
+        if (m_logger != 0) {
+            delete m_logger;
+            m_logger = nullptr;
+        }
+        delete m_capture;
+        m_capture = nullptr;
+
+        m_status->setText(tr("Loopback stopped after %1 frames").arg(m_loopback->framesLooped()));
+        return;
+    }
+
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, tr("Offline Loopback"),
+                                               tr("Answer delay and jitter in microseconds (delay[,jitter]):"),
+                                               QLineEdit::Normal, "0,0", &ok);
+    const QStringList parts = text.split(',');
+    bool okDelay = false;
+    bool okJitter = false;
+    const int delayUs = parts.value(0).trimmed().toInt(&okDelay);
+    const int jitterUs = parts.value(1, "0").trimmed().toInt(&okJitter);
+    if (!ok || !okDelay || !okJitter || delayUs < 0 || jitterUs < 0) {
+        const QSignalBlocker blocker(m_ui->actionLoopback);
+        m_ui->actionLoopback->setChecked(false);
+        return;
+    }
+
+    if (m_logger == 0) {
+        m_logger = new Logger(this, "LogData.txt");
+    }
+    if (m_capture == nullptr) {
+        m_capture = new CaptureWriter;
+        m_capture->open("LogData.nucap");
+    }
+
+    const int mode = qMax(0, m_ui->sendFrameBox->currentIndex());
+    m_loopback->start(mode, delayUs, jitterUs);
+    m_writes->clear();
+    startLoopbackSession(mode);
+}
+
+// Each mode change starts a new session in the capture, like a reconnect.
+void MainWindow::startLoopbackSession(int brgMode)
+{
+    m_ui->actionLoadGenerator->setChecked(false);
+    m_mode = brgMode;
+    m_loopback->setMode(brgMode);
+    m_transactions->cancelAll();
+    m_integrity.reset();
+    m_display.reset();
+    m_changes.reset();
+
+    qint32 baudRate = 0;
+    if (brgMode == BRG_MODE_CAN) {
+        baudRate = DefaultCanBitRate;
+        if (m_settings != nullptr && m_settings->settings().brgMode == BRG_MODE_CAN)
+            baudRate = m_settings->settings().baudRate;
+        m_busLoad->reset();
+        m_busLoad->setBitRate(baudRate);
+    }
+
+    m_logger->write(QString("Open loopback, mode %1").arg(brgMode));
+    m_capture->writeSession(brgMode, baudRate, "loopback");
+    m_stream->setSession(CaptureWriter::sessionPayload(brgMode, baudRate, "loopback"));
+    m_status->setText(tr("Offline loopback (%1)").arg(m_ui->sendFrameBox->tabText(brgMode)));
+}
+
+void MainWindow::receiveLoopback(const QByteArray &data)
+{
+    const char *p = data.constData();
+    int left = data.size();
+    while (left > 0) {
+        RxBuffer buffer = m_rxPool.acquire();
+        const int n = qMin(left, buffer.capacity());
+        memcpy(buffer.data(), p, n);
+        buffer.setSize(n);
+        processReceivedData(buffer);
+        p += n;
+        left -= n;
+    }
+
+    if (m_integrity.hasEvents())
+        reportIntegrityEvents();
+}
+
+// Generated frames go through sendFrame like the send box's, to the bridge
+// or the offline loopback.
+void MainWindow::toggleLoadGenerator(bool enable)
+{
+    if (!enable) {
+        if (m_generator->isActive()) {
+            m_generator->stop();
+            reportLoadGenerator();
+        }
+        return;
+    }
+
+    const QSignalBlocker blocker(m_ui->actionLoadGenerator);
+    m_ui->actionLoadGenerator->setChecked(false);
+
+    if (!m_deviceConnected && !m_loopback->isActive()) {
+        QMessageBox::information(this, tr("Load Generator"),
+                                 tr("Connect a bridge or start the offline loopback first."));
+        return;
+    }
+
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, tr("Load Generator"),
+                                               tr("Profile (key=value ...):"),
+                                               QLineEdit::Normal, m_generatorProfile, &ok);
+    if (!ok)
+        return;
+
+    LoadProfile profile;
+    profile.brgMode = m_mode;
+    QString errorString;
+    if (LoadProfile::parse(text, &profile, &errorString) && profile.brgMode != m_mode)
+        errorString = tr("The profile's mode differs from the connected bridge's");
+    if (!errorString.isEmpty() || !m_generator->start(profile, &errorString)) {
+        QMessageBox::critical(this, tr("Load Generator"), errorString);
+        return;
+    }
+
+    m_generatorProfile = text;
+    m_ui->actionLoadGenerator->setChecked(true);
+    m_written->setText(tr("Load generator running"));
+}
+
+void MainWindow::reportLoadGenerator()
+{
+    const QString summary = m_generator->summary();
+    m_written->setText(tr("Load generator: %1").arg(summary));
+    if (m_logger != 0) {
+        m_logger->write("Load generator (" + m_generatorProfile + "): " + summary);
+    }
+}
+
+void MainWindow::startBulkTransfer()
+{
+    if (!m_deviceConnected || (m_mode != BRG_MODE_I2C && m_mode != BRG_MODE_SPI)) {
+        QMessageBox::information(this, tr("Bulk Transfer"), tr("Connect to the bridge in I2C or SPI master mode first."));
+        return;
+    }
+
+    if (m_bulk->isActive()) {
+        if (QMessageBox::question(this, tr("Bulk Transfer"), tr("Cancel the running transfer?")) == QMessageBox::Yes)
+            m_bulk->cancel();
+        return;
+    }
+
+    QString errorString;
+    bool started = false;
+
+    if (m_mode == BRG_MODE_I2C) {
+        const QStringList directions = { tr("Write file to device"), tr("Read device to file") };
+        bool ok = false;
+        const QString direction = QInputDialog::getItem(this, tr("Bulk Transfer"), tr("Direction:"),
+                                                        directions, 0, false, &ok);
+        if (!ok)
+            return;
+
+        const uint addr = QInputDialog::getText(this, tr("Bulk Transfer"), tr("I2C address (hex):"),
+                                                QLineEdit::Normal, QString(), &ok).toUInt(nullptr, 16);
+        if (!ok || addr > 0x7F)
+            return;
+
+        if (direction == directions.at(0)) {
+            const QString source = QFileDialog::getOpenFileName(this, tr("Write File"));
+            if (source.isEmpty())
+                return;
+            started = m_bulk->start(BulkTransfer::I2cWrite, source, QString(), addr, 0, &errorString);
+        } else {
+            const int length = QInputDialog::getInt(this, tr("Bulk Transfer"), tr("Bytes to read:"),
+                                                    0x1000, 1, 0x1000000, 1, &ok);
+            if (!ok)
+                return;
+            const QString target = QFileDialog::getSaveFileName(this, tr("Save Data"));
+            if (target.isEmpty())
+                return;
+            started = m_bulk->start(BulkTransfer::I2cRead, QString(), target, addr, length, &errorString);
+        }
+    } else {
+        const QString source = QFileDialog::getOpenFileName(this, tr("SPI Transmit File"));
+        if (source.isEmpty())
+            return;
+        // MISO data is optional; cancelling the dialog just discards it
+        const QString target = QFileDialog::getSaveFileName(this, tr("Save MISO Data"));
+        started = m_bulk->start(BulkTransfer::SpiTransfer, source, target, 0, 0, &errorString);
+    }
+
+    if (!started)
+        QMessageBox::critical(this, tr("Error"), errorString);
+}
+
+void MainWindow::sendFrame(const QByteArray &frame) const
+{
+    writeFrame(frame, WriteOther);
+}
+
+void MainWindow::portBytesWritten(qint64 bytes)
+{
+    m_writes->written(bytes, [this](int owner, qint64 n) {
+        if (owner == WriteBulk)
+            m_bulk->bytesWritten(n);
+        else if (owner == WriteTransactions)
+            m_transactions->bytesWritten(n);
+    });
+}
+
+void MainWindow::writeFrame(const QByteArray &frame, WriteOwner owner) const
+{
+    TRACE_ZONE("tx.frame");
+    if (!m_deviceConnected && !m_loopback->isActive()) { // Off-Line Mode
         m_console->putData("\nOffline: ");
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 9, 0))
         // https://doc.qt.io/qt-5/qbytearray.html#toHex
@@ -310,6 +1533,42 @@ void MainWindow::sendFrame(const QByteArray &frame) const
 #else
         m_console->putData(frame.toHex());
 #endif
+        return;
+    }
+
+    // On-Line mode, or offline with the loopback standing in for the bridge
+    if (m_mode == BRG_MODE_CAN) { // for can only
+        char data[BridgeCodec::CanDataSize];
+        const int size = BridgeCodec::wrapCanData(frame.constData(), frame.size(), data, sizeof(data));
+        if (size == 0) {
+            m_ui->statusBar->showMessage(tr("CAN frame not sent: %1 bytes, expected %2")
+                                         .arg(frame.size()).arg(int(BridgeCodec::CanMessageSize)), 5000);
+            return;
+        }
+        STR_CANMSG_T msg;
+        BridgeCodec::decodeCanMessage(frame.constData(), frame.size(), &msg);
+        m_latency->canSent(msg.Id, msg.IdType == CAN_EXT_ID);
+        m_busLoad->addFrame(msg, m_captureClock.nsecsElapsed() / 1000);
+        // Recorded first: the port may report the bytes before write() returns.
+        m_writes->add(owner, size);
+        if (m_deviceConnected)
+            m_serial->write(data, size);
+        else
+            m_loopback->write(data, size);
+        if (m_capture != nullptr) {
+            m_capture->writeRecord(CaptureTx, data, size);
+        }
+        m_stream->publish(CaptureTx, data, size);
+    } else { // for i2c & spi
+        m_writes->add(owner, frame.size());
+        if (m_deviceConnected)
+            writeBridgeFrame(m_serial, frame.constData(), frame.size());
+        else
+            m_loopback->write(frame.constData(), frame.size());
+        if (m_capture != nullptr) {
+            m_capture->writeRecord(CaptureTx, frame);
+        }
+        m_stream->publish(CaptureTx, frame.constData(), frame.size());
     }
 }
 
@@ -51,16 +51,40 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QElapsedTimer>
 #include <QMainWindow>
 #include <QSerialPort>
 #include "nuvbridge.h"
+#include "streamintegrity.h"
+#include "dbcdatabase.h"
+#include "settingsdialog.h"
+#include "rxbufferpool.h"
+#include "displaypolicy.h"
+#include "changefilter.h"
 
 QT_BEGIN_NAMESPACE
 
 class QLabel;
-class SettingsDialog;
+class QTimer;
 class Console;
 class Logger;
+class SignalPlotWindow;
+class LatencyRecorder;
+class LatencyWindow;
+class BusLoadMeter;
+class BusLoadWindow;
+class WriteLedger;
+class StreamServer;
+class SocketCanBridge;
+class CanGateway;
+class CandumpReplay;
+class LoopbackBridge;
+class LoadGenerator;
+class CaptureWriter;
+class PortReconnector;
+class BulkTransfer;
+class BridgeTransactionQueue;
+struct BridgeTransaction;
 
 namespace Ui {
 class MainWindow;
@@ -76,24 +100,71 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
     void aboutNuTool();
+    void setStartupClock(const QElapsedTimer &clock);
+    void startTrace(const QString &fileName);
 
 private slots:
     void processReceivedFrames();
     void sendFrame(const QByteArray &frame) const;
+    void portBytesWritten(qint64 bytes);
     void openSerialPort();
     void closeSerialPort();
+    void reconnectSerialPort(const QString &portName);
     void processErrors(QSerialPort::SerialPortError error);
+    void loadDbc();
+    void showSignalPlot();
+    void startBulkTransfer();
+    void processTransaction(const BridgeTransaction &transaction);
+    void showLatencyStats();
+    void editCanLatencyPairs();
+    void showBusLoad();
+    void toggleStreamServer(bool enable);
+    void sendClientFrame(const QByteArray &frame);
+    void toggleSocketCan(bool enable);
+    void toggleGateway(bool enable);
+    void openCapture();
+    void convertCapture();
+    void toggleCandumpReplay(bool enable);
+    void replayCanFrame(const STR_CANMSG_T &frame);
+    void updateDisplayLevel();
+    void toggleLoopback(bool enable);
+    void receiveLoopback(const QByteArray &data);
+    void toggleLoadGenerator(bool enable);
+    void toggleTrace(bool enable);
 
 protected:
     void closeEvent(QCloseEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private:
+    // Who queued bytes on the port, for WriteLedger.
+    enum WriteOwner {
+        WriteOther,
+        WriteBulk,
+        WriteTransactions
+    };
+
     void initActionsConnections();
+    void writeFrame(const QByteArray &frame, WriteOwner owner) const;
+    SettingsDialog *settingsDialog();
+    bool startSession(const SettingsDialog::Settings &p);
+    void processCanFrame(const STR_CANMSG_T &frame);
+    void showOnConsole(const QByteArray &text);
+    void startLoopbackSession(int brgMode);
+    void reportLoadGenerator();
+    void showCanChange(const STR_CANMSG_T &frame, ChangeFilter::Result result, quint8 changedBytes);
+    void updatePlotSignals();
+    void exportLatencyStats();
+    void logRxPoolStats();
+    void reportIntegrityEvents();
+    void logIntegrityStats();
+    void processReceivedData(const RxBuffer &buffer);
 
     qint64 m_numberFramesWritten = 0;
     Ui::MainWindow *m_ui = nullptr;
     QLabel *m_status = nullptr;
     QLabel *m_written = nullptr;
+    QLabel *m_displayLevel = nullptr;
     SettingsDialog *m_settings = nullptr;
     QSerialPort *m_serial = nullptr;
     Console *m_console = nullptr;
@@ -102,6 +173,40 @@ private:
     int m_mode = 0;
 
     Logger *m_logger = nullptr;
+    CaptureWriter *m_capture = nullptr;
+    PortReconnector *m_reconnector = nullptr;
+    BulkTransfer *m_bulk = nullptr;
+    BridgeTransactionQueue *m_transactions = nullptr;
+    StreamServer *m_stream = nullptr;
+    SocketCanBridge *m_socketCan = nullptr;
+    CanGateway *m_gateway = nullptr;
+    CandumpReplay *m_replay = nullptr;
+    LoopbackBridge *m_loopback = nullptr;
+    LoadGenerator *m_generator = nullptr;
+    QString m_generatorProfile = "rate=1000 ids=100-1ff dlc=8 duration=10 seed=1";
+    QString m_traceFile;
+    SettingsDialog::Settings m_activeSettings;
+    QString m_activeSerialNumber;
+    QString m_activeLocation;
+
+    RxBufferPool m_rxPool;
+    QByteArray m_hexText;
+    StreamIntegrity m_integrity;
+    DisplayPolicy m_display;
+    QTimer *m_displayTimer = nullptr;
+    qint64 m_displayOutputNs = 0;
+    ChangeFilter m_changes;
+    bool m_changesOnly = false;
+    DbcDatabase m_dbc;
+    QVector<DbcValue> m_dbcValues;
+    SignalPlotWindow *m_plotWindow = nullptr;
+    LatencyRecorder *m_latency = nullptr;
+    LatencyWindow *m_latencyWindow = nullptr;
+    BusLoadMeter *m_busLoad = nullptr;
+    WriteLedger *m_writes = nullptr;
+    BusLoadWindow *m_busLoadWindow = nullptr;
+    QElapsedTimer m_captureClock;
+    QElapsedTimer m_startupClock;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,278 @@
+#include "nubridge.h"
+#include "bridgecodec.h"
+#include "bridgesession.h"
+
+#include <QElapsedTimer>
+#include <QSerialPortInfo>
+
+#include <cstring>
+
+enum {
+    FrameBatch = 256    // frames converted per step in the batch calls
+};
+
+struct nubridge {
+    BridgeSession session;
+    BridgeConfig config;
+    QByteArray errorText;
+    QByteArray frame;
+};
+
+static int fail(nubridge *bridge, int status, const QString &reason)
+{
+    bridge->errorText = reason.toUtf8();
+    return status;
+}
+
+static int ioError(nubridge *bridge)
+{
+    return fail(bridge, NUBRIDGE_ERROR_IO, bridge->session.errorString());
+}
+
+static bool isMode(const nubridge *bridge, int mode)
+{
+    return bridge->session.isOpen() && bridge->config.brgMode == mode;
+}
+
+static void toMessage(const nubridge_can_frame &in, STR_CANMSG_T *out)
+{
+    out->IdType = (in.flags & NUBRIDGE_CAN_EXTENDED) ? CAN_EXT_ID : CAN_STD_ID;
+    out->FrameType = (in.flags & NUBRIDGE_CAN_REMOTE) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME;
+    out->Id = in.id;
+    out->DLC = in.dlc > 8 ? 8 : in.dlc;
+    memcpy(out->Data, in.data, 8);
+}
+
+static void fromMessage(const STR_CANMSG_T &in, nubridge_can_frame *out)
+{
+    out->id = in.Id;
+    out->flags = (in.IdType == CAN_EXT_ID ? NUBRIDGE_CAN_EXTENDED : 0)
+            | (in.FrameType == CAN_REMOTE_FRAME ? NUBRIDGE_CAN_REMOTE : 0);
+    out->dlc = in.DLC;
+    memcpy(out->data, in.Data, 8);
+}
+
+int nubridge_api_version(void)
+{
+    return NUBRIDGE_API_VERSION;
+}
+
+void nubridge_default_config(nubridge_config *config, int mode)
+{
+    if (config == nullptr)
+        return;
+
+    memset(config, 0, sizeof(*config));
+    config->mode = mode;
+    config->bus_mode = 1;
+    for (uint32_t &filter : config->can_filter)
+        filter = 0xFFFFFFFF;
+
+    switch (mode) {
+    case NUBRIDGE_MODE_I2C:
+        config->clock = 100000;
+        break;
+    case NUBRIDGE_MODE_SPI:
+        config->clock = 1000000;
+        break;
+    default:
+        config->clock = 500000;
+        break;
+    }
+}
+
+nubridge *nubridge_open(const char *port_name)
+{
+    if (port_name == nullptr)
+        return nullptr;
+
+    nubridge *bridge = new nubridge;
+    const QSerialPortInfo info(QString::fromUtf8(port_name));
+    bridge->config.brgMode = BRG_MODE_CAN;
+    bridge->config.name = info.isNull() ? QString::fromUtf8(port_name) : info.portName();
+    bridge->config.usbVendorID = info.vendorIdentifier();
+    bridge->config.usbProductID = info.productIdentifier();
+    return bridge;
+}
+
+void nubridge_close(nubridge *bridge)
+{
+    delete bridge;
+}
+
+int nubridge_configure(nubridge *bridge, const nubridge_config *config)
+{
+    if (bridge == nullptr || config == nullptr || config->clock == 0)
+        return NUBRIDGE_ERROR_ARGUMENT;
+
+    BridgeConfig &p = bridge->config;
+    const qint32 clock = static_cast<qint32>(config->clock & 0x0FFFFFFF);
+    switch (config->mode) {
+    case NUBRIDGE_MODE_CAN:
+        p.brgMode = BRG_MODE_CAN;
+        p.baudRate = clock;
+        p.normalModeEnabled = config->bus_mode != 0;
+        p.dataBits = QSerialPort::Data8;
+        p.parity = QSerialPort::NoParity;
+        p.stopBits = QSerialPort::OneStop;
+        for (int i = 0; i < 4; i++)
+            p.canID[i] = config->can_filter[i];
+        break;
+    case NUBRIDGE_MODE_I2C:
+        setI2cParameters(&p, clock, config->bus_mode);
+        break;
+    case NUBRIDGE_MODE_SPI:
+        if (config->spi_type < 0 || config->spi_type > 3)
+            return fail(bridge, NUBRIDGE_ERROR_ARGUMENT, QObject::tr("SPI type must be 0..3"));
+        setSpiParameters(&p, clock, config->bus_mode, config->spi_type,
+                         config->spi_lsb_first != 0, config->spi_ss_active_high != 0);
+        break;
+    default:
+        return fail(bridge, NUBRIDGE_ERROR_ARGUMENT, QObject::tr("Unknown mode %1").arg(config->mode));
+    }
+
+    return bridge->session.open(p) ? NUBRIDGE_OK : ioError(bridge);
+}
+
+int nubridge_capture(nubridge *bridge, const char *file_name)
+{
+    if (bridge == nullptr)
+        return NUBRIDGE_ERROR_ARGUMENT;
+
+    bridge->session.stopCapture();
+    if (file_name == nullptr)
+        return NUBRIDGE_OK;
+    return bridge->session.startCapture(QString::fromUtf8(file_name)) ? NUBRIDGE_OK : ioError(bridge);
+}
+
+int nubridge_send_batch(nubridge *bridge, const nubridge_can_frame *frames, int count, int timeout_ms)
+{
+    if (bridge == nullptr || (frames == nullptr && count > 0) || count < 0)
+        return NUBRIDGE_ERROR_ARGUMENT;
+    if (!isMode(bridge, BRG_MODE_CAN))
+        return fail(bridge, NUBRIDGE_ERROR_STATE, QObject::tr("Not configured for CAN"));
+
+    STR_CANMSG_T messages[FrameBatch];
+    for (int done = 0; done < count; ) {
+        const int n = qMin(static_cast<int>(FrameBatch), count - done);
+        for (int i = 0; i < n; i++)
+            toMessage(frames[done + i], &messages[i]);
+        if (!bridge->session.sendCan(messages, n, timeout_ms))
+            return ioError(bridge);
+        done += n;
+    }
+    return count;
+}
+
+int nubridge_receive_batch(nubridge *bridge, nubridge_can_frame *frames, int max_frames, int timeout_ms)
+{
+    if (bridge == nullptr || frames == nullptr || max_frames < 0)
+        return NUBRIDGE_ERROR_ARGUMENT;
+    if (!isMode(bridge, BRG_MODE_CAN))
+        return fail(bridge, NUBRIDGE_ERROR_STATE, QObject::tr("Not configured for CAN"));
+
+    STR_CANMSG_T messages[FrameBatch];
+    int done = 0;
+    while (done < max_frames) {
+        // Only the first step waits; the rest collects what is queued.
+        const int n = bridge->session.receiveCan(messages, qMin(static_cast<int>(FrameBatch), max_frames - done),
+                                                 done == 0 ? timeout_ms : 0);
+        if (n < 0)
+            return ioError(bridge);
+        if (n == 0)
+            break;
+        for (int i = 0; i < n; i++)
+            fromMessage(messages[i], &frames[done + i]);
+        done += n;
+    }
+    return done;
+}
+
+int nubridge_write(nubridge *bridge, const void *data, int size, int timeout_ms)
+{
+    if (bridge == nullptr || data == nullptr || size <= 0)
+        return NUBRIDGE_ERROR_ARGUMENT;
+    if (!bridge->session.isOpen() || bridge->config.brgMode == BRG_MODE_CAN)
+        return fail(bridge, NUBRIDGE_ERROR_STATE, QObject::tr("Not configured for I2C or SPI"));
+
+    if (!bridge->session.writeFrame(static_cast<const char *>(data), size, timeout_ms))
+        return ioError(bridge);
+    return size;
+}
+
+int nubridge_read(nubridge *bridge, void *data, int max_size, int timeout_ms)
+{
+    if (bridge == nullptr || data == nullptr || max_size < 0)
+        return NUBRIDGE_ERROR_ARGUMENT;
+    if (!bridge->session.isOpen() || bridge->config.brgMode == BRG_MODE_CAN)
+        return fail(bridge, NUBRIDGE_ERROR_STATE, QObject::tr("Not configured for I2C or SPI"));
+
+    const int n = bridge->session.read(static_cast<char *>(data), max_size, timeout_ms);
+    return n < 0 ? ioError(bridge) : n;
+}
+
+// Collects exactly size response bytes within timeout_ms overall.
+static int readExact(nubridge *bridge, char *data, int size, int timeout_ms)
+{
+    QElapsedTimer clock;
+    clock.start();
+    int done = 0;
+    while (done < size) {
+        const int left = qMax(0, timeout_ms - static_cast<int>(clock.elapsed()));
+        const int n = bridge->session.read(data + done, size - done, left);
+        if (n < 0)
+            return ioError(bridge);
+        if (n == 0)
+            return 0;
+        done += n;
+    }
+    return size;
+}
+
+int nubridge_i2c_read(nubridge *bridge, uint8_t address, void *data, int size, int timeout_ms)
+{
+    if (bridge == nullptr || data == nullptr || size < 1 || size > BridgeCodec::I2cMaxReadSize)
+        return NUBRIDGE_ERROR_ARGUMENT;
+    if (!isMode(bridge, BRG_MODE_I2C))
+        return fail(bridge, NUBRIDGE_ERROR_STATE, QObject::tr("Not configured for I2C"));
+
+    char request[BridgeCodec::I2cReadSize];
+    BridgeCodec::encodeI2cRead(address, size, request, sizeof(request));
+    if (!bridge->session.writeFrame(request, sizeof(request), timeout_ms))
+        return ioError(bridge);
+    return readExact(bridge, static_cast<char *>(data), size, timeout_ms);
+}
+
+int nubridge_i2c_write(nubridge *bridge, uint8_t address, const void *data, int size, int timeout_ms)
+{
+    if (bridge == nullptr || data == nullptr || size < 1)
+        return NUBRIDGE_ERROR_ARGUMENT;
+    if (!isMode(bridge, BRG_MODE_I2C))
+        return fail(bridge, NUBRIDGE_ERROR_STATE, QObject::tr("Not configured for I2C"));
+
+    bridge->frame.resize(BridgeCodec::i2cWriteSize(size));
+    BridgeCodec::encodeI2cWrite(address, static_cast<const char *>(data), size,
+                                bridge->frame.data(), bridge->frame.size());
+    if (!bridge->session.writeFrame(bridge->frame.constData(), bridge->frame.size(), timeout_ms))
+        return ioError(bridge);
+    return size;
+}
+
+int nubridge_spi_transfer(nubridge *bridge, const void *mosi, void *miso, int size, int timeout_ms)
+{
+    if (bridge == nullptr || mosi == nullptr || miso == nullptr || size < 1)
+        return NUBRIDGE_ERROR_ARGUMENT;
+    if (!isMode(bridge, BRG_MODE_SPI))
+        return fail(bridge, NUBRIDGE_ERROR_STATE, QObject::tr("Not configured for SPI"));
+
+    if (!bridge->session.writeFrame(static_cast<const char *>(mosi), size, timeout_ms))
+        return ioError(bridge);
+    return readExact(bridge, static_cast<char *>(miso), size, timeout_ms);
+}
+
+const char *nubridge_error_string(nubridge *bridge)
+{
+    if (bridge == nullptr)
+        return "invalid handle";
+    return bridge->errorText.constData();
+}
@@ -0,0 +1,118 @@
+#ifndef NUBRIDGE_H
+#define NUBRIDGE_H
+
+/*
+ * libnubridge: C interface to a Nu-Link bridge, for test harnesses and
+ * language bindings (e.g. Python ctypes). All calls block on the calling
+ * thread; a handle must not be used from two threads at once. No Qt event
+ * loop is required: if the process has no QCoreApplication, the first
+ * nubridge_configure() creates one, and each thread that configures a
+ * handle gets an event dispatcher. Use a handle on the thread that
+ * configured it. tests/nubridge/nubridge_harness.c shows the calls.
+ *
+ * Functions returning int return NUBRIDGE_OK or a count on success and a
+ * negative nubridge_status on failure; nubridge_error_string() describes
+ * the last failure on a handle.
+ */
+
+#include <stdint.h>
+
+#if defined(NUBRIDGE_STATIC)
+#  define NUBRIDGE_API
+#elif defined(_WIN32)
+#  if defined(NUBRIDGE_BUILD)
+#    define NUBRIDGE_API __declspec(dllexport)
+#  else
+#    define NUBRIDGE_API __declspec(dllimport)
+#  endif
+#else
+#  define NUBRIDGE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NUBRIDGE_API_VERSION 1
+
+enum nubridge_mode {
+    NUBRIDGE_MODE_CAN = 0,
+    NUBRIDGE_MODE_I2C = 1,
+    NUBRIDGE_MODE_SPI = 2
+};
+
+enum nubridge_status {
+    NUBRIDGE_OK = 0,
+    NUBRIDGE_ERROR_ARGUMENT = -1,
+    NUBRIDGE_ERROR_STATE = -2,      /* not configured, or wrong mode */
+    NUBRIDGE_ERROR_IO = -3
+};
+
+#define NUBRIDGE_CAN_EXTENDED 0x01
+#define NUBRIDGE_CAN_REMOTE   0x02
+
+typedef struct nubridge_can_frame {
+    uint32_t id;
+    uint8_t flags;                  /* NUBRIDGE_CAN_* */
+    uint8_t dlc;
+    uint8_t data[8];
+} nubridge_can_frame;
+
+typedef struct nubridge_config {
+    int mode;                       /* nubridge_mode */
+    uint32_t clock;                 /* CAN bit rate or I2C / SPI clock in Hz */
+    int bus_mode;                   /* CAN: 0 silent, 1 normal; I2C / SPI: 0 monitor, 1 master */
+    uint32_t can_filter[4];         /* CAN: 0xFFFFFFFF leaves a filter slot unused */
+    int spi_type;                   /* SPI: clock polarity / phase type 0..3 */
+    int spi_lsb_first;
+    int spi_ss_active_high;
+} nubridge_config;
+
+typedef struct nubridge nubridge;
+
+NUBRIDGE_API int nubridge_api_version(void);
+
+/* Fills *config with the defaults of the settings dialog for mode. */
+NUBRIDGE_API void nubridge_default_config(nubridge_config *config, int mode);
+
+/* Creates a handle for a serial port such as "COM5" or "ttyACM0". The port
+ * is opened by nubridge_configure(). */
+NUBRIDGE_API nubridge *nubridge_open(const char *port_name);
+NUBRIDGE_API void nubridge_close(nubridge *bridge);
+
+/* (Re)opens the port with config and, in CAN mode, sends the CAN setup. */
+NUBRIDGE_API int nubridge_configure(nubridge *bridge, const nubridge_config *config);
+
+/* Records all traffic to a NUCP capture file; NULL stops recording. */
+NUBRIDGE_API int nubridge_capture(nubridge *bridge, const char *file_name);
+
+/* CAN mode. send_batch writes all frames in one transfer and returns
+ * count; receive_batch returns 0..max_frames frames, waiting up to
+ * timeout_ms for the first one. A timeout of 0 only polls. */
+NUBRIDGE_API int nubridge_send_batch(nubridge *bridge, const nubridge_can_frame *frames, int count,
+                                     int timeout_ms);
+NUBRIDGE_API int nubridge_receive_batch(nubridge *bridge, nubridge_can_frame *frames, int max_frames,
+                                        int timeout_ms);
+
+/* I2C and SPI mode: raw frames as the settings dialog's console sends
+ * them, and the response bytes. */
+NUBRIDGE_API int nubridge_write(nubridge *bridge, const void *data, int size, int timeout_ms);
+NUBRIDGE_API int nubridge_read(nubridge *bridge, void *data, int max_size, int timeout_ms);
+
+/* I2C and SPI helpers: encode the request, then collect exactly size
+ * response bytes. Return size, or 0 on timeout. */
+NUBRIDGE_API int nubridge_i2c_read(nubridge *bridge, uint8_t address, void *data, int size,
+                                   int timeout_ms);
+NUBRIDGE_API int nubridge_i2c_write(nubridge *bridge, uint8_t address, const void *data, int size,
+                                    int timeout_ms);
+NUBRIDGE_API int nubridge_spi_transfer(nubridge *bridge, const void *mosi, void *miso, int size,
+                                       int timeout_ms);
+
+/* UTF-8, valid until the next call on bridge. */
+NUBRIDGE_API const char *nubridge_error_string(nubridge *bridge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NUBRIDGE_H */
@@ -0,0 +1,38 @@
+# Bridge protocol, I/O engine and capture writers. Depends on QtCore and
+# QtSerialPort only; shared by the application and libnubridge.pro.
+
+QT *= core serialport
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/bridgeport.cpp \
+    $$PWD/bridgesession.cpp \
+    $$PWD/bulktransfer.cpp \
+    $$PWD/candumpreader.cpp \
+    $$PWD/capturefile.cpp \
+    $$PWD/captureindex.cpp \
+    $$PWD/loadgenerator.cpp \
+    $$PWD/loopbackbridge.cpp \
+    $$PWD/rxbufferpool.cpp \
+    $$PWD/streamintegrity.cpp \
+    $$PWD/tracerecorder.cpp \
+    $$PWD/transactionqueue.cpp
+
+HEADERS += \
+    $$PWD/nuvbridge.h \
+    $$PWD/bridgecodec.h \
+    $$PWD/canframeparser.h \
+    $$PWD/bridgeport.h \
+    $$PWD/bridgesession.h \
+    $$PWD/bulktransfer.h \
+    $$PWD/candumpreader.h \
+    $$PWD/capturefile.h \
+    $$PWD/captureindex.h \
+    $$PWD/loadgenerator.h \
+    $$PWD/loopbackbridge.h \
+    $$PWD/rxbufferpool.h \
+    $$PWD/streamintegrity.h \
+    $$PWD/tracerecorder.h \
+    $$PWD/transactionqueue.h \
+    $$PWD/writeledger.h
@@ -0,0 +1,82 @@
+#include "portreconnector.h"
+#include "deviceregistry.h"
+
+#include <QTimer>
+
+enum {
+    InitialDelay = 250,     // ms
+    MaximumDelay = 8000     // ms
+};
+
+PortReconnector::PortReconnector(QObject *parent) :
+    QObject(parent),
+    m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &PortReconnector::probe);
+}
+
+void PortReconnector::start(const QString &portName, const QString &serialNumber, const QString &systemLocation)
+{
+    m_portName = portName;
+    m_serialNumber = serialNumber;
+    m_systemLocation = systemLocation;
+    m_attempts = 0;
+    m_delay = InitialDelay;
+    m_downtime.start();
+
+    schedule();
+}
+
+void PortReconnector::retry()
+{
+    if (m_state == Idle)
+        return;
+
+    m_delay = qMin(m_delay * 2, static_cast<int>(MaximumDelay));
+    schedule();
+}
+
+void PortReconnector::stop()
+{
+    m_timer->stop();
+    m_state = Idle;
+}
+
+qint64 PortReconnector::finish()
+{
+    stop();
+    return m_downtime.elapsed();
+}
+
+void PortReconnector::schedule()
+{
+    m_state = Waiting;
+
+    // Refresh the device list now so it is current when the timer fires.
+    DeviceRegistry::instance()->rescan();
+    m_timer->start(m_delay);
+}
+
+void PortReconnector::probe()
+{
+    m_attempts++;
+
+    const QVector<BridgeDevice> devices = DeviceRegistry::instance()->devices();
+    for (const BridgeDevice &dev : devices) {
+        if (!dev.present)
+            continue;
+
+        const bool match = !m_serialNumber.isEmpty()
+                ? (dev.serialNumber == m_serialNumber)
+                : (dev.systemLocation == m_systemLocation || dev.portName == m_portName);
+
+        if (match) {
+            m_state = Connecting;
+            emit deviceFound(dev.portName);
+            return;
+        }
+    }
+
+    retry();
+}
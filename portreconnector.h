@@ -0,0 +1,57 @@
+#ifndef PORTRECONNECTOR_H
+#define PORTRECONNECTOR_H
+
+#include <QElapsedTimer>
+#include <QObject>
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+
+QT_END_NAMESPACE
+
+// Looks for a lost bridge with exponential backoff. The adapter is found
+// again by USB serial number when it has one, otherwise by its port.
+class PortReconnector : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum State {
+        Idle,
+        Waiting,            // backoff timer running
+        Connecting          // candidate reported, owner is reopening it
+    };
+
+    explicit PortReconnector(QObject *parent = nullptr);
+
+    State state() const { return m_state; }
+    int attempts() const { return m_attempts; }
+
+    void start(const QString &portName, const QString &serialNumber, const QString &systemLocation);
+    void retry();
+    void stop();
+
+    // Ends a successful reconnect and returns how long the link was down.
+    qint64 finish();
+
+signals:
+    void deviceFound(const QString &portName);
+
+private slots:
+    void probe();
+
+private:
+    void schedule();
+
+    State m_state = Idle;
+    QString m_portName;
+    QString m_serialNumber;
+    QString m_systemLocation;
+    int m_attempts = 0;
+    int m_delay = 0;
+    QElapsedTimer m_downtime;
+    QTimer *m_timer = nullptr;
+};
+
+#endif // PORTRECONNECTOR_H
@@ -0,0 +1,141 @@
+#include "rxbufferpool.h"
+
+#include <utility>
+
+RxBuffer::RxBuffer(Block *block) :
+    m_block(block)
+{
+}
+
+RxBuffer::RxBuffer(const RxBuffer &other) :
+    m_block(other.m_block)
+{
+    if (m_block != nullptr)
+        m_block->refs.ref();
+}
+
+RxBuffer::RxBuffer(RxBuffer &&other) noexcept :
+    m_block(other.m_block)
+{
+    other.m_block = nullptr;
+}
+
+RxBuffer &RxBuffer::operator=(RxBuffer other) noexcept
+{
+    std::swap(m_block, other.m_block);
+    return *this;
+}
+
+RxBuffer::~RxBuffer()
+{
+    if (m_block == nullptr || m_block->refs.deref())
+        return;
+
+    if (m_block->pool != nullptr) {
+        m_block->pool->release(m_block);
+    } else {
+        delete[] m_block->data;
+        delete m_block;
+    }
+}
+
+char *RxBuffer::data()
+{
+    return m_block != nullptr ? m_block->data : nullptr;
+}
+
+const char *RxBuffer::constData() const
+{
+    return m_block != nullptr ? m_block->data : nullptr;
+}
+
+int RxBuffer::size() const
+{
+    return m_block != nullptr ? m_block->size : 0;
+}
+
+int RxBuffer::capacity() const
+{
+    return m_block != nullptr ? m_block->capacity : 0;
+}
+
+void RxBuffer::setSize(int size)
+{
+    if (m_block != nullptr)
+        m_block->size = qBound(0, size, m_block->capacity);
+}
+
+RxBufferPool::RxBufferPool(int blocks, int blockSize) :
+    m_blockSize(blockSize)
+{
+    m_blocks.reserve(blocks);
+    m_free.reserve(blocks);
+    for (int i = 0; i < blocks; i++) {
+        RxBuffer::Block *block = new RxBuffer::Block;
+        block->pool = this;
+        block->size = 0;
+        block->capacity = blockSize;
+        block->data = new char[blockSize];
+        m_blocks.append(block);
+        m_free.append(block);
+    }
+}
+
+RxBufferPool::~RxBufferPool()
+{
+    // Outstanding handles must not outlive the pool; orphan them as heap
+    // blocks so their destructor still frees the memory.
+    for (RxBuffer::Block *block : qAsConst(m_blocks)) {
+        if (m_free.contains(block)) {
+            delete[] block->data;
+            delete block;
+        } else {
+            block->pool = nullptr;
+        }
+    }
+}
+
+RxBuffer RxBufferPool::acquire()
+{
+    m_acquired++;
+
+    RxBuffer::Block *block;
+    if (!m_free.isEmpty()) {
+        block = m_free.takeLast();
+        m_highWater = qMax(m_highWater, m_blocks.size() - m_free.size());
+    } else {
+        m_overflows++;
+        block = new RxBuffer::Block;
+        block->pool = nullptr;
+        block->capacity = m_blockSize;
+        block->data = new char[m_blockSize];
+    }
+
+    block->refs.store(1);
+    block->size = 0;
+    return RxBuffer(block);
+}
+
+void RxBufferPool::release(RxBuffer::Block *block)
+{
+    m_free.append(block);
+}
+
+RxBufferPool::Stats RxBufferPool::stats() const
+{
+    Stats s;
+    s.blocks = m_blocks.size();
+    s.blockSize = m_blockSize;
+    s.inUse = m_blocks.size() - m_free.size();
+    s.highWater = m_highWater;
+    s.acquired = m_acquired;
+    s.overflows = m_overflows;
+    return s;
+}
+
+void RxBufferPool::resetStats()
+{
+    m_highWater = m_blocks.size() - m_free.size();
+    m_acquired = 0;
+    m_overflows = 0;
+}
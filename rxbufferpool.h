@@ -0,0 +1,80 @@
+#ifndef RXBUFFERPOOL_H
+#define RXBUFFERPOOL_H
+
+#include <QAtomicInt>
+#include <QVector>
+
+class RxBufferPool;
+
+// Handle to one pooled receive block. Copies share the block; it goes back
+// to the pool when the last handle is dropped, so a consumer that needs the
+// bytes later keeps a copy of the handle instead of copying the data.
+class RxBuffer
+{
+public:
+    RxBuffer() = default;
+    RxBuffer(const RxBuffer &other);
+    RxBuffer(RxBuffer &&other) noexcept;
+    RxBuffer &operator=(RxBuffer other) noexcept;
+    ~RxBuffer();
+
+    bool isNull() const { return m_block == nullptr; }
+    char *data();
+    const char *constData() const;
+    int size() const;
+    int capacity() const;
+    void setSize(int size);
+
+private:
+    friend class RxBufferPool;
+    struct Block;
+
+    explicit RxBuffer(Block *block);
+
+    Block *m_block = nullptr;
+};
+
+// Fixed set of receive blocks allocated up front. In steady state the
+// receive path cycles through them without touching the heap; if every
+// block is held, acquire() falls back to a one-off allocation and counts it.
+class RxBufferPool
+{
+public:
+    struct Stats {
+        int blocks;             // pooled blocks
+        int blockSize;
+        int inUse;              // pooled blocks held right now
+        int highWater;          // most pooled blocks held at once
+        qint64 acquired;
+        qint64 overflows;       // acquires served from the heap
+    };
+
+    explicit RxBufferPool(int blocks = 16, int blockSize = 16 * 1024);
+    ~RxBufferPool();
+
+    RxBuffer acquire();
+    Stats stats() const;
+    void resetStats();
+
+private:
+    friend class RxBuffer;
+
+    void release(RxBuffer::Block *block);
+
+    QVector<RxBuffer::Block *> m_blocks;
+    QVector<RxBuffer::Block *> m_free;
+    int m_blockSize;
+    int m_highWater = 0;
+    qint64 m_acquired = 0;
+    qint64 m_overflows = 0;
+};
+
+struct RxBuffer::Block {
+    RxBufferPool *pool;         // null for overflow blocks
+    QAtomicInt refs;
+    int size;
+    int capacity;
+    char *data;
+};
+
+#endif // RXBUFFERPOOL_H
@@ -50,6 +50,9 @@
 
 #include "sendframebox.h"
 #include "ui_sendframebox.h"
+#include "bridgecodec.h"
+
+#include <cstring>
 
 enum {
     MaxStandardId = 0x7FF,
@@ -135,6 +138,31 @@ SendFrameBox::SendFrameBox(QWidget *parent) :
 {
     m_ui->setupUi(this);
 
+    // Only the visible page is wired up now, the others when first shown.
+    connect(this, &QTabWidget::currentChanged, [this](int idx) {
+        setupPage(widget(idx));
+    });
+    setupPage(currentWidget());
+}
+
+void SendFrameBox::setupPage(QWidget *page)
+{
+    if (page == nullptr || m_readyPages.contains(page))
+        return;
+
+    m_readyPages.append(page);
+
+    if (page == m_ui->tabCAN) {
+        setupCanPage();
+    } else if (page == m_ui->tabI2C) {
+        setupI2cPage();
+    } else if (page == m_ui->tabSPI) {
+        setupSpiPage();
+    }
+}
+
+void SendFrameBox::setupCanPage()
+{
     m_hexIntegerValidator = new HexIntegerValidator(this);
     m_ui->frameIdEdit->setValidator(m_hexIntegerValidator);
     m_hexStringValidator = new HexStringValidator(this);
@@ -161,24 +189,22 @@ SendFrameBox::SendFrameBox(QWidget *parent) :
         QString data = m_ui->payloadEdit->text();
         const QByteArray payload = QByteArray::fromHex(data.remove(QLatin1Char(' ')).toLatin1());
 
-        CANMSG_U frame;
-        frame.can_frame.IdType = m_ui->extendedFormatBox->isChecked() ? CAN_EXT_ID : CAN_STD_ID;
-        frame.can_frame.FrameType = m_ui->remoteFrame->isChecked() ? CAN_REMOTE_FRAME : CAN_DATA_FRAME;
-        frame.can_frame.Id = frameId;
-        frame.can_frame.DLC = static_cast<unsigned char>(payload.size());
-        for (unsigned char i = 0; i < 8; i++) {
-            if (i < frame.can_frame.DLC) {
-                frame.can_frame.Data[i] = payload[i];
-            } else {
-                frame.can_frame.Data[i] = 0;
-            }
-        }
-
-        QByteArray QData = QByteArray::fromRawData(frame.can_raw, sizeof(CANMSG_U));
+        STR_CANMSG_T frame = {};
+        frame.IdType = m_ui->extendedFormatBox->isChecked() ? CAN_EXT_ID : CAN_STD_ID;
+        frame.FrameType = m_ui->remoteFrame->isChecked() ? CAN_REMOTE_FRAME : CAN_DATA_FRAME;
+        frame.Id = frameId;
+        frame.DLC = static_cast<unsigned char>(qMin(payload.size(), 8));
+        memcpy(frame.Data, payload.constData(), frame.DLC);
+
+        char raw[BridgeCodec::CanMessageSize];
+        const QByteArray QData(raw, BridgeCodec::encodeCanMessage(frame, raw, sizeof(raw)));
 
         emit sendFrame(QData);
     });
+}
 
+void SendFrameBox::setupI2cPage()
+{
     // i2c - read
     auto frameI2cReadChanged = [this]() {
         const bool i2cReadValid = (!m_ui->i2cReadAddrEdit->text().isEmpty())
@@ -207,21 +233,31 @@ SendFrameBox::SendFrameBox(QWidget *parent) :
     connect(m_ui->i2cReadButton, &QPushButton::clicked, [this]() {
         const uint i2cAddr = m_ui->i2cReadAddrEdit->text().toUInt(nullptr, 16);
         const uint i2cSize = m_ui->i2cReadSizeEdit->text().toUInt(nullptr, 16);
-        uint i2cData = (i2cAddr & 0xFFFF) | ((i2cSize & 0xFFFF) << 16) | 0x80;
-        QByteArray QData = QByteArray::fromRawData((const char *)&i2cData, sizeof(uint));
-        emit sendFrame(QData);
+        emit i2cRead(static_cast<quint8>(i2cAddr), static_cast<int>(i2cSize));
     });
 
     // i2c - write data
     connect(m_ui->i2cWriteButton, &QPushButton::clicked, [this]() {
         const uint i2cAddr = m_ui->i2cWriteAddrEdit->text().toUInt(nullptr, 16);
         QString data = m_ui->i2cWritePlainTextEdit->toPlainText();
-        QByteArray QData = QByteArray::fromHex(data.simplified().remove(QLatin1Char(' ')).toLatin1());
-        QData.push_front((char)0);
-        QData.push_front((char)i2cAddr);
-        emit sendFrame(QData);
+        const QByteArray QData = QByteArray::fromHex(data.simplified().remove(QLatin1Char(' ')).toLatin1());
+        emit i2cWrite(static_cast<quint8>(i2cAddr), QData);
     });
 
+    // Validator - i2c address
+    m_i2cAddrValidator = new HexIntegerValidator(this);
+    m_ui->i2cReadAddrEdit->setValidator(m_i2cAddrValidator);
+    m_ui->i2cWriteAddrEdit->setValidator(m_i2cAddrValidator);
+    m_i2cAddrValidator->setMaximum(0x7F);
+
+    // Validator - i2c read size
+    m_i2cReadValidator = new HexIntegerValidator(this);
+    m_ui->i2cReadSizeEdit->setValidator(m_i2cReadValidator);
+    m_i2cReadValidator->setMaximum(0x200);
+}
+
+void SendFrameBox::setupSpiPage()
+{
     // spi
     auto frameSpiChanged = [this]() {
         const bool spiValid = !m_ui->spiPlainTextEdit->document()->isEmpty();
@@ -236,19 +272,8 @@ SendFrameBox::SendFrameBox(QWidget *parent) :
     connect(m_ui->spiSendButton, &QPushButton::clicked, [this]() {
         QString data = m_ui->spiPlainTextEdit->toPlainText();
         const QByteArray QData = QByteArray::fromHex(data.simplified().remove(QLatin1Char(' ')).toLatin1());
-        emit sendFrame(QData);
+        emit spiTransfer(QData);
     });
-
-    // Validator - i2c address
-    m_i2cAddrValidator = new HexIntegerValidator(this);
-    m_ui->i2cReadAddrEdit->setValidator(m_i2cAddrValidator);
-    m_ui->i2cWriteAddrEdit->setValidator(m_i2cAddrValidator);
-    m_i2cAddrValidator->setMaximum(0x7F);
-
-    // Validator - i2c read size
-    m_i2cReadValidator = new HexIntegerValidator(this);
-    m_ui->i2cReadSizeEdit->setValidator(m_i2cReadValidator);
-    m_i2cReadValidator->setMaximum(0x200);
 }
 
 SendFrameBox::~SendFrameBox()
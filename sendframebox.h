@@ -54,6 +54,7 @@
 #include <QTabWidget>
 #include <QRegularExpression>
 #include <QValidator>
+#include <QVector>
 #include "nuvbridge.h"
 
 QT_BEGIN_NAMESPACE
@@ -101,9 +102,18 @@ public:
 
 signals:
     void sendFrame(const QByteArray &frame);
+    void i2cRead(quint8 address, int size);
+    void i2cWrite(quint8 address, const QByteArray &data);
+    void spiTransfer(const QByteArray &mosi);
 
 private:
+    void setupPage(QWidget *page);
+    void setupCanPage();
+    void setupI2cPage();
+    void setupSpiPage();
+
     Ui::SendFrameBox *m_ui = nullptr;
+    QVector<QWidget *> m_readyPages;
 
     HexIntegerValidator *m_hexIntegerValidator = nullptr;
     HexStringValidator *m_hexStringValidator = nullptr;
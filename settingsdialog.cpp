@@ -54,8 +54,9 @@
 
 #include <QIntValidator>
 #include <QLineEdit>
-#include <QSerialPortInfo>
+#include <QStandardItemModel>
 
+#include "deviceregistry.h"
 #include "sendframebox.h"
 
 static const char blankString[] = QT_TRANSLATE_NOOP("SettingsDialog", "N/A");
@@ -88,6 +89,7 @@ SettingsDialog::SettingsDialog(QWidget *parent) :
     fillI2cParameters();
     fillSpiParameters();
     fillPortsInfo();
+    connect(DeviceRegistry::instance(), &DeviceRegistry::devicesChanged, this, &SettingsDialog::fillPortsInfo);
 
 
     m_hexIntegerValidatorStd = new HexIntegerValidator(this);
@@ -147,7 +149,8 @@ SettingsDialog::Settings SettingsDialog::settings() const
 void SettingsDialog::clickPortInfo(int idx)
 {
     if (idx == 0) {
-        fillPortsInfo();
+        // the list follows devicesChanged once the scan is done
+        DeviceRegistry::instance()->rescan();
         return;
     }
 }
@@ -267,32 +270,36 @@ void SettingsDialog::fillSpiParameters()
 
 void SettingsDialog::fillPortsInfo()
 {
+    const QString current = m_ui->serialPortInfoListBox->currentText();
+
+    m_ui->serialPortInfoListBox->blockSignals(true);
     m_ui->serialPortInfoListBox->clear();
     m_ui->serialPortInfoListBox->addItem(tr("Scan Port"));
-    QString description;
-    QString manufacturer;
-    QString serialNumber;
-    QRegularExpression re("^Nu-Link\\d-Bridge");
 
-    const auto infos = QSerialPortInfo::availablePorts();
-    for (const QSerialPortInfo &info : infos) {
+    QStandardItemModel *model = qobject_cast<QStandardItemModel *>(m_ui->serialPortInfoListBox->model());
+
+    const QVector<BridgeDevice> devices = DeviceRegistry::instance()->devices();
+    for (const BridgeDevice &dev : devices) {
         QStringList list;
-        description = info.description();
-        manufacturer = info.manufacturer();
-        serialNumber = info.serialNumber();
-
-        if (re.match(description).hasMatch()) {
-            list << info.portName()
-                 << (!description.isEmpty() ? description : blankString)
-                 << (!manufacturer.isEmpty() ? manufacturer : blankString)
-                 << (!serialNumber.isEmpty() ? serialNumber : blankString)
-                 << info.systemLocation()
-                 << (info.vendorIdentifier() ? QString("%1").arg(info.vendorIdentifier(), 4, 16, QChar('0')) : blankString)
-                 << (info.productIdentifier() ? QString("%1").arg(info.productIdentifier(), 4, 16, QChar('0')) : blankString);
-
-            m_ui->serialPortInfoListBox->addItem(list.first(), list);
-        }
+        list << dev.portName
+             << (!dev.description.isEmpty() ? dev.description : blankString)
+             << (!dev.manufacturer.isEmpty() ? dev.manufacturer : blankString)
+             << (!dev.serialNumber.isEmpty() ? dev.serialNumber : blankString)
+             << dev.systemLocation
+             << QString("%1").arg(dev.vendorId, 4, 16, QChar('0'))
+             << QString("%1").arg(dev.productId, 4, 16, QChar('0'));
+
+        m_ui->serialPortInfoListBox->addItem(dev.present ? dev.portName : tr("%1 (removed)").arg(dev.portName), list);
+
+        // keep unplugged ports visible but not selectable
+        if (!dev.present && model != nullptr)
+            model->item(m_ui->serialPortInfoListBox->count() - 1)->setEnabled(false);
     }
+
+    const int idx = m_ui->serialPortInfoListBox->findText(current);
+    m_ui->serialPortInfoListBox->setCurrentIndex(idx > 0 ? idx : 0);
+    m_ui->serialPortInfoListBox->blockSignals(false);
+    showPortInfo(m_ui->serialPortInfoListBox->currentIndex());
 }
 
 void SettingsDialog::updateSettings()
@@ -303,27 +310,21 @@ void SettingsDialog::updateSettings()
     m_currentSettings.usbProductID = m_ui->pidLabel->text().right(4).toInt(nullptr, 16);
 
     // COM port
-    m_currentSettings.name = m_ui->serialPortInfoListBox->currentText();
+    const QStringList portInfo = m_ui->serialPortInfoListBox->currentData().toStringList();
+    m_currentSettings.name = portInfo.isEmpty() ? m_ui->serialPortInfoListBox->currentText() : portInfo.first();
     if (m_mode == BRG_MODE_I2C) {
-        m_currentSettings.baudRate = m_ui->i2cClockBox->itemData(m_ui->i2cClockBox->currentIndex()).toInt();
-        m_currentSettings.normalModeEnabled = m_ui->i2cModeBox->itemData(m_ui->i2cModeBox->currentIndex()).toInt();
-        m_currentSettings.stopBits = !m_currentSettings.normalModeEnabled ? QSerialPort::OneStop : QSerialPort::TwoStop;
-        m_currentSettings.parity = QSerialPort::NoParity;
-        m_currentSettings.dataBits = QSerialPort::Data8;
+        setI2cParameters(&m_currentSettings,
+                         m_ui->i2cClockBox->itemData(m_ui->i2cClockBox->currentIndex()).toInt(),
+                         m_ui->i2cModeBox->itemData(m_ui->i2cModeBox->currentIndex()).toInt());
         return;
 
     } else if (m_mode == BRG_MODE_SPI) {
-        m_currentSettings.baudRate = m_ui->spiClockBox->itemData(m_ui->spiClockBox->currentIndex()).toInt();
-        m_currentSettings.normalModeEnabled = m_ui->spiModeBox->itemData(m_ui->spiModeBox->currentIndex()).toInt();
-
-        QSerialPort::StopBits spiMode[3] = {QSerialPort::OneStop, QSerialPort::OneAndHalfStop, QSerialPort::TwoStop};
-        m_currentSettings.stopBits = spiMode[m_ui->spiModeBox->itemData(m_ui->spiModeBox->currentIndex()).toInt()];
-
-        QSerialPort::Parity spiType[4] = {QSerialPort::NoParity, QSerialPort::OddParity, QSerialPort::EvenParity, QSerialPort::MarkParity};
-        m_currentSettings.parity = spiType[m_ui->spiTypeBox->itemData(m_ui->spiTypeBox->currentIndex()).toInt()];
-
-        QSerialPort::DataBits spiMisc[4] = {QSerialPort::Data8, QSerialPort::Data5, QSerialPort::Data6, QSerialPort::Data7};
-        m_currentSettings.dataBits = spiMisc[m_ui->spiOrderBox->currentIndex() + 2 * m_ui->spiSsActiveBox->currentIndex()];
+        setSpiParameters(&m_currentSettings,
+                         m_ui->spiClockBox->itemData(m_ui->spiClockBox->currentIndex()).toInt(),
+                         m_ui->spiModeBox->itemData(m_ui->spiModeBox->currentIndex()).toInt(),
+                         m_ui->spiTypeBox->itemData(m_ui->spiTypeBox->currentIndex()).toInt(),
+                         m_ui->spiOrderBox->currentIndex() == 1,
+                         m_ui->spiSsActiveBox->currentIndex() == 1);
         return;
     }
 
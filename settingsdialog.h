@@ -55,6 +55,8 @@
 #include <QDialog>
 #include <QSerialPort>
 
+#include "bridgeport.h"
+
 QT_BEGIN_NAMESPACE
 
 namespace Ui {
@@ -66,29 +68,15 @@ class HexIntegerValidator;
 
 QT_END_NAMESPACE
 
-#define BRG_MODE_CAN (0)
-#define BRG_MODE_I2C (1)
-#define BRG_MODE_SPI (2)
-
 class SettingsDialog : public QDialog
 {
     Q_OBJECT
 
 public:
 
-    struct Settings {
-        int brgMode;
-        QString name;
-        qint32 baudRate;
-        QSerialPort::DataBits dataBits;
-        QSerialPort::Parity parity;
-        QSerialPort::StopBits stopBits;
+    struct Settings : BridgeConfig {
         QSerialPort::FlowControl flowControl;
         bool logFileEnabled;
-        bool normalModeEnabled;
-        unsigned int canID[4];
-        unsigned int usbVendorID;
-        unsigned int usbProductID;
     };
 
     explicit SettingsDialog(QWidget *parent = nullptr);
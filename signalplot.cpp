@@ -0,0 +1,331 @@
+#include "signalplot.h"
+
+#include <QHBoxLayout>
+#include <QListWidget>
+#include <QPainter>
+#include <QSplitter>
+#include <QTimer>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void MinMaxPyramid::append(qint64 time, float value)
+{
+    if (m_times.size() >= MaxSamples + TrimSamples) {
+        m_times.remove(0, TrimSamples);
+        m_values.remove(0, TrimSamples);
+        m_base += TrimSamples;
+    }
+
+    m_times.append(time);
+    m_values.append(value);
+
+    // Fold the sample into the open bucket of each level; a level that fills
+    // up closes its bucket and carries it into the next one.
+    Bucket carry = {time, time, value, value};
+    for (int level = 0; ; level++) {
+        if (level == m_open.size()) {
+            m_open.append(carry);
+            m_openCount.append(0);
+            m_levels.append(QVector<Bucket>());
+            m_levelBase.append(0);
+        }
+
+        Bucket &open = m_open[level];
+        if (m_openCount.at(level) == 0) {
+            open = carry;
+        } else {
+            open.last = carry.last;
+            open.min = qMin(open.min, carry.min);
+            open.max = qMax(open.max, carry.max);
+        }
+
+        if (++m_openCount[level] < FanOut)
+            break;
+
+        QVector<Bucket> &buckets = m_levels[level];
+        if (buckets.size() >= MaxBuckets + TrimBuckets) {
+            buckets.remove(0, TrimBuckets);
+            m_levelBase[level] += TrimBuckets;
+        }
+        buckets.append(open);
+        m_openCount[level] = 0;
+        carry = open;
+    }
+}
+
+void MinMaxPyramid::clear()
+{
+    m_times.clear();
+    m_values.clear();
+    m_levels.clear();
+    m_levelBase.clear();
+    m_open.clear();
+    m_openCount.clear();
+    m_base = 0;
+}
+
+void MinMaxPyramid::query(qint64 from, qint64 to, int columns, float *colMin, float *colMax) const
+{
+    if (m_times.isEmpty() || to <= from || columns <= 0)
+        return;
+
+    const qint64 *times = m_times.constData();
+    const float *values = m_values.constData();
+    const int lower = static_cast<int>(std::lower_bound(times, times + m_times.size(), from) - times);
+    const int upper = static_cast<int>(std::lower_bound(times, times + m_times.size(), to) - times);
+
+    const double scale = static_cast<double>(columns) / static_cast<double>(to - from);
+    auto merge = [&](qint64 first, qint64 last, float min, float max) {
+        const int a = qBound(0, static_cast<int>((qMax(first, from) - from) * scale), columns - 1);
+        const int b = qBound(0, static_cast<int>((qMin(last, to - 1) - from) * scale), columns - 1);
+        colMin[a] = qMin(colMin[a], min);
+        colMax[a] = qMax(colMax[a], max);
+        if (b != a) {
+            colMin[b] = qMin(colMin[b], min);
+            colMax[b] = qMax(colMax[b], max);
+        }
+    };
+
+    // Coarsest level whose buckets still hold no more samples than a column.
+    // Before the raw samples, the count is estimated from their rate.
+    double perColumn = static_cast<double>(upper - lower) / columns;
+    const qint64 rawSpan = m_times.last() - m_times.first();
+    if (from < m_times.first() && rawSpan > 0)
+        perColumn = qMax(perColumn, static_cast<double>(to - from) / columns * (m_times.size() - 1) / rawSpan);
+    int top = -1;
+    qint64 topSize = 1;
+    while (top + 1 < m_levels.size() && topSize * FanOut <= perColumn) {
+        top++;
+        topSize *= FanOut;
+    }
+
+    // Walk sample numbers from lower to upper, each time taking the largest
+    // closed bucket that starts here and ends inside the range, so no bucket
+    // brings in samples from outside the window.
+    const qint64 end = m_base + upper;
+    qint64 index = m_base + lower;
+    while (index < end) {
+        int level = top;
+        qint64 bucketSize = topSize;
+        for (; level >= 0; level--, bucketSize /= FanOut) {
+            if (index % bucketSize != 0 || index + bucketSize > end)
+                continue;
+            const qint64 b = index / bucketSize - m_levelBase.at(level);
+            if (b >= 0 && b < m_levels.at(level).size())
+                break;
+        }
+
+        if (level >= 0) {
+            const Bucket &bucket = m_levels.at(level).at(static_cast<int>(index / bucketSize - m_levelBase.at(level)));
+            merge(bucket.first, bucket.last, bucket.min, bucket.max);
+            index += bucketSize;
+        } else {
+            const int i = static_cast<int>(index - m_base);
+            merge(times[i], times[i], values[i], values[i]);
+            index++;
+        }
+    }
+
+    if (lower > 0)
+        return;
+
+    // Older than the raw samples: walk back from the first of them through
+    // the buckets, moving to a coarser level where a finer one was trimmed.
+    // A bucket may overlap one merged already, which min/max doesn't mind,
+    // but one reaching outside the window is left out.
+    qint64 edge = m_base;           // samples from here on are merged
+    qint64 bucketSize = topSize < FanOut ? FanOut : topSize;
+    for (int level = qMax(top, 0); level < m_levels.size(); level++, bucketSize *= FanOut) {
+        const QVector<Bucket> &buckets = m_levels.at(level);
+        int b = static_cast<int>(qMin<qint64>((edge + bucketSize - 1) / bucketSize - m_levelBase.at(level),
+                                              buckets.size())) - 1;
+        for (; b >= 0; b--) {
+            const Bucket &bucket = buckets.at(b);
+            if (bucket.first < from)
+                return;
+            if (bucket.last < to)
+                merge(bucket.first, bucket.last, bucket.min, bucket.max);
+        }
+        edge = qMin(edge, m_levelBase.at(level) * bucketSize);
+    }
+}
+
+SignalPlot::SignalPlot(QWidget *parent) :
+    QWidget(parent),
+    m_refreshTimer(new QTimer(this))
+{
+    setMinimumSize(200, 100);
+
+    // Samples only mark the plot dirty; repainting is paced by the timer.
+    connect(m_refreshTimer, &QTimer::timeout, [this]() {
+        if (m_dirty && isVisible()) {
+            m_dirty = false;
+            update();
+        }
+    });
+    m_refreshTimer->start(40);
+}
+
+void SignalPlot::setSeriesCount(int count)
+{
+    m_series.clear();
+    m_series.resize(count);
+    m_lastTimeUs = 0;
+    update();
+}
+
+void SignalPlot::setSeriesVisible(int series, bool visible)
+{
+    if (series < 0 || series >= m_series.size())
+        return;
+
+    m_series[series].visible = visible;
+    update();
+}
+
+void SignalPlot::addSample(int series, qint64 timeUs, double value)
+{
+    if (series < 0 || series >= m_series.size())
+        return;
+
+    m_series[series].samples.append(timeUs, static_cast<float>(value));
+    m_lastTimeUs = qMax(m_lastTimeUs, timeUs);
+    m_dirty = true;
+}
+
+void SignalPlot::clear()
+{
+    for (Series &s : m_series)
+        s.samples.clear();
+    m_lastTimeUs = 0;
+    update();
+}
+
+void SignalPlot::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+
+    const int w = width();
+    const int h = height();
+    const qint64 to = m_lastTimeUs + 1;
+    const qint64 from = to - m_spanUs;
+
+    int visibleCount = 0;
+    for (const Series &s : m_series) {
+        if (s.visible)
+            visibleCount++;
+    }
+    if (visibleCount == 0 || w <= 0)
+        return;
+
+    m_colMin.fill(std::numeric_limits<float>::infinity(), w * visibleCount);
+    m_colMax.fill(-std::numeric_limits<float>::infinity(), w * visibleCount);
+
+    int slot = 0;
+    for (const Series &s : m_series) {
+        if (!s.visible)
+            continue;
+        s.samples.query(from, to, w, m_colMin.data() + slot * w, m_colMax.data() + slot * w);
+        slot++;
+    }
+
+    float yMin = std::numeric_limits<float>::infinity();
+    float yMax = -std::numeric_limits<float>::infinity();
+    for (int i = 0; i < m_colMin.size(); i++) {
+        if (m_colMin.at(i) <= m_colMax.at(i)) {
+            yMin = qMin(yMin, m_colMin.at(i));
+            yMax = qMax(yMax, m_colMax.at(i));
+        }
+    }
+    if (yMin > yMax)
+        return;
+    if (yMin == yMax) {
+        yMin -= 1;
+        yMax += 1;
+    }
+
+    const float yScale = (h - 1) / (yMax - yMin);
+    auto toY = [&](float v) { return (h - 1) - (v - yMin) * yScale; };
+
+    slot = 0;
+    for (int i = 0; i < m_series.size(); i++) {
+        if (!m_series.at(i).visible)
+            continue;
+
+        const float *colMin = m_colMin.constData() + slot * w;
+        const float *colMax = m_colMax.constData() + slot * w;
+        slot++;
+
+        painter.setPen(QColor::fromHsvF(std::fmod(i * 0.618034, 1.0), 0.8, 1.0));
+        int prev = -1;
+        for (int x = 0; x < w; x++) {
+            if (colMin[x] > colMax[x])
+                continue;
+            painter.drawLine(QPointF(x, toY(colMax[x])), QPointF(x, toY(colMin[x])));
+            if (prev >= 0) {
+                painter.drawLine(QPointF(prev, toY((colMin[prev] + colMax[prev]) / 2)),
+                                 QPointF(x, toY((colMin[x] + colMax[x]) / 2)));
+            }
+            prev = x;
+        }
+    }
+
+    painter.setPen(Qt::gray);
+    painter.drawText(4, 14, QString::number(yMax, 'g', 6));
+    painter.drawText(4, h - 4, QString::number(yMin, 'g', 6));
+    painter.drawText(rect().adjusted(0, 0, -4, -4), Qt::AlignRight | Qt::AlignBottom,
+                     tr("%1 s").arg(m_spanUs / 1e6, 0, 'g', 4));
+}
+
+void SignalPlot::wheelEvent(QWheelEvent *event)
+{
+    if (event->angleDelta().y() > 0)
+        m_spanUs = qMax<qint64>(1000, m_spanUs * 4 / 5);
+    else
+        m_spanUs = qMin<qint64>(Q_INT64_C(86400000000), m_spanUs * 5 / 4);
+
+    update();
+    event->accept();
+}
+
+SignalPlotWindow::SignalPlotWindow(QWidget *parent) :
+    QWidget(parent, Qt::Window),
+    m_list(new QListWidget),
+    m_plot(new SignalPlot)
+{
+    setWindowTitle(tr("Signal Plot"));
+    resize(800, 400);
+
+    QSplitter *splitter = new QSplitter;
+    splitter->addWidget(m_list);
+    splitter->addWidget(m_plot);
+    splitter->setStretchFactor(1, 1);
+
+    QHBoxLayout *layout = new QHBoxLayout(this);
+    layout->addWidget(splitter);
+
+    connect(m_list, &QListWidget::itemChanged, this, &SignalPlotWindow::itemChanged);
+}
+
+void SignalPlotWindow::setSignalNames(const QStringList &names)
+{
+    m_list->clear();
+    m_plot->setSeriesCount(names.size());
+
+    for (const QString &name : names) {
+        QListWidgetItem *item = new QListWidgetItem(name, m_list);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Unchecked);
+    }
+}
+
+void SignalPlotWindow::itemChanged(QListWidgetItem *item)
+{
+    m_plot->setSeriesVisible(m_list->row(item), item->checkState() == Qt::Checked);
+}
@@ -0,0 +1,109 @@
+#ifndef SIGNALPLOT_H
+#define SIGNALPLOT_H
+
+#include <QVector>
+#include <QWidget>
+
+QT_BEGIN_NAMESPACE
+
+class QListWidget;
+class QListWidgetItem;
+class QTimer;
+
+QT_END_NAMESPACE
+
+// Multi-resolution min/max summary of one signal. Level i holds one bucket
+// per FanOut^(i+1) raw samples, so appending is amortized O(1) and a query
+// can pick the level whose buckets are about one pixel column wide. The
+// latest MaxSamples raw samples and the latest MaxBuckets buckets of each
+// level are kept, so fine detail covers the recent past while the coarse
+// levels reach back hours or days.
+class MinMaxPyramid
+{
+public:
+    enum {
+        FanOut = 8,
+        MaxSamples = 1 << 19,           // about 6 MB per signal
+        TrimSamples = MaxSamples / 4,
+        MaxBuckets = 1 << 15,           // 768 KB per level; level 3 spans 37 h at 1 kHz
+        TrimBuckets = MaxBuckets / 4
+    };
+
+    void append(qint64 time, float value);
+    void clear();
+
+    int size() const { return m_times.size(); }
+    qint64 firstTime() const { return m_times.isEmpty() ? 0 : m_times.first(); }
+    qint64 lastTime() const { return m_times.isEmpty() ? 0 : m_times.last(); }
+
+    // Merges the samples within [from, to) into one min/max pair per column.
+    // Columns must be prefilled with +inf/-inf; untouched ones stay that way.
+    void query(qint64 from, qint64 to, int columns, float *colMin, float *colMax) const;
+
+private:
+    struct Bucket {
+        qint64 first;
+        qint64 last;
+        float min;
+        float max;
+    };
+
+    QVector<qint64> m_times;
+    QVector<float> m_values;
+    QVector<QVector<Bucket>> m_levels;
+    QVector<qint64> m_levelBase;    // bucket number of m_levels[i].first()
+    QVector<Bucket> m_open;
+    QVector<int> m_openCount;
+    qint64 m_base = 0;              // sample number of m_times.first()
+};
+
+class SignalPlot : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SignalPlot(QWidget *parent = nullptr);
+
+    void setSeriesCount(int count);
+    void setSeriesVisible(int series, bool visible);
+    void addSample(int series, qint64 timeUs, double value);
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+
+private:
+    struct Series {
+        MinMaxPyramid samples;
+        bool visible = false;
+    };
+
+    QVector<Series> m_series;
+    QVector<float> m_colMin;
+    QVector<float> m_colMax;
+    qint64 m_spanUs = 10000000;
+    qint64 m_lastTimeUs = 0;
+    bool m_dirty = false;
+    QTimer *m_refreshTimer = nullptr;
+};
+
+class SignalPlotWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SignalPlotWindow(QWidget *parent = nullptr);
+
+    void setSignalNames(const QStringList &names);
+    SignalPlot *plot() const { return m_plot; }
+
+private slots:
+    void itemChanged(QListWidgetItem *item);
+
+private:
+    QListWidget *m_list = nullptr;
+    SignalPlot *m_plot = nullptr;
+};
+
+#endif // SIGNALPLOT_H
@@ -0,0 +1,241 @@
+#include "socketcanbridge.h"
+
+#include <QSocketNotifier>
+
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+enum {
+    SocketBatch = 64,           // frames per sendmmsg / recvmmsg call
+    MaxPendingFrames = 4096,    // oldest frames are dropped beyond this
+    PendingMask = MaxPendingFrames - 1
+};
+
+#ifdef Q_OS_LINUX
+static void toSocketFrame(const STR_CANMSG_T &in, struct can_frame *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (in.IdType == CAN_EXT_ID)
+        out->can_id = (in.Id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+    else
+        out->can_id = in.Id & CAN_SFF_MASK;
+    if (in.FrameType == CAN_REMOTE_FRAME)
+        out->can_id |= CAN_RTR_FLAG;
+    out->can_dlc = in.DLC > 8 ? 8 : in.DLC;
+    memcpy(out->data, in.Data, 8);
+}
+
+static void fromSocketFrame(const struct can_frame &in, STR_CANMSG_T *out)
+{
+    const bool extended = (in.can_id & CAN_EFF_FLAG) != 0;
+    out->IdType = extended ? CAN_EXT_ID : CAN_STD_ID;
+    out->FrameType = (in.can_id & CAN_RTR_FLAG) ? CAN_REMOTE_FRAME : CAN_DATA_FRAME;
+    out->Id = in.can_id & (extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+    out->DLC = in.can_dlc > 8 ? 8 : in.can_dlc;
+    memcpy(out->Data, in.data, 8);
+}
+#endif
+
+SocketCanBridge::SocketCanBridge(QObject *parent) :
+    QObject(parent)
+{
+}
+
+SocketCanBridge::~SocketCanBridge()
+{
+    close();
+}
+
+bool SocketCanBridge::isSupported()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SocketCanBridge::open(const QString &interfaceName, QString *errorString)
+{
+    close();
+
+#ifdef Q_OS_LINUX
+    const unsigned int index = if_nametoindex(interfaceName.toLocal8Bit().constData());
+    if (index == 0) {
+        if (errorString)
+            *errorString = tr("No CAN interface named %1").arg(interfaceName);
+        return false;
+    }
+
+    const int fd = ::socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+    if (fd < 0) {
+        if (errorString)
+            *errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = static_cast<int>(index);
+    if (::bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+        if (errorString)
+            *errorString = QString::fromLocal8Bit(strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_interfaceName = interfaceName;
+    m_pending.resize(MaxPendingFrames);
+    m_toSocket = 0;
+    m_fromSocket = 0;
+    m_dropped = 0;
+
+    m_readNotifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_readNotifier, &QSocketNotifier::activated, this, &SocketCanBridge::readFrames);
+
+    // Armed only while the socket pushes back with EAGAIN / ENOBUFS.
+    m_writeNotifier = new QSocketNotifier(m_fd, QSocketNotifier::Write, this);
+    m_writeNotifier->setEnabled(false);
+    connect(m_writeNotifier, &QSocketNotifier::activated, this, &SocketCanBridge::flush);
+    return true;
+#else
+    Q_UNUSED(interfaceName)
+    if (errorString)
+        *errorString = tr("SocketCAN is only available on Linux");
+    return false;
+#endif
+}
+
+void SocketCanBridge::close()
+{
+    // close() may run from a slot connected to frameReceived, i.e. inside
+    // the read notifier's activation.
+    if (m_readNotifier != nullptr) {
+        m_readNotifier->setEnabled(false);
+        m_readNotifier->deleteLater();
+        m_readNotifier = nullptr;
+    }
+    if (m_writeNotifier != nullptr) {
+        m_writeNotifier->setEnabled(false);
+        m_writeNotifier->deleteLater();
+        m_writeNotifier = nullptr;
+    }
+
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+    m_fd = -1;
+    m_pendingHead = 0;
+    m_pendingCount = 0;
+}
+
+void SocketCanBridge::writeFrame(const STR_CANMSG_T &frame)
+{
+    if (m_fd < 0)
+        return;
+
+    if (m_pendingCount == MaxPendingFrames) {
+        m_pendingHead = (m_pendingHead + 1) & PendingMask;
+        m_pendingCount--;
+        m_dropped++;
+    }
+    m_pending[(m_pendingHead + m_pendingCount) & PendingMask] = frame;
+    m_pendingCount++;
+
+    if (!m_flushQueued) {
+        m_flushQueued = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+}
+
+void SocketCanBridge::flush()
+{
+    m_flushQueued = false;
+
+#ifdef Q_OS_LINUX
+    if (m_fd < 0)
+        return;
+
+    struct can_frame frames[SocketBatch];
+    struct iovec iov[SocketBatch];
+    struct mmsghdr msgs[SocketBatch];
+
+    int sent = 0;
+    while (sent < m_pendingCount) {
+        const int n = qMin(static_cast<int>(SocketBatch), m_pendingCount - sent);
+        for (int i = 0; i < n; i++) {
+            toSocketFrame(m_pending.at((m_pendingHead + sent + i) & PendingMask), &frames[i]);
+            iov[i].iov_base = &frames[i];
+            iov[i].iov_len = sizeof(struct can_frame);
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        const int done = ::sendmmsg(m_fd, msgs, static_cast<unsigned int>(n), MSG_DONTWAIT);
+        if (done <= 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+                qWarning("SocketCAN: send failed: %s", strerror(errno));
+                m_dropped += m_pendingCount - sent;
+                sent = m_pendingCount;
+            }
+            break;
+        }
+        sent += done;
+        m_toSocket += done;
+    }
+
+    m_pendingHead = (m_pendingHead + sent) & PendingMask;
+    m_pendingCount -= sent;
+    if (m_writeNotifier != nullptr)
+        m_writeNotifier->setEnabled(m_pendingCount > 0);
+#endif
+}
+
+void SocketCanBridge::readFrames()
+{
+#ifdef Q_OS_LINUX
+    struct can_frame frames[SocketBatch];
+    struct iovec iov[SocketBatch];
+    struct mmsghdr msgs[SocketBatch];
+
+    for (;;) {
+        for (int i = 0; i < SocketBatch; i++) {
+            iov[i].iov_base = &frames[i];
+            iov[i].iov_len = sizeof(struct can_frame);
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        const int n = ::recvmmsg(m_fd, msgs, SocketBatch, MSG_DONTWAIT, nullptr);
+        if (n <= 0)
+            break;
+
+        for (int i = 0; i < n; i++) {
+            // CAN FD and error frames have no STR_CANMSG_T equivalent.
+            if (msgs[i].msg_len != sizeof(struct can_frame) || (frames[i].can_id & CAN_ERR_FLAG))
+                continue;
+
+            STR_CANMSG_T frame;
+            fromSocketFrame(frames[i], &frame);
+            m_fromSocket++;
+            emit frameReceived(frame);
+        }
+
+        if (n < SocketBatch)
+            break;
+    }
+#endif
+}
@@ -0,0 +1,65 @@
+#ifndef SOCKETCANBRIDGE_H
+#define SOCKETCANBRIDGE_H
+
+#include <QObject>
+#include <QVector>
+
+#include "nuvbridge.h"
+
+QT_BEGIN_NAMESPACE
+
+class QSocketNotifier;
+
+QT_END_NAMESPACE
+
+// Connects the bridge to a Linux SocketCAN interface such as vcan0, so
+// candump, cansend and python-can see the same bus. Frames from the bridge
+// are collected per event loop pass and sent with one sendmmsg(); frames
+// from the socket are drained with recvmmsg(). Other platforms report the
+// mode as unsupported.
+class SocketCanBridge : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SocketCanBridge(QObject *parent = nullptr);
+    ~SocketCanBridge();
+
+    static bool isSupported();
+
+    bool open(const QString &interfaceName, QString *errorString = nullptr);
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+    QString interfaceName() const { return m_interfaceName; }
+
+    // Queues a frame received from the bridge for the socket.
+    void writeFrame(const STR_CANMSG_T &frame);
+
+    qint64 framesToSocket() const { return m_toSocket; }
+    qint64 framesFromSocket() const { return m_fromSocket; }
+    qint64 framesDropped() const { return m_dropped; }
+
+public slots:
+    void flush();
+
+signals:
+    void frameReceived(const STR_CANMSG_T &frame);
+
+private slots:
+    void readFrames();
+
+private:
+    int m_fd = -1;
+    QString m_interfaceName;
+    QSocketNotifier *m_readNotifier = nullptr;
+    QSocketNotifier *m_writeNotifier = nullptr;
+    QVector<STR_CANMSG_T> m_pending;    // ring, allocated by open()
+    int m_pendingHead = 0;
+    int m_pendingCount = 0;
+    bool m_flushQueued = false;
+    qint64 m_toSocket = 0;
+    qint64 m_fromSocket = 0;
+    qint64 m_dropped = 0;
+};
+
+#endif // SOCKETCANBRIDGE_H
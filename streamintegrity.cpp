@@ -0,0 +1,124 @@
+#include "streamintegrity.h"
+
+#include <QObject>
+
+enum {
+    DefaultStallUs = 100000,
+    DefaultStallBacklog = 4096      // a common tty flip buffer size
+};
+
+StreamIntegrity::StreamIntegrity() :
+    m_stallUs(DefaultStallUs),
+    m_stallBacklog(DefaultStallBacklog)
+{
+    resetStats();
+}
+
+void StreamIntegrity::reset()
+{
+    // An episode cut short by the reset is still reported.
+    if (m_lost)
+        resynced();
+    m_pending = 0;
+    m_lastReadUs = -1;
+}
+
+void StreamIntegrity::resetStats()
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void StreamIntegrity::setStallThreshold(qint64 us, qint64 backlogBytes)
+{
+    m_stallUs = us;
+    m_stallBacklog = backlogBytes;
+}
+
+bool StreamIntegrity::isValid(const STR_CANMSG_T &msg, Kind *fault)
+{
+    Kind kind;
+    if (msg.IdType != CAN_STD_ID && msg.IdType != CAN_EXT_ID)
+        kind = BadIdType;
+    else if (msg.FrameType != CAN_DATA_FRAME && msg.FrameType != CAN_REMOTE_FRAME)
+        kind = BadFrameType;
+    else if (msg.DLC > 8)
+        kind = BadDlc;
+    else if (msg.Id > (msg.IdType == CAN_EXT_ID ? 0x1FFFFFFFu : 0x7FFu))
+        kind = BadId;
+    else
+        return true;
+
+    if (fault)
+        *fault = kind;
+    return false;
+}
+
+QString StreamIntegrity::describe(const Event &event)
+{
+    static const char *const reasons[] = {
+        "invalid IdType", "invalid FrameType", "DLC above 8", "ID out of range"
+    };
+
+    if (event.kind == HostStall) {
+        return QObject::tr("Integrity: host stall of %1 ms, then %2 bytes in one read at offset %3")
+                .arg(event.stallUs / 1000).arg(event.bytes).arg(event.offset);
+    }
+    return QObject::tr("Integrity: %1 at offset %2, resynchronised after %3 bytes")
+            .arg(reasons[event.kind]).arg(event.offset).arg(event.bytes);
+}
+
+void StreamIntegrity::checkRead(int size, qint64 timeUs)
+{
+    // Reads of one backlog follow each other within microseconds, so only
+    // the first read after a pause can trip this.
+    if (m_lastReadUs >= 0) {
+        const qint64 stallUs = timeUs - m_lastReadUs;
+        if (stallUs > m_stallUs && size >= m_stallBacklog) {
+            m_events.append({ HostStall, timeUs, m_stats.bytes, size, stallUs });
+            m_stats.events[HostStall]++;
+            m_stats.longestStallUs = qMax(m_stats.longestStallUs, stallUs);
+        }
+    }
+    m_lastReadUs = timeUs;
+    m_stats.bytes += size;
+}
+
+StreamIntegrity::CanState StreamIntegrity::canState() const
+{
+    CanState state;
+    memset(&state, 0, sizeof(state));
+    state.pending = m_pending;
+    state.lostKind = m_lost ? m_lostEvent.kind : -1;
+    memcpy(state.bytes, m_join, m_pending);
+    return state;
+}
+
+void StreamIntegrity::setCanState(const CanState &state)
+{
+    m_pending = qBound(0, int(state.pending), int(sizeof(state.bytes)));
+    memcpy(m_join, state.bytes, m_pending);
+    m_lost = state.lostKind >= 0 && state.lostKind < HostStall;
+    if (m_lost)
+        m_lostEvent = { Kind(state.lostKind), 0, m_consumed, 0, 0 };
+}
+
+QVector<StreamIntegrity::Event> StreamIntegrity::takeEvents()
+{
+    QVector<Event> events;
+    events.swap(m_events);
+    return events;
+}
+
+void StreamIntegrity::lost(Kind fault, qint64 timeUs)
+{
+    m_lost = true;
+    m_lostEvent = { fault, timeUs, m_consumed, 0, 0 };
+    m_stats.events[fault]++;
+}
+
+void StreamIntegrity::resynced()
+{
+    m_lost = false;
+    m_stats.skippedBytes += m_lostEvent.bytes;
+    m_events.append(m_lostEvent);
+}
@@ -0,0 +1,164 @@
+#ifndef STREAMINTEGRITY_H
+#define STREAMINTEGRITY_H
+
+#include <QString>
+#include <QVector>
+
+#include <cstring>
+
+#include "bridgecodec.h"
+
+// Receive-side integrity checks. In CAN mode every record must be a sane
+// STR_CANMSG_T: known IdType and FrameType, DLC up to 8 and an ID within
+// range for its type. A record that fails means bytes were lost or
+// corrupted; the checker then slides forward a byte at a time until a valid
+// record (and the one after it, when already received) lines up again, and
+// reports the episode once, with the number of bytes skipped.
+//
+// In every mode, a pause between reads longer than the stall threshold
+// that ends in a read at least the size of a typical driver buffer is
+// reported as a host stall: the application did not drain the port in
+// time and the driver may have dropped bytes.
+class StreamIntegrity
+{
+public:
+    enum Kind {
+        BadIdType,
+        BadFrameType,
+        BadDlc,
+        BadId,
+        HostStall,
+        KindCount
+    };
+
+    struct Event {
+        Kind kind;
+        qint64 timeUs;      // when it was detected
+        qint64 offset;      // stream offset of the first bad byte, or of the read
+        qint64 bytes;       // bytes skipped, or the size of the read after a stall
+        qint64 stallUs;     // pause before the read, for a stall
+    };
+
+    // Where feedCan() stands between two reads: the start of a record not
+    // complete yet, and whether it is resyncing. Restoring it resumes a
+    // stream exactly, provided the reads that follow are the same.
+    struct CanState {
+        qint32 pending;
+        qint32 lostKind;    // -1 unless resyncing
+        char bytes[BridgeCodec::CanMessageSize - 1];
+    };
+
+    struct Stats {
+        qint64 bytes;
+        qint64 frames;
+        qint64 events[KindCount];
+        qint64 skippedBytes;
+        qint64 longestStallUs;
+    };
+
+    StreamIntegrity();
+
+    // Forgets any partial record and the resync state, as after a session
+    // start or a link gap; counters are kept.
+    void reset();
+    void resetStats();
+
+    void setStallThreshold(qint64 us, qint64 backlogBytes);
+
+    static bool isValid(const STR_CANMSG_T &msg, Kind *fault = nullptr);
+    static QString describe(const Event &event);
+
+    // Call for every read from the port, in any mode.
+    void checkRead(int size, qint64 timeUs);
+
+    // Splits received CAN bytes into records like CanFrameParser, skipping
+    // over anything that does not validate.
+    template<typename Handler>
+    void feedCan(const char *data, int size, qint64 timeUs, Handler onFrame)
+    {
+        if (m_pending > 0) {
+            const int take = qMin(size, int(JoinSize) - m_pending);
+            memcpy(m_join + m_pending, data, take);
+            const int joined = m_pending + take;
+            const int used = scan(m_join, joined, timeUs, onFrame);
+            if (used < m_pending) {
+                // Only when this read was too short to finish the join.
+                m_pending = joined - used;
+                memmove(m_join, m_join + used, m_pending);
+                return;
+            }
+            data += used - m_pending;
+            size -= used - m_pending;
+            m_pending = 0;
+        }
+
+        const int used = scan(data, size, timeUs, onFrame);
+        m_pending = size - used;
+        memcpy(m_join, data + used, m_pending);
+    }
+
+    CanState canState() const;
+    void setCanState(const CanState &state);
+
+    bool hasEvents() const { return !m_events.isEmpty(); }
+    QVector<Event> takeEvents();
+    Stats stats() const { return m_stats; }
+
+private:
+    enum {
+        Size = BridgeCodec::CanMessageSize,
+        JoinSize = 2 * Size - 1     // a kept tail plus one full record
+    };
+
+    template<typename Handler>
+    int scan(const char *data, int size, qint64 timeUs, Handler onFrame)
+    {
+        int pos = 0;
+        while (size - pos >= Size) {
+            STR_CANMSG_T frame;
+            BridgeCodec::decodeCanMessage(data + pos, Size, &frame);
+
+            Kind fault;
+            bool valid = isValid(frame, &fault);
+            if (valid && m_lost && size - pos >= 2 * Size) {
+                STR_CANMSG_T next;
+                BridgeCodec::decodeCanMessage(data + pos + Size, Size, &next);
+                valid = isValid(next);
+            }
+
+            if (valid) {
+                if (m_lost)
+                    resynced();
+                m_stats.frames++;
+                m_consumed += Size;
+                pos += Size;
+                onFrame(frame);
+            } else {
+                if (!m_lost)
+                    lost(fault, timeUs);
+                m_lostEvent.bytes++;
+                m_consumed++;
+                pos++;
+            }
+        }
+        return pos;
+    }
+
+    void lost(Kind fault, qint64 timeUs);
+    void resynced();
+
+    char m_join[JoinSize];
+    int m_pending = 0;
+    qint64 m_consumed = 0;
+    bool m_lost = false;
+    Event m_lostEvent;
+
+    qint64 m_stallUs;
+    qint64 m_stallBacklog;
+    qint64 m_lastReadUs = -1;
+
+    QVector<Event> m_events;
+    Stats m_stats;
+};
+
+#endif // STREAMINTEGRITY_H
@@ -0,0 +1,277 @@
+#include "streamserver.h"
+
+#include <QDateTime>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtEndian>
+
+#include <cstring>
+
+enum {
+    SocketBufferLimit = 64 * 1024,  // bytes handed to one socket at a time
+    MaxClientRecord = 64 * 1024,    // larger client records are a protocol error
+    ProbeTimeout = 200              // ms to wait for an existing local server
+};
+
+StreamServer::StreamServer(QObject *parent) :
+    QObject(parent),
+    m_tcp(new QTcpServer(this)),
+    m_local(new QLocalServer(this))
+{
+    m_baseUs = QDateTime::currentMSecsSinceEpoch() * 1000;
+    m_clock.start();
+
+    connect(m_tcp, &QTcpServer::newConnection, [this]() {
+        while (QTcpSocket *socket = m_tcp->nextPendingConnection()) {
+            socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                for (Client *client : qAsConst(m_clients)) {
+                    if (client->socket == socket) {
+                        removeClient(client);
+                        break;
+                    }
+                }
+            });
+            addClient(socket);
+        }
+    });
+    connect(m_local, &QLocalServer::newConnection, [this]() {
+        while (QLocalSocket *socket = m_local->nextPendingConnection()) {
+            connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+                for (Client *client : qAsConst(m_clients)) {
+                    if (client->socket == socket) {
+                        removeClient(client);
+                        break;
+                    }
+                }
+            });
+            addClient(socket);
+        }
+    });
+}
+
+static bool isServing(const QString &localName)
+{
+    QLocalSocket probe;
+    probe.connectToServer(localName);
+    return probe.waitForConnected(ProbeTimeout);
+}
+
+StreamServer::~StreamServer()
+{
+    close();
+}
+
+bool StreamServer::listen(quint16 tcpPort, const QString &localName, QString *errorString)
+{
+    close();
+
+    // Local host only; the stream is meant for tools on the same machine.
+    if (!m_tcp->listen(QHostAddress::LocalHost, tcpPort)) {
+        if (errorString)
+            *errorString = m_tcp->errorString();
+        return false;
+    }
+
+    if (!localName.isEmpty()) {
+        bool listening = m_local->listen(localName);
+        // A socket file left behind by a crashed instance blocks the name.
+        // Take it over only if nobody answers on it.
+        if (!listening && m_local->serverError() == QAbstractSocket::AddressInUseError
+                && !isServing(localName)) {
+            QLocalServer::removeServer(localName);
+            listening = m_local->listen(localName);
+        }
+        if (!listening) {
+            if (errorString)
+                *errorString = m_local->errorString();
+            m_tcp->close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void StreamServer::close()
+{
+    m_tcp->close();
+    m_local->close();
+
+    while (!m_clients.isEmpty())
+        removeClient(m_clients.first());
+    m_batch.clear();
+}
+
+bool StreamServer::isListening() const
+{
+    return m_tcp->isListening();
+}
+
+void StreamServer::setSession(const QByteArray &payload)
+{
+    m_session = payload;
+    if (!m_clients.isEmpty())
+        publish(CaptureSession, payload.constData(), payload.size());
+}
+
+void StreamServer::appendRecord(QByteArray &out, CaptureRecordType type, const char *data, int size) const
+{
+    uchar header[CaptureRecordHeaderSize];
+    qToLittleEndian<quint64>(m_baseUs + m_clock.nsecsElapsed() / 1000, header);
+    qToLittleEndian<quint16>(type, header + 8);
+    qToLittleEndian<quint16>(0, header + 10);
+    qToLittleEndian<quint32>(size, header + 12);
+
+    out.append(reinterpret_cast<const char *>(header), sizeof(header));
+    if (size > 0)
+        out.append(data, size);
+}
+
+void StreamServer::publish(CaptureRecordType type, const char *data, int size)
+{
+    if (m_clients.isEmpty())
+        return;
+
+    appendRecord(m_batch, type, data, size);
+
+    if (!m_flushQueued) {
+        m_flushQueued = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+}
+
+void StreamServer::flush()
+{
+    m_flushQueued = false;
+    if (m_batch.isEmpty())
+        return;
+
+    // Seal the batch; clients share it and nobody writes to it again.
+    const QByteArray batch = m_batch;
+    m_batch = QByteArray();
+    m_batch.reserve(batch.size());
+
+    const QList<Client *> clients = m_clients;
+    for (Client *client : clients)
+        enqueue(client, batch);
+}
+
+void StreamServer::enqueue(Client *client, const QByteArray &batch)
+{
+    const qint64 backlog = client->queued + client->socket->bytesToWrite();
+    if (backlog > m_backlogLimit) {
+        if (m_policy == DropClient) {
+            qWarning("Stream: dropping client with %lld bytes backlog", backlog);
+            removeClient(client);
+            return;
+        }
+        client->skipped++;
+        return;
+    }
+
+    if (client->skipped > 0 && backlog < m_backlogLimit / 2) {
+        QByteArray marker;
+        const QByteArray text = QString("skipped %1 batches").arg(client->skipped).toUtf8();
+        appendRecord(marker, CaptureMarker, text.constData(), text.size());
+        client->batches.enqueue(marker);
+        client->queued += marker.size();
+        client->skipped = 0;
+    } else if (client->skipped > 0) {
+        client->skipped++;
+        return;
+    }
+
+    client->batches.enqueue(batch);
+    client->queued += batch.size();
+    writeClient(client);
+}
+
+void StreamServer::writeClient(Client *client)
+{
+    QIODevice *socket = client->socket;
+    while (!client->batches.isEmpty() && socket->bytesToWrite() < SocketBufferLimit) {
+        const QByteArray &batch = client->batches.head();
+        const int n = qMin(batch.size() - client->offset,
+                           static_cast<int>(SocketBufferLimit - socket->bytesToWrite()));
+        const qint64 written = socket->write(batch.constData() + client->offset, n);
+        if (written <= 0)
+            break;
+
+        client->offset += static_cast<int>(written);
+        client->queued -= written;
+        if (client->offset == batch.size()) {
+            client->batches.dequeue();
+            client->offset = 0;
+        }
+    }
+}
+
+void StreamServer::readClient(Client *client)
+{
+    client->inbox.append(client->socket->readAll());
+
+    int pos = 0;
+    while (client->inbox.size() - pos >= CaptureRecordHeaderSize) {
+        const char *header = client->inbox.constData() + pos;
+        const quint16 type = qFromLittleEndian<quint16>(header + 8);
+        const quint32 size = qFromLittleEndian<quint32>(header + 12);
+        if (size > MaxClientRecord) {
+            qWarning("Stream: client sent a %u byte record, disconnecting", size);
+            removeClient(client);
+            return;
+        }
+        if (client->inbox.size() - pos < CaptureRecordHeaderSize + static_cast<int>(size))
+            break;
+
+        if (type == CaptureTx && m_clientTransmit) {
+            emit frameReceived(client->inbox.mid(pos + CaptureRecordHeaderSize, size));
+        } else if (type == CaptureTx && client->refused++ == 0) {
+            qWarning("Stream: client transmit is disabled, dropping its frames");
+        }
+        pos += CaptureRecordHeaderSize + size;
+    }
+    client->inbox.remove(0, pos);
+}
+
+void StreamServer::addClient(QIODevice *socket)
+{
+    Client *client = new Client;
+    client->socket = socket;
+    client->offset = 0;
+    client->queued = 0;
+    client->skipped = 0;
+    client->refused = 0;
+    m_clients.append(client);
+
+    connect(socket, &QIODevice::bytesWritten, this, [this, client]() {
+        writeClient(client);
+    });
+    connect(socket, &QIODevice::readyRead, this, [this, client]() {
+        readClient(client);
+    });
+
+    QByteArray hello(CaptureFileHeaderSize, 0);
+    memcpy(hello.data(), "NUCP", 4);
+    qToLittleEndian<quint32>(CaptureVersion, hello.data() + 4);
+    if (!m_session.isEmpty())
+        appendRecord(hello, CaptureSession, m_session.constData(), m_session.size());
+    enqueue(client, hello);
+
+    emit clientCountChanged(m_clients.size());
+}
+
+void StreamServer::removeClient(Client *client)
+{
+    if (!m_clients.removeOne(client))
+        return;
+
+    client->socket->disconnect(this);
+    client->socket->close();
+    client->socket->deleteLater();
+    delete client;
+
+    emit clientCountChanged(m_clients.size());
+}
@@ -0,0 +1,96 @@
+#ifndef STREAMSERVER_H
+#define STREAMSERVER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QQueue>
+
+#include "capturefile.h"
+
+QT_BEGIN_NAMESPACE
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+
+QT_END_NAMESPACE
+
+// Publishes live bridge traffic to local clients over TCP and a local
+// socket. The stream uses the capture file layout: a "NUCP" header, then
+// records, so a client can save it verbatim as a .nucap file.
+//
+// Records published during one event loop pass are sealed into a batch that
+// every client queues by reference. A client whose backlog grows past
+// backlogLimit() is either disconnected or skips batches until it catches up,
+// so it never stalls capture. Clients may send CaptureTx records to
+// transmit; they are dropped unless client transmit is enabled, since any
+// local process can connect.
+class StreamServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum SlowClientPolicy {
+        DropClient,
+        SampleClient        // skip batches, then report the gap with a marker
+    };
+
+    explicit StreamServer(QObject *parent = nullptr);
+    ~StreamServer();
+
+    bool listen(quint16 tcpPort, const QString &localName, QString *errorString = nullptr);
+    void close();
+    bool isListening() const;
+    int clientCount() const { return m_clients.size(); }
+
+    SlowClientPolicy slowClientPolicy() const { return m_policy; }
+    void setSlowClientPolicy(SlowClientPolicy policy) { m_policy = policy; }
+    qint64 backlogLimit() const { return m_backlogLimit; }
+    void setBacklogLimit(qint64 bytes) { m_backlogLimit = bytes; }
+    bool clientTransmit() const { return m_clientTransmit; }
+    void setClientTransmit(bool enable) { m_clientTransmit = enable; }
+
+    // Sent to every client when it connects, and to the current ones.
+    void setSession(const QByteArray &payload);
+    void publish(CaptureRecordType type, const char *data, int size);
+
+public slots:
+    void flush();
+
+signals:
+    void frameReceived(const QByteArray &frame);
+    void clientCountChanged(int count);
+
+private:
+    struct Client {
+        QIODevice *socket;
+        QQueue<QByteArray> batches;
+        int offset;             // into batches.head()
+        qint64 queued;          // bytes in batches not yet written
+        qint64 skipped;         // batches skipped while backlogged
+        qint64 refused;         // CaptureTx records dropped
+        QByteArray inbox;
+    };
+
+    void addClient(QIODevice *socket);
+    void removeClient(Client *client);
+    void enqueue(Client *client, const QByteArray &batch);
+    void writeClient(Client *client);
+    void readClient(Client *client);
+    void appendRecord(QByteArray &out, CaptureRecordType type, const char *data, int size) const;
+
+    QTcpServer *m_tcp = nullptr;
+    QLocalServer *m_local = nullptr;
+    QList<Client *> m_clients;
+    QByteArray m_batch;
+    QByteArray m_session;
+    bool m_flushQueued = false;
+    SlowClientPolicy m_policy = SampleClient;
+    qint64 m_backlogLimit = 4 * 1024 * 1024;
+    bool m_clientTransmit = false;
+    qint64 m_baseUs = 0;
+    QElapsedTimer m_clock;
+};
+
+#endif // STREAMSERVER_H
@@ -0,0 +1,20 @@
+# Round-trip tests and encode/decode benchmarks for bridgecodec.h:
+#   qmake && make && ./tst_bridgecodec
+# Run the benchmarks alone with ./tst_bridgecodec -functions and pick the
+# bench* slots, e.g. ./tst_bridgecodec benchEncodeCanData -iterations 1000000
+
+QT = core testlib
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_bridgecodec
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += tst_bridgecodec.cpp
+
+HEADERS += \
+    ../../nuvbridge.h \
+    ../../bridgecodec.h
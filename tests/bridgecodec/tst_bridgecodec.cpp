@@ -0,0 +1,256 @@
+#include <QtTest>
+
+#include <cstring>
+
+#include "bridgecodec.h"
+
+using namespace BridgeCodec;
+
+// The static_asserts in bridgecodec.h pin a few fixed vectors at compile
+// time; these cases cover the value ranges and the size checks at run time.
+class TestBridgeCodec : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void canConfigRoundTrip();
+    void canMessageRoundTrip_data();
+    void canMessageRoundTrip();
+    void canDataRejectsBadInput();
+    void wrapCanData();
+    void i2cReadRoundTrip_data();
+    void i2cReadRoundTrip();
+    void i2cWrite();
+
+    void benchEncodeCanData();
+    void benchDecodeCanData();
+    void benchWrapCanData();
+    void benchEncodeI2cRead();
+
+private:
+    static STR_CANMSG_T sampleMessage();
+};
+
+STR_CANMSG_T TestBridgeCodec::sampleMessage()
+{
+    STR_CANMSG_T msg = {};
+    msg.IdType = CAN_EXT_ID;
+    msg.FrameType = CAN_DATA_FRAME;
+    msg.Id = 0x18DAF110;
+    msg.DLC = 8;
+    for (int i = 0; i < 8; i++)
+        msg.Data[i] = static_cast<char>(0xA0 + i);
+    return msg;
+}
+
+void TestBridgeCodec::canConfigRoundTrip()
+{
+    const quint32 rates[] = { 10000, 125000, 500000, 1000000, 0xFFFFFFFF };
+    for (quint32 rate : rates) {
+        for (int silent = 0; silent < 2; silent++) {
+            const CanConfig config = { rate, silent != 0, { 0x7FF, 0x1FFFFFFF, 0, rate } };
+            char buf[CanConfigSize];
+            QCOMPARE(encodeCanConfig(config, buf, sizeof(buf)), int(CanConfigSize));
+
+            CanConfig back = {};
+            QVERIFY(decodeCanConfig(buf, sizeof(buf), &back));
+            QCOMPARE(back.baudRate, config.baudRate);
+            QCOMPARE(back.silent, config.silent);
+            for (int i = 0; i < 4; i++)
+                QCOMPARE(back.canId[i], config.canId[i]);
+        }
+    }
+
+    char buf[CanConfigSize];
+    const CanConfig config = { 500000, false, { 0, 0, 0, 0 } };
+    QCOMPARE(encodeCanConfig(config, buf, CanConfigSize - 1), 0);
+    QCOMPARE(encodeCanConfig(config, buf, sizeof(buf)), int(CanConfigSize));
+    buf[3] = 'D';
+    CanConfig back = {};
+    QVERIFY(!decodeCanConfig(buf, sizeof(buf), &back));
+}
+
+void TestBridgeCodec::canMessageRoundTrip_data()
+{
+    QTest::addColumn<quint32>("idType");
+    QTest::addColumn<quint32>("frameType");
+    QTest::addColumn<quint32>("id");
+    QTest::addColumn<int>("dlc");
+
+    QTest::newRow("standard") << quint32(CAN_STD_ID) << quint32(CAN_DATA_FRAME) << quint32(0x123) << 8;
+    QTest::newRow("standard max") << quint32(CAN_STD_ID) << quint32(CAN_DATA_FRAME) << quint32(0x7FF) << 1;
+    QTest::newRow("extended") << quint32(CAN_EXT_ID) << quint32(CAN_DATA_FRAME) << quint32(0x18DAF110) << 8;
+    QTest::newRow("extended max") << quint32(CAN_EXT_ID) << quint32(CAN_DATA_FRAME) << quint32(0x1FFFFFFF) << 0;
+    QTest::newRow("remote") << quint32(CAN_STD_ID) << quint32(CAN_REMOTE_FRAME) << quint32(0x100) << 4;
+    QTest::newRow("high bits") << quint32(0x80000001) << quint32(0xFFFFFFFF) << quint32(0xFFFFFFFF) << 255;
+}
+
+void TestBridgeCodec::canMessageRoundTrip()
+{
+    QFETCH(quint32, idType);
+    QFETCH(quint32, frameType);
+    QFETCH(quint32, id);
+    QFETCH(int, dlc);
+
+    STR_CANMSG_T msg = {};
+    msg.IdType = idType;
+    msg.FrameType = frameType;
+    msg.Id = id;
+    msg.DLC = static_cast<unsigned char>(dlc);
+    for (int i = 0; i < 8; i++)
+        msg.Data[i] = static_cast<char>(0xF8 + i * 37);
+
+    // The wire layout is the packed struct, whatever the host byte order.
+    char message[CanMessageSize];
+    QCOMPARE(encodeCanMessage(msg, message, sizeof(message)), int(CanMessageSize));
+    QCOMPARE(static_cast<unsigned char>(message[8]), static_cast<unsigned char>(id & 0xFF));
+    QCOMPARE(static_cast<unsigned char>(message[11]), static_cast<unsigned char>(id >> 24));
+    QCOMPARE(static_cast<unsigned char>(message[12]), static_cast<unsigned char>(dlc));
+
+    char data[CanDataSize];
+    QCOMPARE(encodeCanData(msg, data, sizeof(data)), int(CanDataSize));
+    QCOMPARE(QByteArray(data, CanDataHeaderSize), QByteArray("CAND"));
+    QVERIFY(memcmp(data + CanDataHeaderSize, message, CanMessageSize) == 0);
+
+    STR_CANMSG_T back = {};
+    QVERIFY(decodeCanData(data, sizeof(data), &back));
+    QCOMPARE(quint32(back.IdType), idType);
+    QCOMPARE(quint32(back.FrameType), frameType);
+    QCOMPARE(quint32(back.Id), id);
+    QCOMPARE(int(back.DLC), dlc);
+    QVERIFY(memcmp(back.Data, msg.Data, sizeof(msg.Data)) == 0);
+}
+
+void TestBridgeCodec::canDataRejectsBadInput()
+{
+    const STR_CANMSG_T msg = sampleMessage();
+    char data[CanDataSize];
+    QCOMPARE(encodeCanData(msg, data, CanDataSize - 1), 0);
+    QCOMPARE(encodeCanMessage(msg, data, CanMessageSize - 1), 0);
+    QCOMPARE(encodeCanData(msg, data, sizeof(data)), int(CanDataSize));
+
+    STR_CANMSG_T back = {};
+    QVERIFY(!decodeCanData(data, CanDataSize - 1, &back));
+    QVERIFY(!decodeCanMessage(data + CanDataHeaderSize, CanMessageSize - 1, &back));
+    data[0] = 'X';
+    QVERIFY(!decodeCanData(data, sizeof(data), &back));
+}
+
+void TestBridgeCodec::wrapCanData()
+{
+    const STR_CANMSG_T msg = sampleMessage();
+    char message[CanMessageSize + 1] = {};
+    QCOMPARE(encodeCanMessage(msg, message, CanMessageSize), int(CanMessageSize));
+
+    char data[CanDataSize];
+    char expected[CanDataSize];
+    QCOMPARE(BridgeCodec::wrapCanData(message, CanMessageSize, data, sizeof(data)), int(CanDataSize));
+    QCOMPARE(encodeCanData(msg, expected, sizeof(expected)), int(CanDataSize));
+    QVERIFY(memcmp(data, expected, CanDataSize) == 0);
+
+    // Anything but a whole record is refused rather than padded or cut.
+    QCOMPARE(BridgeCodec::wrapCanData(message, CanMessageSize - 1, data, sizeof(data)), 0);
+    QCOMPARE(BridgeCodec::wrapCanData(message, CanMessageSize + 1, data, sizeof(data)), 0);
+    QCOMPARE(BridgeCodec::wrapCanData(message, 0, data, sizeof(data)), 0);
+    QCOMPARE(BridgeCodec::wrapCanData(message, CanMessageSize, data, CanDataSize - 1), 0);
+}
+
+void TestBridgeCodec::i2cReadRoundTrip_data()
+{
+    QTest::addColumn<int>("address");
+    QTest::addColumn<int>("length");
+
+    QTest::newRow("one byte") << 0x50 << 1;
+    QTest::newRow("page") << 0x50 << 0x100;
+    QTest::newRow("top address") << 0x7F << 2;
+    QTest::newRow("longest") << 0x00 << int(I2cMaxReadSize);
+}
+
+void TestBridgeCodec::i2cReadRoundTrip()
+{
+    QFETCH(int, address);
+    QFETCH(int, length);
+
+    char buf[I2cReadSize];
+    QCOMPARE(encodeI2cRead(static_cast<quint8>(address), length, buf, sizeof(buf)), int(I2cReadSize));
+
+    quint8 backAddress = 0;
+    int backLength = 0;
+    QVERIFY(decodeI2cRead(buf, sizeof(buf), &backAddress, &backLength));
+    QCOMPARE(int(backAddress), address);
+    QCOMPARE(backLength, length);
+
+    QCOMPARE(encodeI2cRead(static_cast<quint8>(address), length, buf, I2cReadSize - 1), 0);
+    QCOMPARE(encodeI2cRead(static_cast<quint8>(address), 0, buf, sizeof(buf)), 0);
+    QCOMPARE(encodeI2cRead(static_cast<quint8>(address), I2cMaxReadSize + 1, buf, sizeof(buf)), 0);
+}
+
+void TestBridgeCodec::i2cWrite()
+{
+    const char payload[] = { 0x00, 0x10, 0x55, char(0xAA) };
+    char buf[i2cWriteSize(sizeof(payload))];
+    QCOMPARE(encodeI2cWrite(0x50, payload, sizeof(payload), buf, sizeof(buf)), int(sizeof(buf)));
+    QCOMPARE(int(buf[0]), 0x50);
+    QCOMPARE(int(buf[1]), 0);
+    QVERIFY(memcmp(buf + I2cWriteHeaderSize, payload, sizeof(payload)) == 0);
+
+    // A write must not decode as a read.
+    quint8 address = 0;
+    int length = 0;
+    QVERIFY(!decodeI2cRead(buf, sizeof(buf), &address, &length));
+
+    QCOMPARE(encodeI2cWrite(0x50, payload, sizeof(payload), buf, sizeof(buf) - 1), 0);
+    QCOMPARE(encodeI2cWrite(0x50, payload, 0, buf, sizeof(buf)), 0);
+}
+
+void TestBridgeCodec::benchEncodeCanData()
+{
+    STR_CANMSG_T msg = sampleMessage();
+    char data[CanDataSize];
+    QBENCHMARK {
+        msg.Id++;
+        encodeCanData(msg, data, sizeof(data));
+    }
+    QCOMPARE(QByteArray(data, CanDataHeaderSize), QByteArray("CAND"));
+}
+
+void TestBridgeCodec::benchDecodeCanData()
+{
+    char data[CanDataSize];
+    QCOMPARE(encodeCanData(sampleMessage(), data, sizeof(data)), int(CanDataSize));
+    STR_CANMSG_T msg = {};
+    quint32 sum = 0;
+    QBENCHMARK {
+        decodeCanData(data, sizeof(data), &msg);
+        sum += msg.Id;
+    }
+    QVERIFY(sum != 0);
+}
+
+void TestBridgeCodec::benchWrapCanData()
+{
+    char message[CanMessageSize];
+    QCOMPARE(encodeCanMessage(sampleMessage(), message, sizeof(message)), int(CanMessageSize));
+    char data[CanDataSize];
+    int size = 0;
+    QBENCHMARK {
+        message[8]++;
+        size = BridgeCodec::wrapCanData(message, sizeof(message), data, sizeof(data));
+    }
+    QCOMPARE(size, int(CanDataSize));
+}
+
+void TestBridgeCodec::benchEncodeI2cRead()
+{
+    char buf[I2cReadSize];
+    int length = 1;
+    QBENCHMARK {
+        encodeI2cRead(0x50, length, buf, sizeof(buf));
+        length = (length & 0xFFF) + 1;
+    }
+    QVERIFY(buf[0] != 0);
+}
+
+QTEST_APPLESS_MAIN(TestBridgeCodec)
+
+#include "tst_bridgecodec.moc"
@@ -0,0 +1,16 @@
+# Plain C harness for the libnubridge API. Build ../../libnubridge.pro in
+# the same build tree first, then:
+#   qmake && make && ./nubridge_harness                 # API checks only
+#   ./nubridge_harness ttyACM0 can                      # plus a bridge round
+
+TEMPLATE = app
+CONFIG -= qt app_bundle
+CONFIG += console
+
+TARGET = nubridge_harness
+
+INCLUDEPATH += ../..
+LIBS += -L$$OUT_PWD/../.. -lnubridge
+unix: QMAKE_RPATHDIR += $$OUT_PWD/../..
+
+SOURCES += nubridge_harness.c
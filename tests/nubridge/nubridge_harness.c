@@ -0,0 +1,150 @@
+/*
+ * Exercises libnubridge from plain C, the way a test rig or a ctypes
+ * binding would: no Qt headers and no event loop in this process.
+ *
+ *   nubridge_harness                  argument and state checks only
+ *   nubridge_harness <port> can|i2c|spi
+ *                                     also configures the bridge on <port>
+ *                                     and runs one exchange
+ */
+
+#include "nubridge.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+static void checkApi(void)
+{
+    nubridge_config config;
+    nubridge *bridge;
+    nubridge_can_frame frame;
+    uint8_t data[4] = { 0 };
+    int status;
+
+    CHECK(nubridge_api_version() == NUBRIDGE_API_VERSION);
+
+    nubridge_default_config(&config, NUBRIDGE_MODE_CAN);
+    CHECK(config.mode == NUBRIDGE_MODE_CAN && config.clock == 500000 && config.bus_mode == 1);
+    CHECK(config.can_filter[0] == 0xFFFFFFFFu && config.can_filter[3] == 0xFFFFFFFFu);
+    nubridge_default_config(&config, NUBRIDGE_MODE_I2C);
+    CHECK(config.clock == 100000);
+    nubridge_default_config(&config, NUBRIDGE_MODE_SPI);
+    CHECK(config.clock == 1000000);
+
+    CHECK(nubridge_open(NULL) == NULL);
+    CHECK(strcmp(nubridge_error_string(NULL), "invalid handle") == 0);
+    CHECK(nubridge_configure(NULL, &config) == NUBRIDGE_ERROR_ARGUMENT);
+
+    /* A handle is created without touching the port. */
+    bridge = nubridge_open("nubridge-no-such-port");
+    CHECK(bridge != NULL);
+    if (bridge == NULL)
+        return;
+
+    memset(&frame, 0, sizeof(frame));
+    CHECK(nubridge_send_batch(bridge, &frame, 1, 100) == NUBRIDGE_ERROR_STATE);
+    CHECK(nubridge_receive_batch(bridge, &frame, 1, 0) == NUBRIDGE_ERROR_STATE);
+    CHECK(nubridge_i2c_read(bridge, 0x50, data, sizeof(data), 100) == NUBRIDGE_ERROR_STATE);
+    CHECK(nubridge_spi_transfer(bridge, data, data, sizeof(data), 100) == NUBRIDGE_ERROR_STATE);
+    CHECK(nubridge_send_batch(bridge, NULL, 1, 100) == NUBRIDGE_ERROR_ARGUMENT);
+    CHECK(nubridge_i2c_read(bridge, 0x50, data, 0, 100) == NUBRIDGE_ERROR_ARGUMENT);
+
+    nubridge_default_config(&config, NUBRIDGE_MODE_SPI);
+    config.spi_type = 4;
+    CHECK(nubridge_configure(bridge, &config) == NUBRIDGE_ERROR_ARGUMENT);
+    config.clock = 0;
+    CHECK(nubridge_configure(bridge, &config) == NUBRIDGE_ERROR_ARGUMENT);
+
+    /* Opening a missing port fails cleanly, and sets up Qt on the way. */
+    nubridge_default_config(&config, NUBRIDGE_MODE_CAN);
+    status = nubridge_configure(bridge, &config);
+    CHECK(status == NUBRIDGE_ERROR_IO);
+    CHECK(nubridge_error_string(bridge)[0] != '\0');
+    if (status == NUBRIDGE_ERROR_IO)
+        printf("missing port: %s\n", nubridge_error_string(bridge));
+
+    nubridge_close(bridge);
+}
+
+static void runBridge(const char *portName, const char *modeName)
+{
+    nubridge_config config;
+    nubridge *bridge;
+    int mode;
+    int n;
+    int i;
+
+    if (strcmp(modeName, "i2c") == 0)
+        mode = NUBRIDGE_MODE_I2C;
+    else if (strcmp(modeName, "spi") == 0)
+        mode = NUBRIDGE_MODE_SPI;
+    else
+        mode = NUBRIDGE_MODE_CAN;
+
+    bridge = nubridge_open(portName);
+    CHECK(bridge != NULL);
+    if (bridge == NULL)
+        return;
+
+    nubridge_default_config(&config, mode);
+    if (nubridge_configure(bridge, &config) != NUBRIDGE_OK) {
+        fprintf(stderr, "%s: %s\n", portName, nubridge_error_string(bridge));
+        failures++;
+        nubridge_close(bridge);
+        return;
+    }
+
+    if (mode == NUBRIDGE_MODE_CAN) {
+        nubridge_can_frame frames[16];
+        memset(frames, 0, sizeof(frames));
+        for (i = 0; i < 4; i++) {
+            frames[i].id = 0x100 + i;
+            frames[i].dlc = 8;
+            frames[i].data[0] = (uint8_t)i;
+        }
+        CHECK(nubridge_send_batch(bridge, frames, 4, 1000) == 4);
+        n = nubridge_receive_batch(bridge, frames, 16, 1000);
+        CHECK(n >= 0);
+        printf("received %d CAN frames\n", n);
+        for (i = 0; i < n; i++)
+            printf("  %08x%s [%u]\n", (unsigned)frames[i].id,
+                   (frames[i].flags & NUBRIDGE_CAN_EXTENDED) ? "x" : "", frames[i].dlc);
+    } else if (mode == NUBRIDGE_MODE_I2C) {
+        uint8_t data[4];
+        n = nubridge_i2c_read(bridge, 0x50, data, sizeof(data), 1000);
+        CHECK(n >= 0);
+        printf("I2C read from 0x50: %d bytes\n", n);
+    } else {
+        const uint8_t mosi[4] = { 0x9F, 0, 0, 0 };
+        uint8_t miso[4];
+        n = nubridge_spi_transfer(bridge, mosi, miso, sizeof(mosi), 1000);
+        CHECK(n >= 0);
+        printf("SPI transfer: %d bytes\n", n);
+    }
+
+    nubridge_close(bridge);
+}
+
+int main(int argc, char **argv)
+{
+    checkApi();
+    if (argc >= 2)
+        runBridge(argv[1], argc >= 3 ? argv[2] : "can");
+
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
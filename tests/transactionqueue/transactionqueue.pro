@@ -0,0 +1,21 @@
+# Reply matching and timeout recovery of BridgeTransactionQueue:
+#   qmake && make && ./tst_transactionqueue
+
+QT = core testlib
+
+CONFIG += c++14 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_transactionqueue
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    tst_transactionqueue.cpp \
+    ../../transactionqueue.cpp
+
+HEADERS += \
+    ../../nuvbridge.h \
+    ../../bridgecodec.h \
+    ../../transactionqueue.h
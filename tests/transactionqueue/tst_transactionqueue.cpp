@@ -0,0 +1,101 @@
+#include <QtTest>
+
+#include "transactionqueue.h"
+
+// Drives the queue the way MainWindow does: sendFrame() is the port
+// write, bytesWritten() and processResponse() are what the port reports.
+class TestTransactionQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void repliesMatchInOrder();
+    void recoversAfterMissingReply();
+
+private:
+    void writeAll();
+
+    BridgeTransactionQueue *m_queue = nullptr;
+    QVector<QByteArray> m_sent;
+    QVector<BridgeTransaction> m_finished;
+};
+
+void TestTransactionQueue::init()
+{
+    m_queue = new BridgeTransactionQueue;
+    m_sent.clear();
+    m_finished.clear();
+    connect(m_queue, &BridgeTransactionQueue::sendFrame, [this](const QByteArray &frame) {
+        m_sent.append(frame);
+    });
+    connect(m_queue, &BridgeTransactionQueue::finished, [this](const BridgeTransaction &transaction) {
+        m_finished.append(transaction);
+    });
+}
+
+void TestTransactionQueue::cleanup()
+{
+    delete m_queue;
+    m_queue = nullptr;
+}
+
+void TestTransactionQueue::writeAll()
+{
+    qint64 bytes = 0;
+    for (const QByteArray &frame : qAsConst(m_sent))
+        bytes += frame.size();
+    m_queue->bytesWritten(bytes);
+}
+
+void TestTransactionQueue::repliesMatchInOrder()
+{
+    const quint32 first = m_queue->i2cRead(0x50, 2);
+    const quint32 second = m_queue->spiTransfer(QByteArray("\x9F\x00\x00", 3));
+    QCOMPARE(m_sent.size(), 2);
+    writeAll();
+
+    // One read from the port may carry the replies of both.
+    m_queue->processResponse("\x11\x22\xEF\x40\x18", 5);
+    QCOMPARE(m_finished.size(), 2);
+    QCOMPARE(m_finished.at(0).id, first);
+    QCOMPARE(m_finished.at(0).status, BridgeTransaction::Ok);
+    QCOMPARE(m_finished.at(0).response, QByteArray("\x11\x22", 2));
+    QCOMPARE(m_finished.at(1).id, second);
+    QCOMPARE(m_finished.at(1).response, QByteArray("\xEF\x40\x18", 3));
+    QVERIFY(!m_queue->hasPending());
+}
+
+void TestTransactionQueue::recoversAfterMissingReply()
+{
+    m_queue->setWindow(1);
+    m_queue->setTimeout(100);
+
+    const quint32 lost = m_queue->i2cRead(0x50, 2);
+    const quint32 next = m_queue->i2cRead(0x51, 2);
+    QCOMPARE(m_sent.size(), 1);
+    writeAll();
+
+    // No reply to the first read: it times out, and the next request is
+    // held back until late replies can no longer be mistaken for its own.
+    QTRY_COMPARE(m_finished.size(), 1);
+    QCOMPARE(m_finished.at(0).id, lost);
+    QCOMPARE(m_finished.at(0).status, BridgeTransaction::Timeout);
+    QCOMPARE(m_sent.size(), 1);
+
+    QTRY_COMPARE(m_sent.size(), 2);
+    m_queue->bytesWritten(m_sent.at(1).size());
+    m_queue->processResponse("\x33\x44", 2);
+
+    QCOMPARE(m_finished.size(), 2);
+    QCOMPARE(m_finished.at(1).id, next);
+    QCOMPARE(m_finished.at(1).status, BridgeTransaction::Ok);
+    QCOMPARE(m_finished.at(1).response, QByteArray("\x33\x44", 2));
+    QVERIFY(!m_queue->hasPending());
+}
+
+QTEST_GUILESS_MAIN(TestTransactionQueue)
+
+#include "tst_transactionqueue.moc"
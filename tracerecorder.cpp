@@ -0,0 +1,180 @@
+#include "tracerecorder.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+
+#include <cstdio>
+
+enum {
+    RingMask = TraceRecorder::RingSize - 1,
+    WriteChunk = 64 * 1024
+};
+
+struct TraceEvent {
+    const char *name;
+    qint64 startNs;
+    qint64 durationNs;
+};
+
+// One per thread that has recorded a zone. Only the owning thread writes;
+// total is published with release so an export sees complete events.
+struct TraceRing {
+    QAtomicInteger<quint32> total;
+    int tid;
+    QByteArray threadName;
+    TraceEvent events[TraceRecorder::RingSize];
+};
+
+// Rings outlive their threads, so a zone from a finished worker still
+// exports, and the per-thread pointer never dangles.
+struct TraceRegistry {
+    ~TraceRegistry() { qDeleteAll(rings); }
+
+    QMutex mutex;
+    QVector<TraceRing *> rings;
+    QElapsedTimer clock;
+    qint64 originNs = 0;
+};
+
+QAtomicInt TraceRecorder::s_enabled;
+
+static TraceRegistry *registry()
+{
+    static TraceRegistry instance;
+    return &instance;
+}
+
+static thread_local TraceRing *t_ring = nullptr;
+
+static TraceRing *registerThread()
+{
+    TraceRing *ring = new TraceRing;
+    ring->total.store(0);
+
+    QThread *thread = QThread::currentThread();
+    const QCoreApplication *app = QCoreApplication::instance();
+    if (app != nullptr && thread == app->thread())
+        ring->threadName = "main";
+    else if (!thread->objectName().isEmpty())
+        ring->threadName = thread->objectName().toUtf8();
+
+    TraceRegistry *r = registry();
+    QMutexLocker locker(&r->mutex);
+    ring->tid = r->rings.size() + 1;
+    if (ring->threadName.isEmpty())
+        ring->threadName = "thread " + QByteArray::number(ring->tid);
+    r->rings.append(ring);
+    return ring;
+}
+
+void TraceRecorder::start()
+{
+    TraceRegistry *r = registry();
+    {
+        QMutexLocker locker(&r->mutex);
+        if (!r->clock.isValid())
+            r->clock.start();
+        r->originNs = r->clock.nsecsElapsed();
+        for (TraceRing *ring : r->rings)
+            ring->total.store(0);
+    }
+    s_enabled.store(1);
+}
+
+void TraceRecorder::stop()
+{
+    s_enabled.store(0);
+}
+
+qint64 TraceRecorder::now()
+{
+    return registry()->clock.nsecsElapsed();
+}
+
+void TraceRecorder::record(const char *name, qint64 startNs, qint64 endNs)
+{
+    // A zone that outlived stop() is dropped.
+    if (!isEnabled())
+        return;
+
+    TraceRing *ring = t_ring;
+    if (ring == nullptr)
+        ring = t_ring = registerThread();
+
+    const quint32 n = ring->total.load();
+    TraceEvent &event = ring->events[n & RingMask];
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = endNs - startNs;
+    ring->total.storeRelease(n + 1);
+}
+
+qint64 TraceRecorder::zoneCount()
+{
+    TraceRegistry *r = registry();
+    QMutexLocker locker(&r->mutex);
+    qint64 count = 0;
+    for (const TraceRing *ring : r->rings)
+        count += qMin<quint32>(ring->total.loadAcquire(), RingSize);
+    return count;
+}
+
+bool TraceRecorder::writeJson(const QString &fileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (errorString)
+            *errorString = file.errorString();
+        return false;
+    }
+
+    TraceRegistry *r = registry();
+    QMutexLocker locker(&r->mutex);
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QByteArray out;
+    out.reserve(WriteChunk + 256);
+    out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char line[256];
+    bool first = true;
+    for (const TraceRing *ring : r->rings) {
+        snprintf(line, sizeof(line), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lld,\"tid\":%d,"
+                 "\"args\":{\"name\":\"%s\"}}",
+                 first ? "" : ",", pid, ring->tid, ring->threadName.constData());
+        out += line;
+        first = false;
+
+        const quint32 total = ring->total.loadAcquire();
+        const quint32 count = qMin<quint32>(total, RingSize);
+        for (quint32 i = total - count; i != total; i++) {
+            const TraceEvent &event = ring->events[i & RingMask];
+            const qint64 ts = event.startNs - r->originNs;
+            if (ts < 0)
+                continue;   // started before this recording
+            // Microseconds with nanosecond decimals.
+            snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%lld,\"tid\":%d,"
+                     "\"ts\":%lld.%03d,\"dur\":%lld.%03d}",
+                     event.name, pid, ring->tid,
+                     ts / 1000, int(ts % 1000),
+                     event.durationNs / 1000, int(event.durationNs % 1000));
+            out += line;
+            if (out.size() >= WriteChunk) {
+                file.write(out);
+                out.resize(0);
+            }
+        }
+    }
+    out += "\n]}\n";
+    file.write(out);
+
+    if (!file.flush()) {
+        if (errorString)
+            *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
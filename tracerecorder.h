@@ -0,0 +1,71 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QAtomicInt>
+#include <QString>
+
+// Scoped timing zones for the I/O and display paths, exported as Chrome
+// trace-event JSON for chrome://tracing or ui.perfetto.dev.
+//
+//   void Console::putData(const QByteArray &data)
+//   {
+//       TRACE_ZONE("console.insert");
+//       ...
+//
+// While recording is off a zone costs one relaxed load and a branch. While
+// it is on, each thread appends to its own ring buffer without locking; a
+// full ring overwrites its oldest zones, so an export holds the last
+// RingSize zones per thread. Export after stop(): a zone that ends while
+// the rings are being read may be lost.
+//
+// Zone names must be string literals; only the pointer is stored.
+class TraceRecorder
+{
+public:
+    enum {
+        RingSize = 1 << 16      // zones kept per thread
+    };
+
+    static bool isEnabled() { return s_enabled.load() != 0; }
+
+    // start() drops everything recorded before.
+    static void start();
+    static void stop();
+
+    static qint64 now();
+    static void record(const char *name, qint64 startNs, qint64 endNs);
+
+    static qint64 zoneCount();
+    static bool writeJson(const QString &fileName, QString *errorString = nullptr);
+
+private:
+    static QAtomicInt s_enabled;
+};
+
+class TraceZone
+{
+public:
+    explicit TraceZone(const char *name) :
+        m_name(TraceRecorder::isEnabled() ? name : nullptr),
+        m_startNs(m_name != nullptr ? TraceRecorder::now() : 0)
+    {
+    }
+
+    ~TraceZone()
+    {
+        if (m_name != nullptr)
+            TraceRecorder::record(m_name, m_startNs, TraceRecorder::now());
+    }
+
+private:
+    Q_DISABLE_COPY(TraceZone)
+
+    const char *m_name;
+    qint64 m_startNs;
+};
+
+#define TRACE_ZONE_CONCAT2(a, b) a##b
+#define TRACE_ZONE_CONCAT(a, b) TRACE_ZONE_CONCAT2(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_ZONE_CONCAT(traceZone, __LINE__)(name)
+
+#endif // TRACERECORDER_H
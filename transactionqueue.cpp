@@ -0,0 +1,244 @@
+#include "transactionqueue.h"
+#include "bridgecodec.h"
+
+#include <QEventLoop>
+#include <QTimer>
+
+#include <algorithm>
+
+enum {
+    ResyncGuardMs = 50      // late replies of timed out reads are dropped
+};
+
+BridgeTransactionQueue::BridgeTransactionQueue(QObject *parent) :
+    QObject(parent),
+    m_timer(new QTimer(this)),
+    m_resumeTimer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &BridgeTransactionQueue::expire);
+    m_resumeTimer->setSingleShot(true);
+    m_resumeTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_resumeTimer, &QTimer::timeout, this, &BridgeTransactionQueue::pump);
+    m_clock.start();
+}
+
+quint32 BridgeTransactionQueue::i2cRead(quint8 address, int size)
+{
+    if (size < 1 || size > BridgeCodec::I2cMaxReadSize)
+        return 0;
+
+    Entry entry;
+    entry.transaction.type = BridgeTransaction::I2cRead;
+    entry.transaction.address = address;
+    entry.transaction.size = size;
+
+    entry.frame.resize(BridgeCodec::I2cReadSize);
+    BridgeCodec::encodeI2cRead(address, size, entry.frame.data(), entry.frame.size());
+
+    return enqueue(entry, size);
+}
+
+quint32 BridgeTransactionQueue::i2cWrite(quint8 address, const QByteArray &data)
+{
+    if (data.isEmpty())
+        return 0;
+
+    Entry entry;
+    entry.transaction.type = BridgeTransaction::I2cWrite;
+    entry.transaction.address = address;
+    entry.transaction.size = data.size();
+    entry.transaction.data = data;
+
+    entry.frame.resize(BridgeCodec::i2cWriteSize(data.size()));
+    BridgeCodec::encodeI2cWrite(address, data.constData(), data.size(), entry.frame.data(), entry.frame.size());
+
+    return enqueue(entry, 0);
+}
+
+quint32 BridgeTransactionQueue::spiTransfer(const QByteArray &mosi)
+{
+    if (mosi.isEmpty())
+        return 0;
+
+    // SPI is full duplex: every byte clocked out returns one MISO byte.
+    Entry entry;
+    entry.transaction.type = BridgeTransaction::SpiTransfer;
+    entry.transaction.address = 0;
+    entry.transaction.size = mosi.size();
+    entry.transaction.data = mosi;
+    entry.frame = mosi;
+
+    return enqueue(entry, mosi.size());
+}
+
+quint32 BridgeTransactionQueue::enqueue(Entry &entry, int responseSize)
+{
+    entry.transaction.id = m_nextId++;
+    entry.transaction.status = BridgeTransaction::Pending;
+    entry.transaction.latencyNs = 0;
+    entry.transaction.response.reserve(responseSize);
+    entry.responseLeft = responseSize;
+    entry.writeLeft = entry.frame.size();
+    entry.sentNs = 0;
+
+    const quint32 id = entry.transaction.id;
+    m_waiting.enqueue(entry);
+    pump();
+    return id;
+}
+
+BridgeTransaction BridgeTransactionQueue::waitFor(quint32 id)
+{
+    BridgeTransaction result;
+    result.id = id;
+    result.status = BridgeTransaction::Pending;
+
+    auto matches = [id](const Entry &entry) { return entry.transaction.id == id; };
+    if (std::none_of(m_inFlight.cbegin(), m_inFlight.cend(), matches)
+            && std::none_of(m_waiting.cbegin(), m_waiting.cend(), matches)) {
+        result.status = BridgeTransaction::Cancelled;
+        return result;
+    }
+
+    QEventLoop loop;
+    QMetaObject::Connection connection = connect(this, &BridgeTransactionQueue::finished,
+                                                 [&](const BridgeTransaction &transaction) {
+        if (transaction.id != id)
+            return;
+        result = transaction;
+        loop.quit();
+    });
+    loop.exec();
+    disconnect(connection);
+
+    return result;
+}
+
+void BridgeTransactionQueue::pump()
+{
+    if (m_pumping)
+        return;
+
+    // Nothing goes out while late replies are being dropped, or its own
+    // reply would be dropped with them.
+    const qint64 guardNs = m_discardUntilNs - m_clock.nsecsElapsed();
+    if (guardNs > 0) {
+        if (!m_waiting.isEmpty() && !m_resumeTimer->isActive())
+            m_resumeTimer->start(static_cast<int>(guardNs / 1000000) + 1);
+        return;
+    }
+
+    m_pumping = true;
+    while (m_inFlight.size() < m_window && !m_waiting.isEmpty()) {
+        Entry entry = m_waiting.dequeue();
+        const QByteArray frame = entry.frame;
+        entry.frame.clear();
+        entry.sentNs = m_clock.nsecsElapsed();
+        m_inFlight.enqueue(entry);
+        emit sendFrame(frame);
+    }
+    m_pumping = false;
+
+    armTimer();
+}
+
+void BridgeTransactionQueue::bytesWritten(qint64 bytes)
+{
+    for (Entry &entry : m_inFlight) {
+        if (bytes == 0)
+            break;
+        const qint64 n = qMin(bytes, entry.writeLeft);
+        entry.writeLeft -= n;
+        bytes -= n;
+    }
+
+    retire();
+}
+
+void BridgeTransactionQueue::processResponse(const char *data, int size)
+{
+    if (m_clock.nsecsElapsed() < m_discardUntilNs)
+        return;
+
+    const char *p = data;
+    int left = size;
+    for (Entry &entry : m_inFlight) {
+        if (left == 0)
+            break;
+        const int n = qMin(left, entry.responseLeft);
+        if (n > 0) {
+            entry.transaction.response.append(p, n);
+            entry.responseLeft -= n;
+            p += n;
+            left -= n;
+        }
+    }
+
+    retire();
+}
+
+void BridgeTransactionQueue::retire()
+{
+    while (!m_inFlight.isEmpty() && m_inFlight.head().writeLeft == 0 && m_inFlight.head().responseLeft == 0) {
+        Entry entry = m_inFlight.dequeue();
+        complete(entry, BridgeTransaction::Ok);
+    }
+
+    pump();
+}
+
+void BridgeTransactionQueue::expire()
+{
+    if (m_inFlight.isEmpty())
+        return;
+
+    const qint64 now = m_clock.nsecsElapsed();
+    if (now - m_inFlight.head().sentNs < m_timeoutMs * Q_INT64_C(1000000)) {
+        armTimer();
+        return;
+    }
+
+    // Replies are matched by position, so once one is missing the rest of
+    // the window can't be trusted either.
+    QQueue<Entry> failed;
+    failed.swap(m_inFlight);
+    m_discardUntilNs = now + ResyncGuardMs * Q_INT64_C(1000000);
+    for (Entry &entry : failed)
+        complete(entry, BridgeTransaction::Timeout);
+
+    pump();
+}
+
+void BridgeTransactionQueue::cancelAll()
+{
+    QQueue<Entry> cancelled;
+    cancelled.swap(m_inFlight);
+    cancelled.append(m_waiting);
+    m_waiting.clear();
+    m_timer->stop();
+    m_resumeTimer->stop();
+
+    for (Entry &entry : cancelled)
+        complete(entry, BridgeTransaction::Cancelled);
+}
+
+void BridgeTransactionQueue::armTimer()
+{
+    if (m_inFlight.isEmpty()) {
+        m_timer->stop();
+        return;
+    }
+
+    const qint64 deadline = m_inFlight.head().sentNs + m_timeoutMs * Q_INT64_C(1000000);
+    const qint64 remainingMs = (deadline - m_clock.nsecsElapsed()) / 1000000;
+    m_timer->start(static_cast<int>(qMax<qint64>(0, remainingMs)));
+}
+
+void BridgeTransactionQueue::complete(Entry &entry, BridgeTransaction::Status status)
+{
+    entry.transaction.status = status;
+    entry.transaction.latencyNs = entry.sentNs > 0 ? m_clock.nsecsElapsed() - entry.sentNs : 0;
+
+    emit finished(entry.transaction);
+}
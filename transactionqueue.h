@@ -0,0 +1,105 @@
+#ifndef TRANSACTIONQUEUE_H
+#define TRANSACTIONQUEUE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QQueue>
+
+QT_BEGIN_NAMESPACE
+
+class QTimer;
+
+QT_END_NAMESPACE
+
+struct BridgeTransaction {
+    enum Type {
+        I2cRead,
+        I2cWrite,
+        SpiTransfer
+    };
+
+    enum Status {
+        Pending,
+        Ok,
+        Timeout,
+        Cancelled
+    };
+
+    quint32 id;
+    Type type;
+    quint8 address;         // I2C only
+    int size;               // bytes requested (I2C read) or bytes sent
+    QByteArray data;        // bytes sent: I2C payload or SPI MOSI
+    QByteArray response;    // bytes returned: I2C read data or SPI MISO
+    Status status;
+    qint64 latencyNs;       // from write to the port until completion
+};
+
+// Queues I2C and SPI requests and keeps up to window() of them on the wire.
+// The bridge answers in request order, an I2C read returns exactly the
+// requested number of bytes and an SPI transfer clocks back one byte per
+// byte sent, so replies are matched to requests by position.
+class BridgeTransactionQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BridgeTransactionQueue(QObject *parent = nullptr);
+
+    quint32 i2cRead(quint8 address, int size);
+    quint32 i2cWrite(quint8 address, const QByteArray &data);
+    quint32 spiTransfer(const QByteArray &mosi);
+    void cancelAll();
+
+    // Runs a local event loop until the transaction completes, for scripts
+    // and headless tools that want a blocking call.
+    BridgeTransaction waitFor(quint32 id);
+
+    bool hasPending() const { return !m_waiting.isEmpty() || !m_inFlight.isEmpty(); }
+
+    int window() const { return m_window; }
+    void setWindow(int transactions) { m_window = qMax(1, transactions); }
+    int timeout() const { return m_timeoutMs; }
+    void setTimeout(int ms) { m_timeoutMs = ms; }
+
+    void processResponse(const char *data, int size);
+
+public slots:
+    void bytesWritten(qint64 bytes);
+
+signals:
+    void sendFrame(const QByteArray &frame);
+    void finished(const BridgeTransaction &transaction);
+
+private slots:
+    void expire();
+
+private:
+    struct Entry {
+        BridgeTransaction transaction;
+        QByteArray frame;
+        qint64 writeLeft;
+        int responseLeft;
+        qint64 sentNs;
+    };
+
+    quint32 enqueue(Entry &entry, int responseSize);
+    void pump();
+    void retire();
+    void armTimer();
+    void complete(Entry &entry, BridgeTransaction::Status status);
+
+    QQueue<Entry> m_waiting;
+    QQueue<Entry> m_inFlight;
+    QElapsedTimer m_clock;
+    QTimer *m_timer = nullptr;
+    QTimer *m_resumeTimer = nullptr;    // sends again once the resync guard ends
+    quint32 m_nextId = 1;
+    int m_window = 8;
+    int m_timeoutMs = 500;
+    qint64 m_discardUntilNs = 0;
+    bool m_pumping = false;
+};
+
+#endif // TRANSACTIONQUEUE_H
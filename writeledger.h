@@ -0,0 +1,52 @@
+#ifndef WRITELEDGER_H
+#define WRITELEDGER_H
+
+#include <QQueue>
+
+// Splits QIODevice::bytesWritten among the writers sharing a port. The port
+// sends bytes in write order, so each write is recorded with its owner and
+// written bytes are handed out from the oldest write on. Without this, a
+// writer that counts every bytesWritten would take credit for bytes queued
+// by the send box or another engine.
+class WriteLedger
+{
+public:
+    void clear() { m_writes.clear(); }
+
+    void add(int owner, qint64 bytes)
+    {
+        if (bytes <= 0)
+            return;
+        if (!m_writes.isEmpty() && m_writes.last().owner == owner)
+            m_writes.last().bytes += bytes;
+        else
+            m_writes.enqueue({ owner, bytes });
+    }
+
+    // Calls onWritten(owner, bytes) for each owner's share, oldest first.
+    // The handler may add new writes.
+    template<typename Handler>
+    void written(qint64 bytes, Handler onWritten)
+    {
+        while (bytes > 0 && !m_writes.isEmpty()) {
+            Write &head = m_writes.head();
+            const int owner = head.owner;
+            const qint64 n = qMin(bytes, head.bytes);
+            head.bytes -= n;
+            bytes -= n;
+            if (head.bytes == 0)
+                m_writes.dequeue();
+            onWritten(owner, n);
+        }
+    }
+
+private:
+    struct Write {
+        int owner;
+        qint64 bytes;
+    };
+
+    QQueue<Write> m_writes;
+};
+
+#endif // WRITELEDGER_H